@@ -7,10 +7,12 @@
 # include <stdhdrs.h>
 
 # include <debug.h>
+# include <tunable.h>
 # include <strbuf.h>
 # include <strdict.h>
 # include <strtable.h>
 # include <error.h>
+# include <errorlog.h>
 # include <i18napi.h>
 # include <charcvt.h>
 # include <transdict.h>
@@ -33,6 +35,7 @@
 # include "clientusernull.h"
 # include "clientservice.h"
 # include "clientmerge.h"
+# include "clientmergepipe.h"
 # include "client.h"
 
 void clientTrust( Client *, Error * );
@@ -47,6 +50,7 @@ Client::Client( Enviro *e ) : Rpc( &service )
 	// Use the builtin ClientMerger until SetMerger is called.
 
 	fromTransDialog = toTransDialog = NULL;
+	mergePipe = 0;
 	translated = this;
 	transfname = this;
 	errors = 0;
@@ -93,6 +97,7 @@ Client::Client( Enviro *e ) : Rpc( &service )
 	service.Dispatcher( clientDispatch );
 
 	service.SetProtocol( P4Tag::v_cmpfile ); // has clientCompareFile #1737
+	service.SetProtocol( P4Tag::v_recbatch ); // batched clientReconcileAdd
 	service.SetProtocol( P4Tag::v_client, P4Tag::l_client );
 
 	buildInfo = p4api_ident.GetIdent();
@@ -100,6 +105,7 @@ Client::Client( Enviro *e ) : Rpc( &service )
 
 Client::~Client()
 {
+	delete mergePipe;
 	CleanupTrans();
 	if( ownEnviro )
 	    delete enviro;
@@ -122,6 +128,14 @@ Client::Init( Error *e )
 	if( !e->Test() )
 	    service.SetEndpoint( GetPort().Text(), e );
 
+	// P4RPCRECORD captures the server's messages for 'p4 replay'.
+	// They include credentials: see RpcTransport::SetRecord().
+
+	const char *record = enviro->Get( "P4RPCRECORD" );
+
+	if( record && *record )
+	    SetRecord( StrRef( record ) );
+
 	if( !e->Test() )
 	    Connect( e );
 
@@ -287,6 +301,11 @@ Client::WaitTag( ClientUser *u )
 	{
 	    Dispatch();
 
+	    // Normally done on 'release' (clientRelease()), unless
+	    // the connection went first.
+
+	    DrainMerges();
+
 	    authenticated = 1;
 
 	    // lowerTag is done; signal that
@@ -316,6 +335,32 @@ Client::Final( Error *e )
 
 	ReleaseFinal();
 	Disconnect();
+
+	// P4RPCSTATS appends a line of per-handler stats for this
+	// connection: see RpcHandlerStats in rpc.h.
+
+	const char *stats = enviro->Get( "P4RPCSTATS" );
+
+	if( stats && *stats )
+	{
+	    StrBuf json;
+	    HandlerStatsJson( json );
+	    json << "\n";
+
+	    Error fe;
+	    FileSys *f = FileSys::Create( FST_ATEXT );
+	    f->Set( StrRef( stats ) );
+	    f->Open( FOM_WRITE, &fe );
+
+	    if( !fe.Test() )
+		f->Write( json, &fe );
+	    if( !fe.Test() )
+		f->Close( &fe );
+	    if( fe.Test() )
+		AssertLog.Report( &fe );
+
+	    delete f;
+	}
 	
 	// Propagate any IO errors
 
@@ -385,6 +430,11 @@ Client::Confirm( const StrPtr *confirm )
 	// pre 99.1 servers need GetEnv(), too, because they
 	// reestablished DmCaller context each time. 
 
+	// Merges queued ahead of us confirm first.  CopyVars()
+	// doesn't go through VSetVar(), so do it here.
+
+	DrainMerges();
+
 	if( protocolServer < 6 )
 	    GetEnv();
 
@@ -393,6 +443,44 @@ Client::Confirm( const StrPtr *confirm )
 	Invoke( confirm->Text() );
 }
 
+void
+Client::Invoke( const char *opName )
+{
+	DrainMerges();
+
+	Rpc::Invoke( opName );
+}
+
+ClientMergePipe *
+Client::MergePipe()
+{
+	if( !mergePipe )
+	{
+	    int threads = p4tunable.Get( P4TUNE_FILESYS_RESOLVE_THREADS );
+
+	    if( !threads )
+		return 0;
+
+	    mergePipe = new ClientMergePipe( this, threads );
+	}
+
+	return mergePipe;
+}
+
+void
+Client::DrainMerges()
+{
+	if( mergePipe )
+	    mergePipe->Drain();
+}
+
+void
+Client::DrainMerges( const StrPtr *path )
+{
+	if( mergePipe )
+	    mergePipe->Drain( path );
+}
+
 void
 Client::NewHandler()
 {
@@ -418,6 +506,11 @@ Client::SetArgv( int ac, char * const * av)
 void
 Client::VSetVar( const StrPtr &var, const StrPtr &val )
 {
+	// Anything for the server waits for the confirms owed
+	// for queued merges: see clientmergepipe.h.
+
+	DrainMerges();
+
 	if (translated != this)
 		translated->RemoveVar(var.Text());
 	// careful about the order here
@@ -46,6 +46,8 @@
  *
  *	Client::WaitTag() - wait for a RunTag()/all RunTag()s to complete.
  *
+ *	Client::PendingTags() - number of RunTag()s not yet completed.
+ *
  *	Client::Final() - clean up end of connection, returning error count.
  *
  *	Client::Dispatcher() - just a shortcut to the service dispatcher.
@@ -101,6 +103,16 @@
  *	Client::Confirm() - copy all recv vars to send vars, excluding 
  *		'data' and 'func', and Invoke() the named func.
  *
+ *	Client::MergePipe() - worker threads for 'resolve -a' merges, or
+ *		0 if filesys.resolve.threads is 0 (see clientmergepipe.h).
+ *		Confirms owed for its merges are sent before any other
+ *		SetVar(), Invoke() or Confirm().
+ *
+ *	Client::DrainMerges() - send the confirms owed for MergePipe()'s
+ *		merges, waiting for them to finish.  Handlers that touch
+ *		client files call it first; given a path, it waits only
+ *		for merges of that file (and those ahead of them).
+ *
  *	Client::SetError() - bumps an error counter, whose value is 
  *		returned by GetErrors().  Used by OutputError() to
  *		track any errors returned by the server.
@@ -113,9 +125,10 @@
  *		than having to blurted out by Rpc::Dispatch().
  */
 
-const int ClientTags = 4; // max pending RunTags()
+const int ClientTags = 16; // max pending RunTags()
 
 class ClientUser;
+class ClientMergePipe;
 class CharSetCvt;
 class Ignore;
 class Enviro;
@@ -149,6 +162,8 @@ class Client : public Rpc {
 
 	void		RunTag( const char *func, ClientUser *ui );
 	void		WaitTag( ClientUser *ui = 0 );
+	int		PendingTags()
+			{ return ( upperTag - lowerTag + ClientTags ) % ClientTags; }
 
 	void		SetArgv(int ac, char * const * av);
 
@@ -282,6 +297,10 @@ class Client : public Rpc {
 
 	Handlers	handles;
 
+	ClientMergePipe	*MergePipe();
+	void		DrainMerges();
+	void		DrainMerges( const StrPtr *path );
+
 	void		NewHandler();
 	CharSetCvt	*fromTransDialog, *toTransDialog;
         StrDict		*translated, *transfname;
@@ -290,6 +309,7 @@ class Client : public Rpc {
 	int		output_charset;  // result output charset
  
 	void		VSetVar( const StrPtr &var, const StrPtr &val );
+	void		Invoke( const char *opName );
 
 	int		protocolXfiles;	// 'xfiles' protocol
 	int		protocolNocase;	// 'nocase' protocol
@@ -335,6 +355,7 @@ class Client : public Rpc {
 	int		pubKeyChecked;
 
 	RpcService	service;
+	ClientMergePipe	*mergePipe;
 	int		errors;
 	int		fatals;
 
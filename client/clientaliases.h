@@ -39,6 +39,9 @@ void clientParseOptions( Options &opts, int &argc, StrPtr *&argv, Error *e );
 void clientParseOptions( Options &opts, int &argc, char **&argv, Error *e );
 void clientSetVariables( Client &client, Options &opts );
 int  clientPrepareEnv  ( Client &client, Options &opts, Enviro &enviro );
+void clientSetProtocols( Client &client, Options &opts );
+ClientUser *clientCreateUI( Options &opts );
+void setVarsAndArgs( Client &client, int argc, char **argv, Options &opts );
 
 class CommandPattern;
 
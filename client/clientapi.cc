@@ -28,10 +28,15 @@ void 	ClientApi::Run( const char *func ) { client->Run( func, ui ); }
 void 	ClientApi::Run( const char *func, ClientUser *i ) { client->Run( func, i ); }
 int 	ClientApi::Final( Error *e ) { return client->Final( e ); }
 int 	ClientApi::Dropped() { return client->Dropped(); }
+int	ClientApi::IsAlive()
+	{ KeepAlive *k = client->GetKeepAlive(); return !client->Dropped() && k && k->IsAlive(); }
 int 	ClientApi::GetErrors() { return client->GetErrors(); }
 int	ClientApi::GetTrans() { return client->output_charset; }
 int	ClientApi::IsUnicode() { return client->IsUnicode(); }
 
+const RpcHandlerStats *ClientApi::GetHandlerStats( int i ) { return client->GetHandlerStats( i ); }
+void	ClientApi::GetHandlerStatsJson( StrBuf &o ) { client->HandlerStatsJson( o ); }
+
 void	ClientApi::RunTag( const char *f, ClientUser *u ) { client->RunTag( f, u ); }
 void	ClientApi::WaitTag( ClientUser *u ) { client->WaitTag( u ); }
 
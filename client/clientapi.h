@@ -73,8 +73,15 @@
  *	ClientApi::Run() - run a single command
  *	ClientApi::Final() - clean up end of connection, returning error count.
  *	ClientApi::Dropped() - check if connection is no longer serviceable
+ *	ClientApi::IsAlive() - check, without a command, that the server
+ *		hasn't closed an idle connection (see clientapipool.h)
  *	ClientApi::GetErrors() - get count of errors returned by server.
  *
+ *	ClientApi::GetHandlerStats() - get per-handler RPC counters (see
+ *		RpcHandlerStats in rpc.h): the i'th handler dispatched so
+ *		far on this connection, or 0 past the last one.
+ *	ClientApi::GetHandlerStatsJson() - same, formatted as JSON.
+ *
  *	ClientApi::RunTag() - run a single command (potentially) asynchronously.
  *	ClientApi::WaitTag() - wait for a RunTag()/all RunTag()s to complete.
  *
@@ -153,6 +160,7 @@
 
 class Client;
 class Ignore;
+struct RpcHandlerStats;
 
 class ClientApi : public StrDict {
 
@@ -173,10 +181,14 @@ class ClientApi : public StrDict {
 	void		Run( const char *func, ClientUser *ui );
 	int		Final( Error *e );
 	int		Dropped();
+	int		IsAlive();
 	int		GetErrors();
 	int		GetTrans();
 	int		IsUnicode();
 
+	const RpcHandlerStats *GetHandlerStats( int i );
+	void		GetHandlerStatsJson( StrBuf &out );
+
 	void		RunTag( const char *func, ClientUser *ui );
 	void		WaitTag( ClientUser *ui = 0 );
 
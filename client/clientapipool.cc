@@ -0,0 +1,451 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * clientapipool.cc - server connections kept open for reuse
+ *
+ * Internal classes:
+ *
+ *	ClientApiPoolEntry - a connection, its key, and when last released
+ *	ClientApiPoolSync - the pool's lock, and the condition Get() waits on
+ *
+ * Locking: the lock guards the lists and counts only.  Entries are
+ * taken off the lists under it, then opened, checked or closed after
+ * it's let go.  A connection being opened is on the busy list with no
+ * ClientApi yet, so it counts against the total cap.
+ */
+
+# define NEED_THREADS
+# define NEED_TIME
+
+# include "clientapipool.h"
+
+# include <strops.h>
+
+class ClientApiPoolEntry {
+
+    public:
+			ClientApiPoolEntry()
+			{
+			    client = 0;
+			    released = 0;
+			    next = 0;
+			}
+
+	int		Match( const char *port, const char *user,
+				const char *charset, const char *protocol )
+			{
+			    return this->port == port && this->user == user &&
+				this->charset == charset &&
+				this->protocol == protocol;
+			}
+
+	StrBuf		port;
+	StrBuf		user;
+	StrBuf		charset;
+	StrBuf		protocol;
+
+	ClientApi	*client;
+	time_t		released;
+
+	ClientApiPoolEntry *next;
+
+} ;
+
+# ifdef HAVE_PTHREAD
+
+struct ClientApiPoolSync {
+
+	void		Lock() { pthread_mutex_lock( &lock ); }
+	void		Unlock() { pthread_mutex_unlock( &lock ); }
+	void		Wait() { pthread_cond_wait( &room, &lock ); }
+	void		Signal() { pthread_cond_signal( &room ); }
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	room;		// Get(): a connection released
+
+} ;
+
+# else
+
+struct ClientApiPoolSync {
+
+	void		Lock() {}
+	void		Unlock() {}
+	void		Signal() {}
+
+} ;
+
+# endif /* HAVE_PTHREAD */
+
+static void
+Unlink( ClientApiPoolEntry **list, ClientApiPoolEntry *p )
+{
+	for( ; *list; list = &(*list)->next )
+	{
+	    if( *list != p )
+		continue;
+
+	    *list = p->next;
+	    p->next = 0;
+	    return;
+	}
+}
+
+/*
+ * ClientApiPool::ClientApiPool() - an empty pool
+ * ClientApiPool::~ClientApiPool() - close the idle connections
+ *
+ * 'maxIdle' caps the connections kept idle; 'maxOpen' those idle and
+ * handed out together, 0 being no cap.
+ */
+
+ClientApiPool::ClientApiPool( int maxIdle, int maxOpen )
+{
+	idle = busy = 0;
+	nIdle = nBusy = 0;
+	maxIdleTime = 60;
+
+	SetMax( maxIdle, maxOpen );
+
+	sync = new ClientApiPoolSync;
+
+# ifdef HAVE_PTHREAD
+	pthread_mutex_init( &sync->lock, 0 );
+	pthread_cond_init( &sync->room, 0 );
+# endif
+}
+
+ClientApiPool::~ClientApiPool()
+{
+	Close( idle );
+
+	// Entries handed out: the ClientApis are the callers'.
+
+	while( busy )
+	{
+	    ClientApiPoolEntry *p = busy;
+	    busy = p->next;
+	    delete p;
+	}
+
+# ifdef HAVE_PTHREAD
+	pthread_cond_destroy( &sync->room );
+	pthread_mutex_destroy( &sync->lock );
+# endif
+
+	delete sync;
+}
+
+/*
+ * ClientApiPool::Get() - an idle connection for the key, or a new one
+ *
+ * Idle connections are tried most recently released first.  At the
+ * total cap, the least recently released idle connection (of some
+ * other key) is closed to make room; with none idle, Get() waits for a
+ * Release().  Returns 0, with 'e' set, if a new connection's Init()
+ * fails.
+ */
+
+ClientApi *
+ClientApiPool::Get( const char *port, const char *user,
+	const char *charset, const char *protocol, Error *e )
+{
+	if( !charset ) charset = "";
+	if( !protocol ) protocol = "";
+
+	for( ;; )
+	{
+	    ClientApiPoolEntry *close = 0;
+	    ClientApiPoolEntry *p = 0;
+	    ClientApiPoolEntry **l;
+	    int reused = 0;
+
+	    sync->Lock();
+
+	    TakeStale( &close );
+
+	    for( l = &idle; *l; l = &(*l)->next )
+		if( (*l)->Match( port, user, charset, protocol ) )
+		    break;
+
+	    if( *l )
+	    {
+		p = *l;
+		*l = p->next;
+		--nIdle;
+		reused = 1;
+	    }
+	    else if( maxOpen && nIdle + nBusy >= maxOpen && idle )
+	    {
+		// Make room: close the least recently released.
+
+		for( l = &idle; (*l)->next; l = &(*l)->next )
+		    ;
+
+		(*l)->next = close;
+		close = *l;
+		*l = 0;
+		--nIdle;
+	    }
+# ifdef HAVE_PTHREAD
+	    else if( maxOpen && nIdle + nBusy >= maxOpen )
+	    {
+		sync->Wait();
+		sync->Unlock();
+
+		// Any TakeStale() found: they're off the lists already.
+
+		Close( close );
+		continue;
+	    }
+# endif
+
+	    if( !p )
+	    {
+		p = new ClientApiPoolEntry;
+		p->port.Set( port );
+		p->user.Set( user );
+		p->charset.Set( charset );
+		p->protocol.Set( protocol );
+	    }
+
+	    p->next = busy;
+	    busy = p;
+	    ++nBusy;
+
+	    sync->Unlock();
+
+	    Close( close );
+
+	    // Reused: make sure the server hasn't gone away meanwhile.
+
+	    if( reused )
+	    {
+		if( p->client->IsAlive() )
+		    return p->client;
+
+		sync->Lock();
+		Unlink( &busy, p );
+		--nBusy;
+		sync->Signal();
+		sync->Unlock();
+
+		Close( p );
+		continue;
+	    }
+
+	    // New: open it.
+
+	    ClientApi *client = new ClientApi;
+
+	    client->SetPort( port );
+	    client->SetUser( user );
+
+	    if( *charset )
+		client->SetCharset( charset );
+
+	    if( *protocol )
+	    {
+		StrBuf tmp;
+		char *vars[ 64 ];
+		int n = StrOps::Words( tmp, protocol, vars, 64 );
+
+		for( int i = 0; i < n; i++ )
+		    client->SetProtocolV( vars[i] );
+	    }
+
+	    Setup( client );
+
+	    client->Init( e );
+
+	    sync->Lock();
+
+	    if( e->Test() )
+	    {
+		Unlink( &busy, p );
+		--nBusy;
+		sync->Signal();
+		sync->Unlock();
+
+		Error e1;
+		client->Final( &e1 );
+		delete client;
+		delete p;
+		return 0;
+	    }
+
+	    p->client = client;
+	    sync->Unlock();
+
+	    return client;
+	}
+}
+
+/*
+ * ClientApiPool::Release() - done with a connection: keep or close it
+ *
+ * A connection that has Dropped() is closed; otherwise it's kept, and
+ * the least recently released closed if that's more than the idle cap.
+ * A ClientApi not from Get() is left alone.
+ */
+
+void
+ClientApiPool::Release( ClientApi *client )
+{
+	ClientApiPoolEntry *close = 0;
+	ClientApiPoolEntry *p;
+
+	sync->Lock();
+
+	for( p = busy; p && ( !client || p->client != client ); p = p->next )
+	    ;
+
+	if( !p )
+	{
+	    sync->Unlock();
+	    return;
+	}
+
+	Unlink( &busy, p );
+	--nBusy;
+
+	if( client->Dropped() || !maxIdle )
+	{
+	    close = p;
+	}
+	else
+	{
+	    p->released = time( 0 );
+	    p->next = idle;
+	    idle = p;
+
+	    if( ++nIdle > maxIdle )
+	    {
+		ClientApiPoolEntry **l;
+
+		for( l = &idle; (*l)->next; l = &(*l)->next )
+		    ;
+
+		close = *l;
+		*l = 0;
+		--nIdle;
+	    }
+	}
+
+	TakeStale( &close );
+
+	sync->Signal();
+	sync->Unlock();
+
+	Close( close );
+}
+
+/*
+ * ClientApiPool::Expire() - close connections idle too long
+ */
+
+void
+ClientApiPool::Expire()
+{
+	ClientApiPoolEntry *close = 0;
+
+	sync->Lock();
+	TakeStale( &close );
+	sync->Unlock();
+
+	Close( close );
+}
+
+/*
+ * ClientApiPool::SetMax() - cap idle and total connections
+ * ClientApiPool::SetMaxIdleTime() - seconds an idle connection is kept
+ *
+ * Lowering the caps closes nothing at once: it takes effect as
+ * connections come and go.  A 'seconds' of 0 keeps idle connections
+ * indefinitely.
+ */
+
+void
+ClientApiPool::SetMax( int maxIdle, int maxOpen )
+{
+	this->maxIdle = maxIdle < 0 ? 0 : maxIdle;
+	this->maxOpen = maxOpen < 0 ? 0 : maxOpen;
+}
+
+void
+ClientApiPool::SetMaxIdleTime( int seconds )
+{
+	maxIdleTime = seconds < 0 ? 0 : seconds;
+}
+
+/*
+ * ClientApiPool::Idle() - connections kept idle
+ * ClientApiPool::Open() - connections idle or handed out
+ */
+
+int
+ClientApiPool::Idle()
+{
+	sync->Lock();
+	int n = nIdle;
+	sync->Unlock();
+	return n;
+}
+
+int
+ClientApiPool::Open()
+{
+	sync->Lock();
+	int n = nIdle + nBusy;
+	sync->Unlock();
+	return n;
+}
+
+/*
+ * ClientApiPool::TakeStale() - move expired idle entries onto 'close'
+ * ClientApiPool::Close() - Final() and delete a list of entries
+ *
+ * TakeStale() is called with the lock held; Close() without it.  The
+ * idle list is in release order, so the expired ones are its tail.
+ */
+
+void
+ClientApiPool::TakeStale( ClientApiPoolEntry **close )
+{
+	if( !maxIdleTime )
+	    return;
+
+	time_t old = time( 0 ) - maxIdleTime;
+	ClientApiPoolEntry **l;
+
+	for( l = &idle; *l && (*l)->released > old; l = &(*l)->next )
+	    ;
+
+	while( *l )
+	{
+	    ClientApiPoolEntry *p = *l;
+	    *l = p->next;
+	    p->next = *close;
+	    *close = p;
+	    --nIdle;
+	}
+}
+
+void
+ClientApiPool::Close( ClientApiPoolEntry *list )
+{
+	while( list )
+	{
+	    ClientApiPoolEntry *p = list;
+	    list = p->next;
+
+	    Error e;
+	    p->client->Final( &e );
+	    delete p->client;
+	    delete p;
+	}
+}
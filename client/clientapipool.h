@@ -0,0 +1,120 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+# include "clientapi.h"
+
+/*
+ * ClientApiPool - server connections kept open for reuse
+ *
+ * ClientApi::Init() costs a name lookup, a TCP connect, perhaps an SSL
+ * handshake, and the protocol exchange; Final() tears it all down.  A
+ * service making a ClientApi per request pays that every time, and
+ * ties up a server slot meanwhile.  ClientApiPool keeps the connections
+ * callers are done with, and hands them out again to callers wanting
+ * the same port, user, charset and protocol.
+ *
+ * Basic flow:
+ *
+ *	ClientApiPool pool;	// one, shared by the service's threads
+ *
+ *	// per request:
+ *
+ *	ClientApi *client = pool.Get( "ssl:perforce:1666", "build",
+ *				"", "tag=", &e );
+ *
+ *	if( !client )
+ *	    return;		// e says why
+ *
+ *	client->SetClient( "build-ws" );  // it's as the last user left it
+ *	client->SetArgv( argc, argv );
+ *	client->Run( "sync", &ui );
+ *
+ *	pool.Release( client );	// rather than Final() and delete
+ *
+ * Public methods:
+ *
+ *	ClientApiPool::Get() - an idle connection for the key, or a new one
+ *	ClientApiPool::Release() - done with a connection: keep or close it
+ *	ClientApiPool::Expire() - close connections idle too long
+ *	ClientApiPool::SetMax() - cap idle and total connections
+ *	ClientApiPool::SetMaxIdleTime() - seconds an idle connection is kept
+ *	ClientApiPool::Idle() - connections kept idle
+ *	ClientApiPool::Open() - connections idle or handed out
+ *
+ *	ClientApiPool::Setup() - (virtual) prepare a new ClientApi before
+ *		its Init(): SetProg(), SetPassword(), SetTicketFile(), etc.
+ *
+ * Get() checks an idle connection is still usable -- not Dropped(),
+ * and IsAlive(), so the server hasn't hung up on it -- before handing
+ * it out; dead ones are closed and the next tried.  Lacking one, it
+ * makes a new ClientApi: SetPort(), SetUser(), SetCharset() (if not
+ * empty), SetProtocolV() for each space separated var=value of
+ * 'protocol', Setup(), then Init().  If Init() fails, Get() returns 0.
+ *
+ * Release() closes (Final()s and deletes) a connection that has
+ * Dropped() and otherwise keeps it, most recently used first.  Past
+ * the idle cap (default 8), the least recently used is closed.
+ * Connections idle longer than SetMaxIdleTime() (default 60 seconds)
+ * are closed by Get(), Release() and Expire().
+ *
+ * With a total cap (default 0, none), Get() closes idle connections of
+ * other keys to stay within it, or waits for a Release().
+ *
+ * Threads: the pool is locked, for sharing between threads.  Each
+ * ClientApi handed out is its caller's alone until Release().  The
+ * network I/O (Init(), Final(), the health check) is done outside the
+ * lock.  Without pthreads there is no locking, and Get() never waits:
+ * at the total cap with none idle, it opens another anyway.
+ *
+ * A pooled ClientApi keeps its settings (client, cwd, ...) between
+ * uses, and GetErrors() counts from when it was opened.  Deleting the
+ * pool closes the idle connections; any not released are the caller's
+ * to Final() and delete.
+ */
+
+class ClientApiPoolEntry;
+struct ClientApiPoolSync;
+
+class ClientApiPool {
+
+    public:
+			ClientApiPool( int maxIdle = 8, int maxOpen = 0 );
+	virtual		~ClientApiPool();
+
+	ClientApi	*Get( const char *port, const char *user,
+				const char *charset, const char *protocol,
+				Error *e );
+	void		Release( ClientApi *client );
+	void		Expire();
+
+	void		SetMax( int maxIdle, int maxOpen );
+	void		SetMaxIdleTime( int seconds );
+
+	int		Idle();
+	int		Open();
+
+    protected:
+
+	virtual void	Setup( ClientApi *client ) {}
+
+    private:
+
+	void		TakeStale( ClientApiPoolEntry **close );
+	void		Close( ClientApiPoolEntry *list );
+
+	ClientApiPoolEntry *idle;	// most recently released first
+	ClientApiPoolEntry *busy;	// handed out, or being opened
+
+	int		nIdle;
+	int		nBusy;
+
+	int		maxIdle;
+	int		maxOpen;
+	int		maxIdleTime;
+
+	ClientApiPoolSync *sync;
+
+} ;
@@ -78,7 +78,9 @@ static const char long_usage[] =
 "    p4 [ options ] command [ arg ... ]\n"
 "\n"
 "    Options:\n"
-"	-b batchsize	specify a batchsize to use with -x (default 128)\n"
+"	-b batchsize	specify a batchsize to use with -x (default 128);\n"
+"			with '-x file run', the number of commands kept\n"
+"			in flight (default 1)\n"
 "	-h -?		print this message\n"
 "	-s		prepend message type to each line of server output\n"
 "	-v level	debug modes\n"
@@ -138,6 +140,9 @@ static int clientSet( int argc, char **argv, Options &, Error *e );
 static int clientTickets( int argc, char **argv, Options &, Error *e );
 static int clientIgnores( int argc, char **argv, Options &, Error *e );
 int clientReplicate( int argc, char **argv, Options & );
+int clientMux( int argc, char **argv, Options &, Error *e );
+int clientMuxForward( int argc, char **argv, int &result );
+int clientReplay( int argc, char **argv, Error *e );
 int clientInit( int argc, char **argv, Options &, int, Error *e );
 int clientInitHelp( int, Error *e );
 int clientTrustHelp( Error *e );
@@ -242,6 +247,12 @@ clientMain( int argc, char **argv, int &uidebug, Error *e )
 	if( ClientAliases::ProcessAliases( argc, argv, result, e ) )
 	    return result;
 
+	// If a 'p4 mux' is listening on $P4MUX, let it run the
+	// command over one of its warm connections.
+
+	if( clientMuxForward( argc, argv, result ) )
+	    return result;
+
 	/* Arg processing */
 
 	// Parse up options
@@ -281,6 +292,82 @@ clientSetVariables( Client &client, Options &opts )
 	if( s = opts[ 'p' ] ) client.SetPort( s );
 }
 
+void
+clientSetProtocols( Client &client, Options &opts )
+{
+	StrPtr *s;
+
+	// Any protocol settings?
+
+	for( int i = 0; s = opts.GetValue( 'Z', i ); i++ )
+	    client.SetProtocolV( s->Text() );
+
+	// -G or -R implies -Z tag -Z sendspec
+
+	if( opts[ 'G' ] || opts[ 'R' ] || opts[ Options::Field ] )
+	{
+	    client.SetProtocol( P4Tag::v_tag );
+	    client.SetProtocol( P4Tag::v_specstring );
+	}
+
+	// -M implies -Z sendspec
+	if( opts[ 'M' ] )
+	    client.SetProtocol( P4Tag::v_specstring );
+
+	// Set default api value high,  client floats with server output
+	// This high value also lets the server know that the client can 
+	// handle streams (i.e. don't change this).
+	// Ignore above,  unfortunately there are other api's using the
+	// magic 99999,  although there is server support to prevent this
+	// we shall enable streams here for older servers.
+	// The commandline client just prints to console, so the many-to-many
+	// relationship of &-maps wont break it.
+
+	client.SetProtocol( P4Tag::v_api, "99999" );
+	client.SetProtocol( P4Tag::v_enableStreams );
+	client.SetProtocol( P4Tag::v_expandAndmaps );
+
+	// Set the client program name
+	client.SetProg( "p4" );
+}
+
+ClientUser *
+clientCreateUI( Options &opts )
+{
+	StrPtr *s;
+	ClientUser *ui;
+
+	if( opts[ 's' ] )
+	    ui = new ClientUserDebug;
+	else if( opts[ 'e' ] )
+	    ui = new ClientUserDebugMsg;
+	else if( opts[ 'F' ] )
+	    ui = new ClientUserFmt( opts[ 'F' ] );
+	else if( opts[ Options::Field ] )
+	    ui = new ClientUserMunge( opts );
+	else if( opts[ 'G' ] )
+	    ui = new ClientUserPython;
+	else if( opts[ 'R' ] )
+	    ui = new ClientUserRuby;
+	else if( ( s = opts[ 'M' ] ) && ( *s == "g" ) )
+	    ui = new ClientUserPython;
+	else if( ( s = opts[ 'M' ] ) && ( *s == "r" ) )
+	    ui = new ClientUserRuby;
+	else if( ( s = opts[ 'M' ] ) && ( *s == "p" ) )
+	    ui = new ClientUserPhp;
+	else if( ( s = opts[ 'M' ] ) && ( *s == "j" ) )
+	    ui = new ClientUserJson;
+	else if( opts[ 'I' ] )
+	    ui = new ClientUserProgress( 1 );
+	else
+	    ui = new ClientUser( 1 );
+
+	if( opts[ 'q' ] )
+	    ui->SetQuiet();
+
+	return ui;
+}
+
 int
 clientPrepareEnv( Client &client, Options &opts, Enviro &enviro )
 {
@@ -445,6 +532,14 @@ clientRunCommand(
 	{
 	    return clientReplicate( argc - 1, argv + 1, opts );
 	}
+	else if( argc && !strcmp( argv[0], "mux" ) )
+	{
+	    return clientMux( argc - 1, argv + 1, opts, e );
+	}
+	else if( argc && !strcmp( argv[0], "replay" ) )
+	{
+	    return clientReplay( argc - 1, argv + 1, e );
+	}
 	else if( argc > 1 && !strcmp( argv[0], "help" ) )
 	{
 	    if( !strcmp( argv[1], "clone" ) )
@@ -476,38 +571,7 @@ clientRunCommand(
 	if( batchSize < 1 ) 
 	    batchSize = 1;
 
-	// Any protocol settings?
-
-	for( int i = 0; s = opts.GetValue( 'Z', i ); i++ )
-	    client.SetProtocolV( s->Text() );
-
-	// -G or -R implies -Z tag -Z sendspec
-
-	if( opts[ 'G' ] || opts[ 'R' ] || opts[ Options::Field ] )
-	{
-	    client.SetProtocol( P4Tag::v_tag );
-	    client.SetProtocol( P4Tag::v_specstring );
-	}
-
-	// -M implies -Z sendspec
-	if( opts[ 'M' ] )
-	    client.SetProtocol( P4Tag::v_specstring );
-
-	// Set default api value high,  client floats with server output
-	// This high value also lets the server know that the client can 
-	// handle streams (i.e. don't change this).
-	// Ignore above,  unfortunately there are other api's using the
-	// magic 99999,  although there is server support to prevent this
-	// we shall enable streams here for older servers.
-	// The commandline client just prints to console, so the many-to-many
-	// relationship of &-maps wont break it.
-
-	client.SetProtocol( P4Tag::v_api, "99999" );
-	client.SetProtocol( P4Tag::v_enableStreams );
-	client.SetProtocol( P4Tag::v_expandAndmaps );
-
-	// Set the client program name
-	client.SetProg( "p4" );
+	clientSetProtocols( client, opts );
 
     restart:
 
@@ -523,35 +587,8 @@ clientRunCommand(
 
 	ClientUser *ui;
 
-	if( !( ui = callerUI ) ) {
-
-	if( opts[ 's' ] )
-	    ui = new ClientUserDebug;
-	else if( opts[ 'e' ] )
-	    ui = new ClientUserDebugMsg;
-	else if( opts[ 'F' ] )
-	    ui = new ClientUserFmt( opts[ 'F' ] );
-	else if( opts[ Options::Field ] )
-	    ui = new ClientUserMunge( opts );
-	else if( opts[ 'G' ] )
-	    ui = new ClientUserPython;
-	else if( opts[ 'R' ] )
-	    ui = new ClientUserRuby;
-	else if( ( s = opts[ 'M' ] ) && ( *s == "g" ) )
-	    ui = new ClientUserPython;
-	else if( ( s = opts[ 'M' ] ) && ( *s == "r" ) )
-	    ui = new ClientUserRuby;
-	else if( ( s = opts[ 'M' ] ) && ( *s == "p" ) )
-	    ui = new ClientUserPhp;
-	else if( opts[ 'I' ] )
-	    ui = new ClientUserProgress( 1 );
-	else
-	    ui = new ClientUser( 1 );
-
-	if( opts[ 'q' ] )
-	    ui->SetQuiet();
-
-	}
+	if( !( ui = callerUI ) )
+	    ui = clientCreateUI( opts );
 
 	// Invoke operation in server:
 	//	if not -x, bundle up argv and send it on down.
@@ -571,9 +608,17 @@ clientRunCommand(
 	}
 	else if( argc == 1 && !strcmp( argv[0], "run" ) )
 	{
-	    // p4 -x cmdfile run: serially run multiple commands, same client
+	    // p4 -x cmdfile run: run multiple commands, same client.
+	    // With -b, keep up to batchSize commands in flight using
+	    // RunTag(), so that each doesn't pay a full round trip.
+	    // Dispatch is strictly in order, so output is too.
+
 	    commandChaining = 1;
 	    StrBuf s;
+
+	    int window = opts[ 'b' ] ? batchSize : 1;
+	    if( window > ClientTags - 1 )
+		window = ClientTags - 1;
 	    FileSys *xf = FileSys::Create( FST_TEXT );
 
 	    xf->Set( *xargsName );
@@ -610,9 +655,17 @@ clientRunCommand(
 	            for( int i = 1; i < nwords; i++ )
 		        client.translated->SetVar( "", words[ i ] );
 
-		    client.Run( words[0], ui );
-		    fflush( stdout );
-		    fflush( stderr );
+		    // Backpressure: retire the oldest command(s) before
+		    // sending another once the window is full.
+
+		    client.RunTag( words[0], ui );
+
+		    while( client.PendingTags() >= window )
+		    {
+			client.WaitTag( ui );
+			fflush( stdout );
+			fflush( stderr );
+		    }
 		}
 		else
 		{
@@ -620,6 +673,15 @@ clientRunCommand(
 		}
 	    }
 
+	    // Drain whatever is still in flight.  If a command failed
+	    // fatally or the connection dropped, commands already sent
+	    // still complete (or report the dropped connection) in order,
+	    // but no further commands are read.
+
+	    client.WaitTag();
+	    fflush( stdout );
+	    fflush( stderr );
+
 	    xf->Close( e );
 	    delete xf;
 	}
@@ -68,6 +68,12 @@
  *		Return a FileSys * to the desired file.  2 way merges
  *		return 0 for Base/Result files: only Yours/Theirs is
  *		available.
+ *		3 way merges return 0 for a file still held in memory
+ *		(see WriteTemps()).
+ *
+ *	ClientMerge::WriteTemps() - write out any files still held
+ *		in memory, so that GetBaseFile() etc. can return them.
+ *		Done before ClientUser::Resolve() is called.
  *
  *	ClientMerge::GetYourChunks()
  *	ClientMerge::GetTheirChunks()
@@ -76,6 +82,9 @@
  *		Returns the number of chunks in the merge stream.
  *		2 way merges return 0 for all.
  *
+ *	ClientMerge::GetMemSize() - bytes of the merge held in memory
+ *		rather than in temp files.
+ *
  * The actual caller of the ClientMerge class is in clientservice.cc.
  * It uses the stream handling functions to produce 2 or 4 files on
  * the client (yours/theirs, yours/theirs/base/result), and then calls
@@ -146,11 +155,15 @@ class ClientMerge : public LastChance {
 	virtual FileSys *GetTheirFile() const = 0;
 	virtual FileSys *GetResultFile() const = 0;
 
+	virtual void	WriteTemps( Error *e ) {}
+
 	virtual int	GetYourChunks() const = 0;
 	virtual int	GetTheirChunks() const = 0;
 	virtual int	GetBothChunks() const = 0;
 	virtual int	GetConflictChunks() const = 0;
 
+	virtual int	GetMemSize() const { return 0; }
+
 	virtual const StrPtr *GetMergeDigest() const { return NULL; }
 	virtual const StrPtr *GetYourDigest() const { return NULL; }
 	virtual const StrPtr *GetTheirDigest() const { return NULL; }
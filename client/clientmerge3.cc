@@ -9,6 +9,8 @@
 # include <strbuf.h>
 # include <error.h>
 # include <handler.h>
+# include <debug.h>
+# include <tunable.h>
 
 # include <filesys.h>
 # include <md5.h>
@@ -86,6 +88,12 @@ ClientMerge3::ClientMerge3( ClientUser *ui,
 
 	showAll = 0;
 
+	inMemory = 0;
+	memSize = 0;
+	memMax = 0;
+	closed = 0;
+
+	base_cvt = NULL;
 	theirs_cvt = NULL;
 	result_cvt = NULL;
 }
@@ -101,6 +109,7 @@ ClientMerge3::~ClientMerge3()
 	delete theirsMD5;
 	delete resultMD5;
 
+	delete base_cvt;
 	delete theirs_cvt;
 	delete result_cvt;
 }
@@ -133,10 +142,6 @@ ClientMerge3::Open( StrPtr *name, Error *e, CharSetCvt *cvt, int charset )
 	if( !markertab[0].Length() )
 	    SetNames( 0, 0, 0 );
 
-	// Open the various temps for writing.
-	// Figure if the first one succeeds then the others
-	// probably will, too.
-
 	yours->Set( *name );
 
 	if( charset )
@@ -147,29 +152,29 @@ ClientMerge3::Open( StrPtr *name, Error *e, CharSetCvt *cvt, int charset )
 	    result->SetContentCharSetPriv( charset );
 	}
 
-	base->MakeLocalTemp( name->Text() );
-	theirs->MakeLocalTemp( name->Text() );
-	result->MakeLocalTemp( name->Text() );
-
-	base->Open( FOM_WRITE, e );
-
-	if( e->Test() )
-	    return;
-
-	result->Perms( FPM_RW );
-	theirs->Open( FOM_WRITE, e );
-	result->Open( FOM_WRITE, e );
+	// Each temp gets its own converter, as they may be written
+	// out at different times.
 
 	if( cvt )
 	{
+	    base_cvt = cvt->Clone();
 	    theirs_cvt = cvt->Clone();
 	    result_cvt = cvt->Clone();
-
-	    base->Translator( cvt );
-	    theirs->Translator( theirs_cvt );
-	    result->Translator( result_cvt );
 	}
 
+	// Base, theirs and result start out in memory, and are only
+	// written out as temps if they get big or someone wants the
+	// files themselves (see Spill()).  With filesys.resolvemem
+	// set to 0, open the temps now.
+
+	inMemory = MemAll;
+	memSize = 0;
+	memMax = p4tunable.Get( P4TUNE_FILESYS_RESOLVEMEM );
+	closed = 0;
+
+	if( !memMax )
+	    Spill( MemAll, e );
+
 	// And zonk counters for chunks
 
 	chunksYours = 
@@ -229,9 +234,9 @@ ClientMerge3::Write( StrPtr *buf, StrPtr *bits, Error *e )
 
 	    if( showAll || b & SEL_CONF || b == SEL_ALL && oldBits & SEL_CONF )
 	    {
-		if( needNl ) result->Write( "\n", 1, e );
-		result->Write( &markertab[ marker ], e );
-		result->Write( "\n", 1, e );
+		if( needNl ) Put( result, resultMem, StrRef( "\n", 1 ), e );
+		Put( result, resultMem, markertab[ marker ], e );
+		Put( result, resultMem, StrRef( "\n", 1 ), e );
 		++markersInFile;
 	    }
 	}
@@ -257,13 +262,13 @@ ClientMerge3::Write( StrPtr *buf, StrPtr *bits, Error *e )
 
 	if( b & SEL_BASE )
 	{
-	    base->Write( buf, e );
+	    Put( base, baseMem, *buf, e );
 	    // no base digest -- can't accept it
 	}
 
 	if( b & SEL_LEG1 )
 	{
-	    theirs->Write( buf, e );
+	    Put( theirs, theirsMem, *buf, e );
 	    theirsMD5->Update( *buf );
 	}
 
@@ -280,7 +285,7 @@ ClientMerge3::Write( StrPtr *buf, StrPtr *bits, Error *e )
 
 	if( ( b & SEL_RSLT ) || showAll || b == ( SEL_BASE | SEL_CONF ) )
 	{
-	    result->Write( buf, e );
+	    Put( result, resultMem, *buf, e );
 	}
 
 	// If this block didn't end in a linefeed, we may need to add
@@ -289,14 +294,94 @@ ClientMerge3::Write( StrPtr *buf, StrPtr *bits, Error *e )
 	// line has no newline.
 
 	needNl = buf->Text()[ buf->Length() - 1 ] != '\n';
+
+	// Too big to keep in memory: write out what we have and
+	// carry on with the temps.
+
+	if( inMemory && memSize > memMax )
+	    Spill( MemAll, e );
+}
+
+void
+ClientMerge3::Put( FileSys *f, StrBuf &mem, const StrPtr &buf, Error *e )
+{
+	if( !inMemory )
+	{
+	    f->Write( &buf, e );
+	    return;
+	}
+
+	mem.Append( &buf );
+	memSize += buf.Length();
+}
+
+/*
+ * ClientMerge3::Spill() - write out temps still held in memory
+ *
+ * 'p4 resolve -am' over many small files only ever needs the one
+ * file it accepts (or none, for yours or skip), so the others are
+ * never created.  Editors, diff, merge tools and ClientUser::Resolve()
+ * overrides get real files: Resolve() and WriteTemps() spill
+ * everything.  Before Close() the temps are left open for Write().
+ */
+
+void
+ClientMerge3::Spill( int which, Error *e )
+{
+	which &= inMemory;
+	inMemory &= ~which;
+
+	if( which & MemBase )
+	    SpillFile( base, baseMem, base_cvt, e );
+
+	// Figure if the first one succeeds then the others
+	// probably will, too.
+
+	if( e->Test() )
+	    return;
+
+	if( which & MemTheirs )
+	    SpillFile( theirs, theirsMem, theirs_cvt, e );
+
+	if( which & MemResult )
+	{
+	    result->Perms( FPM_RW );
+	    SpillFile( result, resultMem, result_cvt, e );
+	}
+}
+
+void
+ClientMerge3::SpillFile( FileSys *f, StrBuf &mem, CharSetCvt *cvt, Error *e )
+{
+	f->MakeLocalTemp( yours->Name() );
+	f->Open( FOM_WRITE, e );
+
+	if( e->Test() )
+	    return;
+
+	if( cvt )
+	    f->Translator( cvt );
+
+	if( mem.Length() )
+	    f->Write( &mem, e );
+
+	if( closed )
+	    f->Close( e );
+
+	mem.Reset();
 }
 
 void
 ClientMerge3::Close( Error *e )
 {
-	base->Close( e );
-	theirs->Close( e );
-	result->Close( e );
+	closed = 1;
+
+	if( !inMemory )
+	{
+	    base->Close( e );
+	    theirs->Close( e );
+	    result->Close( e );
+	}
 
 	theirsMD5->Final( theirsDigest );
 	yoursMD5->Final( yoursDigest );
@@ -416,6 +501,13 @@ ClientMerge3::Resolve( Error *e )
 	/* marks it as a "copy" and we know the files are now identical. */
 	/* Note that this silently swallows chunksBoth... */
 
+	/* The user's tools need the files themselves. */
+
+	Spill( MemAll, e );
+
+	if( e->Test() )
+	    return CMS_SKIP;
+
 	/* get autoresolve's suggestion */
 
 	MergeStatus autoStat = AutoResolve( CMF_FORCE );
@@ -611,6 +703,11 @@ ClientMerge3::Select( MergeStatus stat, Error *e )
 	{
 	case CMS_THEIRS:
 	    // accept theirs
+	    Spill( MemTheirs, e );
+
+	    if( e->Test() )
+	        return;
+
 	    theirs->Chmod( FPM_RW, e );
 	    theirs->Rename( yours, e );
 
@@ -628,6 +725,11 @@ ClientMerge3::Select( MergeStatus stat, Error *e )
 	case CMS_MERGED:
 	case CMS_EDIT:
 	    // accept result
+	    Spill( MemResult, e );
+
+	    if( e->Test() )
+	        return;
+
 	    result->Rename( yours, e );
 
 	    if( e->Test() )
@@ -654,6 +756,33 @@ ClientMerge3::CheckForMarkers( FileSys *f, Error *e ) const
 
 	int markers = 0;
 
+	// Result not written out: look in memory
+
+	if( f == result && ( inMemory & MemResult ) )
+	{
+	    const char *p = resultMem.Text();
+	    const char *end = p + resultMem.Length();
+
+	    while( !markers && p < end )
+	    {
+		const char *nl = (const char *)memchr( p, '\n', end - p );
+		if( !nl ) nl = end;
+
+		if( nl > p && strchr( "<>==", *p ) )
+		{
+		    l1.Set( p, nl - p );
+
+		    for( int i = 0; i < MarkerLast; i++ )
+			if( l1 == markertab[ i ] )
+			    ++markers;
+		}
+
+		p = nl + 1;
+	    }
+
+	    return markers > 0;
+	}
+
 	f->Open( FOM_READ, e );
 
 	if( e->Test() )
@@ -695,18 +824,28 @@ ClientMerge3::DetectResolve() const
 	Error e[1];
 	CharSetCvt *icvt = 0;
 
-	if( result_cvt )
-	{
-	    icvt = result_cvt->ReverseCvt();
-	    result->Translator( icvt );
-	}
-
 	// Get & Compare digest of result against various legs
 	// Blow off errors -- if we can't get to the result we'll
 	// find out sooner or later.
+	// A result still in memory is as sent (untranslated).
 
-	result->Digest( &d, e );
-	delete icvt;
+	if( inMemory & MemResult )
+	{
+	    MD5 md5;
+	    md5.Update( resultMem );
+	    md5.Final( d );
+	}
+	else
+	{
+	    if( result_cvt )
+	    {
+		icvt = result_cvt->ReverseCvt();
+		result->Translator( icvt );
+	    }
+
+	    result->Digest( &d, e );
+	    delete icvt;
+	}
 
 	if( d == theirsDigest ) 	return CMS_THEIRS;
 	else if( d == yoursDigest ) 	return CMS_YOURS;
@@ -714,6 +853,32 @@ ClientMerge3::DetectResolve() const
 	else 				return CMS_EDIT;
 }
 
+/*
+ * ClientMerge3::GetBaseFile() etc. - the temps, once written out
+ *
+ * One still held in memory isn't a file yet: that's 0, as for a
+ * 2 way merge's base, until WriteTemps() (which reports any error
+ * writing it) has been called.
+ */
+
+FileSys *
+ClientMerge3::GetBaseFile() const
+{
+	return inMemory & MemBase ? 0 : base;
+}
+
+FileSys *
+ClientMerge3::GetTheirFile() const
+{
+	return inMemory & MemTheirs ? 0 : theirs;
+}
+
+FileSys *
+ClientMerge3::GetResultFile() const
+{
+	return inMemory & MemResult ? 0 : result;
+}
+
 const StrPtr *
 ClientMerge3::GetMergeDigest() const
 {
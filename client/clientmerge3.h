@@ -23,16 +23,20 @@ class ClientMerge3 : public ClientMerge {
 
 	virtual int	IsAcceptable() const;
 
-	virtual FileSys *GetBaseFile() const { return base; }
+	virtual FileSys *GetBaseFile() const;
 	virtual FileSys *GetYourFile() const { return yours; }
-	virtual FileSys *GetTheirFile() const { return theirs; }
-	virtual FileSys *GetResultFile() const { return result; }
+	virtual FileSys *GetTheirFile() const;
+	virtual FileSys *GetResultFile() const;
+
+	virtual void	WriteTemps( Error *e ) { Spill( MemAll, e ); }
 
 	virtual int	GetYourChunks() const { return chunksYours; }
 	virtual int	GetTheirChunks() const { return chunksTheirs; }
 	virtual int	GetBothChunks() const { return chunksBoth; }
 	virtual int	GetConflictChunks() const { return chunksConflict; }
 
+	virtual int	GetMemSize() const { return inMemory ? memSize : 0; }
+
 	virtual void	Open( StrPtr *name, Error *e, CharSetCvt * = 0,
 				int charset = 0 );
 	virtual void	Write( StrPtr *buf, StrPtr *bits, Error *e );
@@ -64,6 +68,13 @@ class ClientMerge3 : public ClientMerge {
 		MarkerLast
 	} ;
 
+	enum MemFile3 {
+		MemBase = 0x01,	// base still only in baseMem
+		MemTheirs = 0x02,	// theirs still only in theirsMem
+		MemResult = 0x04,	// result still only in resultMem
+		MemAll = 0x07
+	} ;
+
 	StrBuf		markertab[ MarkerLast ];
 
 	FileSys *	yours;
@@ -92,6 +103,24 @@ class ClientMerge3 : public ClientMerge {
 
 	int		CheckForMarkers( FileSys *f, Error *e ) const;
 
+	void		Put( FileSys *f, StrBuf &mem, const StrPtr &buf,
+				Error *e );
+	void		Spill( int which, Error *e );
+	void		SpillFile( FileSys *f, StrBuf &mem, CharSetCvt *cvt,
+				Error *e );
+
+	// Small merges are held in memory until a file is needed.
+
+	int		inMemory;	// MemFile3 bits
+	int		memSize;
+	int		memMax;
+	int		closed;
+
+	StrBuf		baseMem;
+	StrBuf		theirsMem;
+	StrBuf		resultMem;
+
+	CharSetCvt	*base_cvt;
 	CharSetCvt	*theirs_cvt;
 	CharSetCvt	*result_cvt;
 } ;
@@ -0,0 +1,269 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * clientmergepipe.cc - finish 'resolve -a' merges on worker threads
+ */
+
+# include <stdhdrs.h>
+
+# include <strbuf.h>
+# include <strdict.h>
+# include <strtable.h>
+# include <error.h>
+# include <handler.h>
+# include <rpc.h>
+# include <debug.h>
+# include <tunable.h>
+# include <threadpool.h>
+
+# include <p4tags.h>
+
+# include <filesys.h>
+
+# include "clientuser.h"
+# include "clientmerge.h"
+# include "client.h"
+# include "clientmergepipe.h"
+
+/*
+ * ClientMergeJob - one merge, and what to tell the server about it
+ *
+ * Run() on a worker does what clientCloseMerge() would have done
+ * after AutoResolve(): make yours writable, move the chosen file into
+ * place, and put the permissions back.
+ */
+
+class ClientMergeJob : public ThreadTask {
+
+    public:
+			ClientMergeJob()
+			{
+			    merge = 0;
+			    chmod = 0;
+			    memory = 0;
+			    next = 0;
+			}
+
+			~ClientMergeJob()
+			{
+			    delete merge;
+			}
+
+	void		Run( ThreadScratch *scratch );
+
+	ClientMerge	*merge;
+	MergeStatus	stat;
+
+	StrBufDict	vars;		// sent with the confirm
+	StrBuf		handle;
+	StrBuf		path;		// yours
+	StrBuf		confirm;
+	StrBuf		decline;
+	StrBuf		perms;
+	int		chmod;
+
+	Error		e;
+	int		memory;
+
+	ClientMergeJob	*next;
+
+} ;
+
+void
+ClientMergeJob::Run( ThreadScratch * )
+{
+	if( chmod )
+	    merge->Chmod( "rw", &e );
+
+	if( !e.Test() )
+	    merge->Select( stat, &e );
+
+	if( !e.Test() && chmod )
+	    merge->Chmod( perms.Text(), &e );
+}
+
+/*
+ * ClientMergePipe
+ */
+
+ClientMergePipe::ClientMergePipe( Client *client, int threads )
+{
+	this->client = client;
+
+	pool = new ThreadPool( threads );
+	head = tail = 0;
+	count = 0;
+	memory = 0;
+	retiring = 0;
+
+	maxFiles = p4tunable.Get( P4TUNE_FILESYS_RESOLVE_MAXFILES );
+	maxMemory = p4tunable.Get( P4TUNE_FILESYS_RESOLVE_MAXMEM );
+}
+
+ClientMergePipe::~ClientMergePipe()
+{
+	// Too late to tell the server: just let the workers finish.
+
+	while( head )
+	{
+	    ClientMergeJob *j = head;
+	    head = j->next;
+	    j->Wait();
+	    delete j;
+	}
+
+	delete pool;
+}
+
+/*
+ * ClientMergePipe::Queue() - finish a merge, later confirming it
+ *
+ * 'results' holds the variables clientCloseMerge() worked out to send
+ * with the confirm (mergeHow, digest...); the variables of the message
+ * being handled follow them, as Client::Confirm() would send.  The
+ * merge is taken off 'handle', and deleted once confirmed.
+ */
+
+void
+ClientMergePipe::Queue( ClientMerge *merge, MergeStatus stat,
+	StrDict *results, const StrPtr *handle, const StrPtr *confirm,
+	const StrPtr *decline, const StrPtr *perms )
+{
+	ClientMergeJob *j = new ClientMergeJob;
+	StrRef var, val;
+	int i;
+
+	for( i = 0; results->GetVar( i, var, val ); i++ )
+	    j->vars.SetVar( var, val );
+
+	for( i = 0; client->GetVar( i, var, val ); i++ )
+	{
+	    if( var == P4Tag::v_data || var == P4Tag::v_func )
+		continue;
+
+	    j->vars.SetVar( var, val );
+	}
+
+	j->stat = stat;
+	j->handle.Set( handle );
+	j->confirm.Set( confirm );
+	j->decline.Set( decline );
+
+	if( perms )
+	{
+	    j->perms.Set( perms );
+	    j->chmod = 1;
+	}
+
+	j->memory = merge->GetMemSize();
+
+	if( merge->GetYourFile() )
+	    j->path.Set( merge->GetYourFile()->Name() );
+
+	merge->Detach();
+	j->merge = merge;
+
+	// Make room: a merge held in memory may well be bigger than
+	// the limit, but always let one through.
+
+	while( head && ( count >= maxFiles || memory + j->memory > maxMemory ) )
+	    RetireOne();
+
+	if( tail )
+	    tail->next = j;
+	else
+	    head = j;
+
+	tail = j;
+	++count;
+	memory += j->memory;
+
+	pool->Submit( j );
+
+	Retire();
+}
+
+/*
+ * ClientMergePipe::Retire() - send the confirms of finished merges
+ * ClientMergePipe::Drain() - wait for all merges (or those up to the
+ *	last of a file), sending confirms
+ */
+
+void
+ClientMergePipe::Retire()
+{
+	while( head && !retiring && head->Done() )
+	    RetireOne();
+}
+
+void
+ClientMergePipe::Drain()
+{
+	while( head && !retiring )
+	    RetireOne();
+}
+
+void
+ClientMergePipe::Drain( const StrPtr *path )
+{
+	ClientMergeJob *last = 0;
+
+	for( ClientMergeJob *j = head; j; j = j->next )
+	    if( j->path == *path )
+		last = j;
+
+	while( last && !retiring )
+	{
+	    int done = head == last;
+	    RetireOne();
+	    if( done )
+		break;
+	}
+}
+
+void
+ClientMergePipe::RetireOne()
+{
+	ClientMergeJob *j = head;
+
+	j->Wait();
+
+	head = j->next;
+	if( !head )
+	    tail = 0;
+
+	--count;
+	memory -= j->memory;
+
+	// As clientCloseMerge(): decline if moving the file failed,
+	// or if the pool dropped the job, marking the handle as the
+	// merge would have (it's off the handle now).  Our own
+	// SetVar()/Invoke() mustn't come back here.
+
+	int failed = !j->Ran() || j->e.Test() || j->merge->IsError();
+
+	if( failed )
+	{
+	    Error e;
+	    client->handles.SetError( &j->handle, &e );
+	}
+
+	StrRef var, val;
+
+	retiring = 1;
+
+	for( int i = 0; j->vars.GetVar( i, var, val ); i++ )
+	    client->SetVar( var, val );
+
+	client->Invoke( failed ? j->decline.Text() : j->confirm.Text() );
+
+	retiring = 0;
+
+	client->OutputError( &j->e );
+
+	delete j;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * clientmergepipe.h - finish 'resolve -a' merges on worker threads
+ *
+ * With 'p4 resolve -am' (-as, -af, -at, -ay) clientCloseMerge() needs
+ * nothing from the user: just the chosen file moved into place (the
+ * result written out and renamed over yours, or theirs, or nothing)
+ * and a confirm sent back to the server.  Rather than doing the file
+ * work before reading the server's next file, clientCloseMerge() hands
+ * the merge to a ClientMergePipe, whose worker threads finish it while
+ * the dispatch thread carries on.
+ *
+ * Confirms go back in the order the merges arrived: a merge's confirm
+ * is sent once it and every merge ahead of it are finished.  Errors
+ * are reported then, too, and mark the merge's handle as they would
+ * have.  A merge the pool dropped (cancelled) is declined.  Before
+ * anything else goes to the server (Client::VSetVar(), Invoke(),
+ * Confirm()), and at the end of the command, the pipe is drained, so
+ * the server sees replies in the same order as before.
+ *
+ * Handlers that touch client files drain the pipe first, so none sees
+ * a file half moved into place; clientOpenMerge() waits only for a
+ * merge of the same file.
+ *
+ * The merges waiting are bounded by filesys.resolve.maxfiles, and the
+ * merge data they hold in memory by filesys.resolve.maxmem; when full,
+ * Queue() waits for the oldest first.  filesys.resolve.threads sets
+ * the number of workers; 0 leaves clientCloseMerge() to do it all.
+ *
+ * Classes defined:
+ *
+ *	ClientMergePipe - merges being finished, in arrival order
+ *
+ * Public methods:
+ *
+ *	ClientMergePipe::Queue() - finish a merge, later confirming it
+ *	ClientMergePipe::Retire() - send the confirms of finished merges
+ *	ClientMergePipe::Drain() - wait for all merges (or those up to the
+ *		last of a file), sending confirms
+ *	ClientMergePipe::Pending() - merges not yet confirmed
+ */
+
+class Client;
+class ClientMerge;
+class ClientMergeJob;
+class ThreadPool;
+
+class ClientMergePipe {
+
+    public:
+			ClientMergePipe( Client *client, int threads );
+			~ClientMergePipe();
+
+	void		Queue( ClientMerge *merge, MergeStatus stat,
+				StrDict *results, const StrPtr *handle,
+				const StrPtr *confirm,
+				const StrPtr *decline, const StrPtr *perms );
+
+	void		Retire();
+	void		Drain();
+	void		Drain( const StrPtr *path );
+
+	int		Pending() { return count; }
+
+    private:
+
+	void		RetireOne();
+
+	Client		*client;
+	ThreadPool	*pool;
+
+	ClientMergeJob	*head;		// oldest, next to confirm
+	ClientMergeJob	*tail;
+	int		count;
+	int		memory;
+	int		retiring;	// sending: don't drain again
+
+	int		maxFiles;
+	int		maxMemory;
+
+} ;
@@ -0,0 +1,1042 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * clientmux.cc - 'p4 mux', a local connection multiplexer
+ *
+ * 'p4 mux' listens on a unix domain socket and keeps a small pool of
+ * warm (connected, handshaken, trusted) Client connections, keyed by
+ * port, user, client, charset and the protocol options that must be
+ * set before Init().
+ *
+ * When P4MUX names that socket, later 'p4' invocations forward their
+ * cwd, their P4* environment, their argv and their stdin/stdout/stderr
+ * file descriptors (passed with SCM_RIGHTS) to the multiplexer, which
+ * runs the command on a pooled connection writing directly to the
+ * caller's stdio, and sends back the exit status.  The caller pays one
+ * local round trip instead of a connect and handshake.
+ *
+ * Commands change the process's cwd, environment and stdio, so they
+ * can't share a process: the multiplexer forks worker processes (-w,
+ * default 4), each accepting on the socket, serving one command at a
+ * time and keeping its own pool (-m connections each).  A slow command
+ * holds up only its own worker.  Only callers running as our own user
+ * are served.  Anything that is handled
+ * locally by clientMain() (set, tickets, merge3, aliases, -x, -h, -V,
+ * -v debugging) is declined and run by the caller itself, as is
+ * everything when no multiplexer is listening.
+ *
+ * Wire format (caller -> mux):
+ *
+ *	4 byte body length (little endian), sent with the 3 stdio fds
+ *	body: a series of "tag\0value\0" pairs, where tag is
+ *		c - caller's cwd
+ *		e - NAME=value environment setting
+ *		a - next argv element
+ *
+ * The body is at most MUX_MAXBODY bytes; a caller with more runs the
+ * command itself.
+ *
+ * Reply (mux -> caller): 'd' (declined), or 'r' and a 4 byte status.
+ *
+ * Public functions:
+ *
+ *	clientMux() - the 'p4 mux' command
+ *	clientMuxForward() - send a command to a running 'p4 mux'
+ */
+
+# define NEED_CHDIR
+# define NEED_ERRNO
+# define NEED_FCNTL
+# define NEED_FILE
+# define NEED_FORK
+# define NEED_GETUID
+# define NEED_SIGNAL
+# define NEED_SOCKETPAIR
+
+# include <stdhdrs.h>
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <sys/stat.h>
+# include <poll.h>
+# endif
+
+# include <strbuf.h>
+# include <strdict.h>
+# include <strtable.h>
+# include <strarray.h>
+# include <vararray.h>
+# include <error.h>
+# include <errorlog.h>
+# include <options.h>
+# include <handler.h>
+# include <keepalive.h>
+# include <enviro.h>
+# include <hostenv.h>
+# include <rpc.h>
+# include <p4tags.h>
+# include <pathsys.h>
+# include <filesys.h>
+# include <md5.h>
+
+# include "client.h"
+# include "clientuser.h"
+# include "clientuserdbg.h"
+# include "clientaliases.h"
+
+extern char **environ;
+
+static ErrorId muxUsage = { ErrorOf( 0, 0, E_FAILED, 0, 0 ),
+	"p4 mux [ -s socket ][ -m max ][ -w workers ]" };
+
+static ErrorId muxRunning = { ErrorOf( 0, 0, E_FATAL, 0, 1 ),
+	"A 'p4 mux' is already listening on %socket%." };
+
+static ErrorId muxNotOurs = { ErrorOf( 0, 0, E_FATAL, 0, 1 ),
+	"%socket% exists and is not a socket of ours: not replacing it." };
+
+static ErrorId muxNoSocket = { ErrorOf( 0, 0, E_FATAL, 0, 0 ),
+	"No socket given: use -s or set P4MUX." };
+
+static ErrorId muxLost = { ErrorOf( 0, 0, E_FATAL, 0, 0 ),
+	"Lost connection to 'p4 mux'." };
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+
+# define MUX_MAXBODY	( 4 * 1024 * 1024 )
+
+/*
+ * Low level socket helpers
+ */
+
+static void
+MuxPutInt( StrBuf &b, int v )
+{
+	char *p = b.Alloc( 4 );
+	p[0] = ( v >>  0 ) & 0xff;
+	p[1] = ( v >>  8 ) & 0xff;
+	p[2] = ( v >> 16 ) & 0xff;
+	p[3] = ( v >> 24 ) & 0xff;
+}
+
+static int
+MuxGetInt( const char *p )
+{
+	return ( p[0] & 0xff ) |
+	       ( p[1] & 0xff ) << 8 |
+	       ( p[2] & 0xff ) << 16 |
+	       ( p[3] & 0xff ) << 24;
+}
+
+static int
+MuxWrite( int fd, const char *buf, int len )
+{
+	while( len > 0 )
+	{
+	    int l = write( fd, buf, len );
+	    if( l < 0 && errno == EINTR )
+		continue;
+	    if( l <= 0 )
+		return 0;
+	    buf += l;
+	    len -= l;
+	}
+	return 1;
+}
+
+static int
+MuxRead( int fd, char *buf, int len )
+{
+	while( len > 0 )
+	{
+	    int l = read( fd, buf, len );
+	    if( l < 0 && errno == EINTR )
+		continue;
+	    if( l <= 0 )
+		return 0;
+	    buf += l;
+	    len -= l;
+	}
+	return 1;
+}
+
+static int
+MuxAddress( const StrPtr &path, struct sockaddr_un &sun )
+{
+	memset( &sun, 0, sizeof( sun ) );
+	sun.sun_family = AF_UNIX;
+
+	if( path.Length() >= (int)sizeof( sun.sun_path ) )
+	    return 0;
+
+	memcpy( sun.sun_path, path.Text(), path.Length() );
+	return 1;
+}
+
+static int
+MuxConnect( const StrPtr &path )
+{
+	struct sockaddr_un sun;
+
+	if( !MuxAddress( path, sun ) )
+	    return -1;
+
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+	if( fd < 0 )
+	    return -1;
+
+	if( connect( fd, (struct sockaddr *)&sun, sizeof( sun ) ) < 0 )
+	{
+	    close( fd );
+	    return -1;
+	}
+
+	return fd;
+}
+
+/*
+ * MuxPeerOk() - is the caller on fd running as our own user?
+ *
+ * Where the peer's credentials can't be had, the socket's 0700 mode
+ * is all that keeps others out.
+ */
+
+static int
+MuxPeerOk( int fd )
+{
+# if defined( SO_PEERCRED )
+	struct ucred cred;
+	socklen_t len = sizeof( cred );
+
+	if( getsockopt( fd, SOL_SOCKET, SO_PEERCRED, &cred, &len ) < 0 )
+	    return 0;
+
+	return cred.uid == geteuid();
+# elif defined( OS_DARWIN ) || defined( OS_MACOSX ) || \
+	defined( OS_FREEBSD ) || defined( OS_NETBSD ) || \
+	defined( OS_OPENBSD )
+	uid_t uid;
+	gid_t gid;
+
+	if( getpeereid( fd, &uid, &gid ) < 0 )
+	    return 0;
+
+	return uid == geteuid();
+# else
+	return 1;
+# endif
+}
+
+/*
+ * MuxKeepAlive - break the running command if the caller goes away
+ */
+
+class MuxKeepAlive : public KeepAlive {
+
+    public:
+			MuxKeepAlive( int f ) { fd = f; }
+
+	int		IsAlive()
+			{
+			    // The caller never writes after its request,
+			    // so any readability means hangup.
+
+			    struct pollfd p;
+			    p.fd = fd;
+			    p.events = POLLIN;
+			    p.revents = 0;
+			    return poll( &p, 1, 0 ) == 0;
+			}
+
+    private:
+	int		fd;
+} ;
+
+/*
+ * ClientMux - the 'p4 mux' server and its connection pool
+ */
+
+struct MuxConn {
+	StrBuf		key;
+	Client		*client;
+	int		lastUse;
+} ;
+
+class ClientMux {
+
+    public:
+			ClientMux( int max );
+			~ClientMux();
+
+	void		Listen( const StrPtr &path, Error *e );
+	void		Serve( int workers );
+
+    private:
+	void		Accept();
+	void		Serve1( int fd );
+	int		Run( int argc, char **argv, const StrPtr &cwd,
+			     KeepAlive *k, int &declined );
+
+	Client		*Find( const StrPtr &key );
+	void		Keep( const StrPtr &key, Client *client );
+	void		Drop( Client *client );
+
+	VarArray	conns;
+	int		maxConns;
+	int		tick;
+	int		sock;
+	StrBuf		path;
+	pid_t		owner;		// unlinks path on the way out
+	pid_t		supervisor;	// workers' parent, if forked
+} ;
+
+ClientMux::ClientMux( int max )
+{
+	maxConns = max;
+	tick = 0;
+	sock = -1;
+	owner = 0;
+	supervisor = 0;
+}
+
+ClientMux::~ClientMux()
+{
+	while( conns.Count() )
+	    Drop( ( (MuxConn *)conns.Get( 0 ) )->client );
+
+	if( sock >= 0 )
+	    close( sock );
+
+	if( owner == getpid() )
+	    unlink( path.Text() );
+}
+
+Client *
+ClientMux::Find( const StrPtr &key )
+{
+	for( int i = 0; i < conns.Count(); i++ )
+	{
+	    MuxConn *c = (MuxConn *)conns.Get( i );
+
+	    if( c->key != key )
+		continue;
+
+	    // Stale?  The server may have timed us out.
+
+	    if( c->client->Dropped() )
+	    {
+		Drop( c->client );
+		return 0;
+	    }
+
+	    c->lastUse = ++tick;
+	    return c->client;
+	}
+
+	return 0;
+}
+
+void
+ClientMux::Keep( const StrPtr &key, Client *client )
+{
+	// Evict the least recently used connection if full.
+
+	if( conns.Count() >= maxConns )
+	{
+	    MuxConn *lru = (MuxConn *)conns.Get( 0 );
+
+	    for( int i = 1; i < conns.Count(); i++ )
+	    {
+		MuxConn *c = (MuxConn *)conns.Get( i );
+		if( c->lastUse < lru->lastUse )
+		    lru = c;
+	    }
+
+	    Drop( lru->client );
+	}
+
+	MuxConn *c = new MuxConn;
+	c->key.Set( key );
+	c->client = client;
+	c->lastUse = ++tick;
+	conns.Put( c );
+}
+
+void
+ClientMux::Drop( Client *client )
+{
+	for( int i = 0; i < conns.Count(); i++ )
+	{
+	    MuxConn *c = (MuxConn *)conns.Get( i );
+
+	    if( c->client != client )
+		continue;
+
+	    conns.Remove( i );
+	    delete c;
+	    break;
+	}
+
+	Error e;
+	client->Final( &e );
+	delete client;
+}
+
+void
+ClientMux::Listen( const StrPtr &p, Error *e )
+{
+	struct sockaddr_un sun;
+
+	path.Set( p );
+
+	if( !MuxAddress( path, sun ) )
+	{
+	    e->Sys( "bind", path.Text() );
+	    return;
+	}
+
+	// Refuse to steal a live socket; clear away a stale one.
+
+	int fd = MuxConnect( path );
+
+	if( fd >= 0 )
+	{
+	    close( fd );
+	    e->Set( muxRunning ) << path;
+	    return;
+	}
+
+	// Only a socket we made ourselves is cleared away: path may
+	// have been pointed at something else.
+
+	struct stat st;
+
+	if( !lstat( path.Text(), &st ) )
+	{
+	    if( !S_ISSOCK( st.st_mode ) || st.st_uid != geteuid() )
+	    {
+		e->Set( muxNotOurs ) << path;
+		return;
+	    }
+
+	    unlink( path.Text() );
+	}
+
+	if( ( sock = socket( AF_UNIX, SOCK_STREAM, 0 ) ) < 0 )
+	{
+	    e->Sys( "socket", path.Text() );
+	    return;
+	}
+
+	// Only our own user may hand us commands to run.
+
+	mode_t omask = umask( 077 );
+	int r = bind( sock, (struct sockaddr *)&sun, sizeof( sun ) );
+	umask( omask );
+
+	if( r < 0 || listen( sock, 16 ) < 0 )
+	{
+	    e->Sys( "bind", path.Text() );
+	    close( sock );
+	    sock = -1;
+	    return;
+	}
+
+	owner = getpid();
+}
+
+/*
+ * ClientMux::Serve() - run workers until the socket fails
+ * ClientMux::Accept() - a worker: take callers one at a time
+ *
+ * With one worker we serve in this process.  Otherwise we fork the
+ * workers and wait, replacing any that crash; a worker that returns
+ * found the socket unusable, and we stop.  Workers poll, so they go
+ * when we do.
+ */
+
+void
+ClientMux::Serve( int workers )
+{
+	// Callers that go away must not take us with them.
+
+	signal( SIGPIPE, SIG_IGN );
+
+	if( workers <= 1 )
+	{
+	    Accept();
+	    return;
+	}
+
+	// Workers woken for a caller another took mustn't block in
+	// accept().
+
+	fcntl( sock, F_SETFL, fcntl( sock, F_GETFL, 0 ) | O_NONBLOCK );
+
+	int running = 0;
+	pid_t self = getpid();
+
+	for( ;; )
+	{
+	    while( running < workers )
+	    {
+		pid_t pid = fork();
+
+		if( !pid )
+		{
+		    supervisor = self;
+		    Accept();
+		    return;
+		}
+
+		if( pid < 0 )
+		    break;
+
+		++running;
+	    }
+
+	    if( !running )
+		return;
+
+	    int status;
+
+	    if( waitpid( -1, &status, 0 ) < 0 )
+	    {
+		if( errno == EINTR )
+		    continue;
+		return;
+	    }
+
+	    --running;
+
+	    if( WIFEXITED( status ) )
+		return;
+	}
+}
+
+void
+ClientMux::Accept()
+{
+	for( ;; )
+	{
+	    if( supervisor )
+	    {
+		struct pollfd p;
+		p.fd = sock;
+		p.events = POLLIN;
+		p.revents = 0;
+
+		int n = poll( &p, 1, 1000 );
+
+		if( getppid() != supervisor )
+		    break;
+
+		if( n <= 0 )
+		    continue;
+	    }
+
+	    int fd = accept( sock, 0, 0 );
+
+	    if( fd < 0 )
+	    {
+		if( errno == EINTR || errno == EAGAIN ||
+		    errno == EWOULDBLOCK || errno == ECONNABORTED )
+		    continue;
+		break;
+	    }
+
+	    // Some systems pass the listener's O_NONBLOCK on.
+
+	    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0 ) & ~O_NONBLOCK );
+
+	    // Others are told to run it themselves.
+
+	    if( MuxPeerOk( fd ) )
+		Serve1( fd );
+	    else
+		MuxWrite( fd, "d", 1 );
+
+	    close( fd );
+	}
+}
+
+void
+ClientMux::Serve1( int fd )
+{
+	// Read the length, along with the caller's stdio.
+
+	char hdr[4];
+	int fds[3];
+	char cbuf[ CMSG_SPACE( sizeof( fds ) ) ];
+	struct iovec iov;
+	struct msghdr msg;
+
+	memset( &msg, 0, sizeof( msg ) );
+	iov.iov_base = hdr;
+	iov.iov_len = sizeof( hdr );
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof( cbuf );
+
+	if( recvmsg( fd, &msg, 0 ) != sizeof( hdr ) )
+	    return;
+
+	struct cmsghdr *cm = CMSG_FIRSTHDR( &msg );
+
+	if( !cm || cm->cmsg_level != SOL_SOCKET ||
+	    cm->cmsg_type != SCM_RIGHTS ||
+	    cm->cmsg_len != CMSG_LEN( sizeof( fds ) ) )
+	    return;
+
+	memcpy( fds, CMSG_DATA( cm ), sizeof( fds ) );
+
+	// Read the body and pick it apart.
+
+	StrBuf body;
+	int len = MuxGetInt( hdr );
+
+	if( len < 0 || len > MUX_MAXBODY )
+	{
+	    close( fds[0] ); close( fds[1] ); close( fds[2] );
+	    MuxWrite( fd, "d", 1 );
+	    return;
+	}
+
+	if( !MuxRead( fd, body.Alloc( len ), len ) )
+	{
+	    close( fds[0] ); close( fds[1] ); close( fds[2] );
+	    return;
+	}
+
+	body.Terminate();
+
+	StrBuf cwd;
+	StrBufDict env;
+	VarArray args;
+
+	for( const char *p = body.Text(), *end = p + len; p < end; )
+	{
+	    const char *tag = p;
+	    const char *val = tag + strlen( tag ) + 1;
+
+	    if( val >= end )
+		break;
+
+	    p = val + strlen( val ) + 1;
+
+	    if( *tag == 'c' )
+		cwd.Set( val );
+	    else if( *tag == 'e' )
+		env.SetVarV( val );
+	    else if( *tag == 'a' )
+		args.Put( (void *)val );
+	}
+
+	// Take on the caller's P4* environment, replacing ours.
+
+	StrArray names;
+	for( char **ep = environ; *ep; ep++ )
+	    if( !strncmp( *ep, "P4", 2 ) || !strncmp( *ep, "PWD=", 4 ) )
+		names.Put()->Set( *ep, strcspn( *ep, "=" ) );
+
+	for( int i = 0; i < names.Count(); i++ )
+	    unsetenv( names.Get( i )->Text() );
+
+	StrRef var, val;
+	for( int i = 0; env.GetVar( i, var, val ); i++ )
+	    setenv( var.Text(), val.Text(), 1 );
+
+	// Run with the caller's stdio in place of ours.
+
+	int saved[3];
+	int declined = 0;
+	int status = 1;
+
+	fflush( stdout );
+	fflush( stderr );
+
+	for( int i = 0; i < 3; i++ )
+	{
+	    saved[i] = dup( i );
+	    dup2( fds[i], i );
+	    close( fds[i] );
+	}
+
+	if( chdir( cwd.Text() ) >= 0 )
+	{
+	    char **argv = new char *[ args.Count() + 1 ];
+
+	    for( int i = 0; i < args.Count(); i++ )
+		argv[i] = (char *)args.Get( i );
+
+	    argv[ args.Count() ] = 0;
+
+	    MuxKeepAlive keep( fd );
+	    status = Run( args.Count(), argv, cwd, &keep, declined );
+
+	    delete []argv;
+	}
+	else
+	{
+	    Error e;
+	    e.Sys( "chdir", cwd.Text() );
+	    AssertLog.Report( &e );
+	}
+
+	fflush( stdout );
+	fflush( stderr );
+
+	for( int i = 0; i < 3; i++ )
+	{
+	    dup2( saved[i], i );
+	    close( saved[i] );
+	}
+
+	// Reply.
+
+	StrBuf reply;
+
+	if( declined )
+	{
+	    reply.Set( "d" );
+	}
+	else
+	{
+	    reply.Set( "r" );
+	    MuxPutInt( reply, status );
+	}
+
+	MuxWrite( fd, reply.Text(), reply.Length() );
+}
+
+int
+ClientMux::Run(
+	int argc,
+	char **argv,
+	const StrPtr &cwd,
+	KeepAlive *keep,
+	int &declined )
+{
+	Error e;
+	Options opts;
+	StrPtr *s;
+
+	clientParseOptions( opts, argc, argv, &e );
+
+	if( e.Test() )
+	{
+	    AssertLog.Report( &e );
+	    return 1;
+	}
+
+	// Leave anything clientRunCommand() doesn't simply send to the
+	// server, or that changes process-wide state, to the caller.
+
+	static const char *const local[] = {
+	    "merge3", "set", "tickets", "init", "clone", "ignores",
+	    "replicate", "replay", "trust", "mux", "help", 0
+	};
+
+	declined = !argc || opts[ 'x' ] || opts[ 'h' ] || opts[ '?' ] ||
+		   opts[ 'V' ] || opts[ 'v' ] || opts[ 'r' ];
+
+	for( int i = 0; !declined && local[i]; i++ )
+	    declined = !strcmp( argv[0], local[i] );
+
+	if( declined )
+	    return 0;
+
+	// Resolve the settings the way clientRunCommand() would, then
+	// look for a live connection made with the same ones.
+
+	Client *client = new Client;
+	Enviro enviro;
+
+	if( clientPrepareEnv( *client, opts, enviro ) )
+	{
+	    delete client;
+	    return 1;
+	}
+
+	clientSetVariables( *client, opts );
+
+	// The password only as a digest: keys outlive commands.  The
+	// ticket file's too, as a warm connection keeps the ticket it
+	// first read: after a login or logout, it mustn't be reused.
+
+	const char *c;
+	StrBuf key, pw, tickets;
+	MD5 md5;
+
+	if( ( s = opts[ 'P' ] ) )
+	    md5.Update( *s );
+	else if( ( c = client->GetEnviro()->Get( "P4PASSWD" ) ) )
+	    md5.Update( StrRef( c ) );
+
+	md5.Final( pw );
+
+	FileSys *t = FileSys::Create( FST_TEXT );
+	Error te;
+	t->Set( client->GetTicketFile() );
+	t->Digest( &tickets, &te );
+	delete t;
+
+	key << client->GetPort() << "\n"
+	    << client->GetUser() << "\n"
+	    << client->GetClientNoHost() << "\n"
+	    << client->GetCharset() << "\n"
+	    << pw << "\n"
+	    << tickets << "\n";
+
+	if( ( s = opts[ 'H' ] ) )
+	    key << *s << "\n";
+	else if( ( c = client->GetEnviro()->Get( "P4HOST" ) ) )
+	    key << c << "\n";
+	else
+	    key << "\n";
+
+	for( int i = 0; ( s = opts.GetValue( 'Z', i ) ); i++ )
+	    key << *s << "\n";
+
+	if( opts[ 'G' ] || opts[ 'R' ] || opts[ Options::Field ] )
+	    key << "tag\n";
+
+	if( opts[ 'M' ] )
+	    key << "specstring\n";
+
+	if( Client *warm = Find( key ) )
+	{
+	    delete client;
+	    client = warm;
+	    client->SetCwd( &cwd );
+	    clientSetVariables( *client, opts );
+	}
+	else
+	{
+	    clientSetProtocols( *client, opts );
+	    client->Init( &e );
+
+	    if( e.Test() )
+	    {
+		AssertLog.Report( &e );
+		delete client;
+		return 1;
+	    }
+
+	    Keep( key, client );
+	}
+
+	if( ( s = opts[ 'P' ] ) )
+	    client->SetPassword( s );
+
+	// Normal invocation, as clientRunCommand().
+
+	ClientUser *ui = clientCreateUI( opts );
+	int errors = client->GetErrors();
+
+	if( ui->CanAutoLoginPrompt() )
+	    client->SetVarV( P4Tag::v_autoLogin );
+
+	client->SetBreak( keep );
+	setVarsAndArgs( *client, argc, argv, opts );
+	client->Run( argv[0], ui );
+	client->SetBreak( 0 );
+
+	delete ui;
+
+	int status = client->GetErrors() > errors;
+
+	// A dropped connection is reported like Final() would,
+	// and not kept.
+
+	if( client->Dropped() )
+	{
+	    status = 1;
+	    Drop( client );
+	}
+
+	if( opts[ 's' ] || opts[ 'e' ] )
+	    printf( "exit: %d\n", status );
+
+	return status;
+}
+
+# else
+
+static ErrorId muxUnsupported = { ErrorOf( 0, 0, E_FATAL, 0, 0 ),
+	"'p4 mux' is not supported on this platform." };
+
+# endif
+
+int
+clientMux( int argc, char **argv, Options &globalOpts, Error *e )
+{
+	Options opts;
+	StrPtr *s;
+
+	AssertLog.SetTag( "mux" );
+
+	opts.Parse( argc, argv, "s:m:w:", OPT_NONE, muxUsage, e );
+
+	if( e->Test() )
+	    return 1;
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+	StrBuf path;
+	Enviro enviro;
+	const char *p;
+
+	if( ( s = opts[ 's' ] ) )
+	    path.Set( s );
+	else if( ( p = enviro.Get( "P4MUX" ) ) )
+	    path.Set( p );
+	else
+	{
+	    e->Set( muxNoSocket );
+	    return 1;
+	}
+
+	int max = ( s = opts[ 'm' ] ) ? s->Atoi() : 8;
+	int workers = ( s = opts[ 'w' ] ) ? s->Atoi() : 4;
+
+	ClientMux mux( max > 0 ? max : 1 );
+
+	mux.Listen( path, e );
+
+	if( e->Test() )
+	    return 1;
+
+	mux.Serve( workers );
+
+	return 0;
+# else
+	e->Set( muxUnsupported );
+	return 1;
+# endif
+}
+
+int
+clientMuxForward( int argc, char **argv, int &result )
+{
+# if !defined( OS_NT ) && !defined( OS_VMS )
+	Enviro enviro;
+	const char *p = enviro.Get( "P4MUX" );
+
+	if( !p || !*p || !argc || !strcmp( argv[0], "mux" ) )
+	    return 0;
+
+	int fd = MuxConnect( StrRef( p ) );
+
+	if( fd < 0 )
+	    return 0;
+
+	// Package cwd, P4* environment and argv: if it won't fit, run
+	// it ourselves.
+
+	StrBuf cwd, body;
+	HostEnv h;
+	h.GetCwd( cwd, &enviro );
+
+	body.Append( "c", 2 );
+	body.Append( cwd.Text(), cwd.Length() + 1 );
+
+	for( char **ep = environ; *ep; ep++ )
+	{
+	    if( strncmp( *ep, "P4", 2 ) && strncmp( *ep, "PWD=", 4 ) )
+		continue;
+	    body.Append( "e", 2 );
+	    body.Append( *ep, strlen( *ep ) + 1 );
+	}
+
+	for( int i = 0; i < argc; i++ )
+	{
+	    body.Append( "a", 2 );
+	    body.Append( argv[i], strlen( argv[i] ) + 1 );
+	}
+
+	if( body.Length() > MUX_MAXBODY )
+	{
+	    close( fd );
+	    return 0;
+	}
+
+	// Send the length along with our stdio.
+
+	StrBuf hdr;
+	MuxPutInt( hdr, body.Length() );
+
+	int fds[3] = { 0, 1, 2 };
+	char cbuf[ CMSG_SPACE( sizeof( fds ) ) ];
+	struct iovec iov;
+	struct msghdr msg;
+
+	memset( cbuf, 0, sizeof( cbuf ) );
+	memset( &msg, 0, sizeof( msg ) );
+	iov.iov_base = hdr.Text();
+	iov.iov_len = hdr.Length();
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof( cbuf );
+
+	struct cmsghdr *cm = CMSG_FIRSTHDR( &msg );
+	cm->cmsg_level = SOL_SOCKET;
+	cm->cmsg_type = SCM_RIGHTS;
+	cm->cmsg_len = CMSG_LEN( sizeof( fds ) );
+	memcpy( CMSG_DATA( cm ), fds, sizeof( fds ) );
+
+	fflush( stdout );
+	fflush( stderr );
+
+	// A mux that turns us away may not read it all.
+
+	void (*pipe)( int ) = signal( SIGPIPE, SIG_IGN );
+
+	int sent = sendmsg( fd, &msg, 0 ) == hdr.Length() &&
+		   MuxWrite( fd, body.Text(), body.Length() );
+
+	signal( SIGPIPE, pipe );
+
+	if( !sent )
+	{
+	    close( fd );
+	    return 0;
+	}
+
+	// Wait for the verdict.  If declined, run it ourselves.
+	// If the mux died, the command may have partly run: don't
+	// run it again.
+
+	char reply[5] = { 0 };
+
+	if( MuxRead( fd, reply, 1 ) && reply[0] == 'd' )
+	{
+	    close( fd );
+	    return 0;
+	}
+
+	if( reply[0] == 'r' && MuxRead( fd, reply + 1, 4 ) )
+	{
+	    result = MuxGetInt( reply + 1 );
+	}
+	else
+	{
+	    Error e;
+	    e.Set( muxLost );
+	    AssertLog.Report( &e );
+	    result = 1;
+	}
+
+	close( fd );
+	return 1;
+# else
+	return 0;
+# endif
+}
@@ -55,6 +55,8 @@ class TransmitChild
 void
 clientReceiveFiles( Client *client, Error *e )
 {
+	client->DrainMerges();
+
 	StrPtr *token = client->GetVar( P4Tag::v_token, e );
 	StrPtr *threads = client->GetVar( P4Tag::v_peer, e );
 	StrPtr *blockCount = client->GetVar( P4Tag::v_blockCount );
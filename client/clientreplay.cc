@@ -0,0 +1,371 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * clientreplay.cc - 'p4 replay', play back a recorded server
+ *
+ * With P4RPCRECORD set, the client writes every message it receives
+ * from the server to that file, framed as on the wire.  'p4 replay'
+ * plays such a capture back, standing in for the server as an rsh
+ * port, so a client's hot paths (rpc parsing, dispatch, file writing,
+ * charset translation, output formatting) can be timed without one:
+ *
+ *	P4RPCRECORD=sync.rec p4 -c scratch sync //scratch/...
+ *	p4 -c scratch -p "rsh:p4 replay sync.rec" sync //scratch/...
+ *
+ * The capture is written to stdout as fast as the client will read
+ * it, while whatever the client sends on stdin is read and discarded,
+ * but for the flow control markers (flush1) the client sends when it
+ * is streaming to the server: those are answered (flush2) between the
+ * capture's messages, as a server would.  When the client hangs up, a
+ * summary line goes to stderr.  Use -v rpc=1 on the client for its
+ * own send/receive accounting.
+ *
+ * With -o, what the client sends is saved to a file (framed as on the
+ * wire, like a capture, and like one readable only by its owner), so
+ * a capture can serve as a mock server for checking the client's
+ * replies: e.g. a hand-built client-ReconcileAdd asking for batches,
+ * and the confirms the client sends back.
+ *
+ * Captures hold the paths of the workspace they were recorded in, so
+ * record against a scratch workspace, and without client compression
+ * (captures are uncompressed).  They also hold credentials: tickets
+ * and anything else the server sends.  P4RPCRECORD replaces any file
+ * already there with a new one readable only by its owner; keep it
+ * somewhere private all the same, and remove it when done.
+ */
+
+# define NEED_FILE
+# define NEED_FCNTL
+# define NEED_ERRNO
+# define NEED_SOCKETPAIR
+
+# include <stdhdrs.h>
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+# include <poll.h>
+# endif
+
+# include <strbuf.h>
+# include <p4tags.h>
+# include <error.h>
+# include <errorlog.h>
+# include <options.h>
+# include <timer.h>
+
+static ErrorId replayUsage = { ErrorOf( 0, 0, E_FAILED, 0, 0 ),
+	"p4 replay [ -q ] [ -o sentfile ] capturefile" };
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+
+/*
+ * ReplayFrame() - length of the message at p, if it's all there
+ * ReplayFunc() - does the message at p call 'func'?
+ * ReplayFlush2() - append the flush2 answering the flush1 at p
+ *
+ * Messages are a 5 byte header (a check byte, then the body length,
+ * little endian) and a body of "name\0" 4 byte length "value\0" vars.
+ */
+
+static int
+ReplayFrame( const char *p, int len )
+{
+	if( len < 5 )
+	    return 0;
+
+	int n = ( p[1] & 0xff ) | ( p[2] & 0xff ) << 8 |
+		( p[3] & 0xff ) << 16 | ( p[4] & 0xff ) << 24;
+
+	return n >= 0 && n <= len - 5 ? n + 5 : 0;
+}
+
+static int
+ReplayNextVar( const char *&p, const char *e, StrRef &var, StrRef &val )
+{
+	const char *v = p;
+
+	while( v < e && *v )
+	    ++v;
+
+	if( e - v < 6 )
+	    return 0;
+
+	int n = ( v[1] & 0xff ) | ( v[2] & 0xff ) << 8 |
+		( v[3] & 0xff ) << 16 | ( v[4] & 0xff ) << 24;
+
+	if( n < 0 || n > e - v - 6 )
+	    return 0;
+
+	var.Set( (char *)p, v - p );
+	val.Set( (char *)v + 5, n );
+	p = v + 6 + n;
+
+	return 1;
+}
+
+static int
+ReplayFunc( const char *p, int len, const char *func )
+{
+	const char *e = p + len;
+	StrRef var, val;
+
+	for( p += 5; ReplayNextVar( p, e, var, val ); )
+	    if( var == P4Tag::v_func )
+		return val == func;
+
+	return 0;
+}
+
+static void
+ReplayFlush2( const char *p, int len, StrBuf &out )
+{
+	const char *e = p + len;
+	StrRef var, val;
+	StrBuf body;
+
+	for( p += 5; ReplayNextVar( p, e, var, val ); )
+	{
+	    if( var == P4Tag::v_func )
+		val.Set( (char *)P4Tag::p_flush2, strlen( P4Tag::p_flush2 ) );
+
+	    int n = val.Length();
+
+	    body.Append( &var );
+	    body.Extend( 0 );
+	    body.Extend( n & 0xff );
+	    body.Extend( ( n >> 8 ) & 0xff );
+	    body.Extend( ( n >> 16 ) & 0xff );
+	    body.Extend( ( n >> 24 ) & 0xff );
+	    body.Append( &val );
+	    body.Extend( 0 );
+	}
+
+	int n = body.Length();
+	char *h = out.Alloc( 5 );
+
+	h[1] = n & 0xff;
+	h[2] = ( n >> 8 ) & 0xff;
+	h[3] = ( n >> 16 ) & 0xff;
+	h[4] = ( n >> 24 ) & 0xff;
+	h[0] = h[1] ^ h[2] ^ h[3] ^ h[4];
+
+	out.Append( &body );
+}
+
+# else
+
+static ErrorId replayUnsupported = { ErrorOf( 0, 0, E_FATAL, 0, 0 ),
+	"'p4 replay' is not supported on this platform." };
+
+# endif
+
+int
+clientReplay( int argc, char **argv, Error *e )
+{
+	Options opts;
+
+	AssertLog.SetTag( "replay" );
+
+	opts.Parse( argc, argv, "qo:", OPT_ONE, replayUsage, e );
+
+	if( e->Test() )
+	    return 1;
+
+# if !defined( OS_NT ) && !defined( OS_VMS )
+	int fd = open( argv[0], O_RDONLY );
+
+	if( fd < 0 )
+	{
+	    e->Sys( "open", argv[0] );
+	    return 1;
+	}
+
+	int out = -1;
+
+	if( opts[ 'o' ] )
+	{
+	    out = open( opts[ 'o' ]->Text(), O_WRONLY|O_CREAT|O_TRUNC, 0600 );
+
+	    if( out < 0 )
+	    {
+		e->Sys( "open", opts[ 'o' ]->Text() );
+		close( fd );
+		return 1;
+	    }
+	}
+
+	Timer timer;
+	timer.Start();
+
+	StrBuf cap, obuf, ibuf, flush2;
+	const char *sp = 0, *se = 0;
+	P4INT64 sent = 0, rcvd = 0;
+	int eof = 0, released = 0;
+
+	// Feed the capture to the client on stdout while draining
+	// whatever it sends us on stdin, until it hangs up.  What we
+	// send goes a whole number of messages at a time, so that the
+	// answers to flush1 can go between them.
+
+	for( ;; )
+	{
+	    if( sp == se )
+	    {
+		obuf.Clear();
+		obuf.Append( &flush2 );
+		flush2.Clear();
+
+		// Whole messages from the capture, keeping any
+		// partial one for next time.
+
+		while( !eof && obuf.Length() < 64 * 1024 )
+		{
+		    char *b = cap.Alloc( 64 * 1024 );
+		    int l = read( fd, b, 64 * 1024 );
+		    cap.SetLength( cap.Length() - 64 * 1024 + ( l > 0 ? l : 0 ) );
+
+		    if( l <= 0 )
+			eof = 1;
+
+		    const char *p = cap.Text();
+		    const char *e = p + cap.Length();
+		    int n;
+
+		    while( ( n = ReplayFrame( p, e - p ) ) )
+		    {
+			released = ReplayFunc( p, n, P4Tag::p_release ) ||
+				   ReplayFunc( p, n, P4Tag::p_release2 );
+			p += n;
+		    }
+
+		    // A partial message at the end goes as it is.
+
+		    if( eof )
+			p = e;
+
+		    obuf.Append( cap.Text(), p - cap.Text() );
+
+		    StrBuf rest;
+		    rest.Set( p, e - p );
+		    cap.Set( rest );
+		}
+
+		sp = obuf.Text();
+		se = sp + obuf.Length();
+	    }
+
+	    // At the end of a capture cut short, once the client has
+	    // gone quiet (it may still be streaming to us), hang up our
+	    // half so the client sees EOF.  After a release the client
+	    // hangs up itself.  The rsh transport hands us one end of a
+	    // socketpair as both stdin and stdout, so closing stdout
+	    // alone wouldn't do it.
+
+	    int hangup = sp == se && eof == 1 && !released;
+
+	    struct pollfd p[2];
+	    p[0].fd = 0;
+	    p[0].events = POLLIN;
+	    p[1].fd = sp < se ? 1 : -1;
+	    p[1].events = POLLOUT;
+
+	    int r = poll( p, 2, hangup ? 100 : -1 );
+
+	    if( r < 0 )
+	    {
+		if( errno == EINTR )
+		    continue;
+		break;
+	    }
+
+	    if( !r )
+	    {
+		eof = 2;
+		if( shutdown( 1, SHUT_WR ) < 0 )
+		    close( 1 );
+		continue;
+	    }
+
+	    if( p[0].revents )
+	    {
+		char *b = ibuf.Alloc( 64 * 1024 );
+		int l = read( 0, b, 64 * 1024 );
+		ibuf.SetLength( ibuf.Length() - 64 * 1024 + ( l > 0 ? l : 0 ) );
+
+		if( l <= 0 )
+		    break;
+
+		rcvd += l;
+
+		// Answer any flush1, and keep a partial message.
+
+		const char *q = ibuf.Text();
+		const char *qe = q + ibuf.Length();
+		int n;
+
+		for( ; ( n = ReplayFrame( q, qe - q ) ); q += n )
+		    if( ReplayFunc( q, n, P4Tag::p_flush1 ) )
+			ReplayFlush2( q, n, flush2 );
+
+		if( out >= 0 && write( out, ibuf.Text(), q - ibuf.Text() )
+			!= q - ibuf.Text() )
+		{
+		    e->Sys( "write", opts[ 'o' ]->Text() );
+		    close( out );
+		    out = -1;
+		}
+
+		StrBuf rest;
+		rest.Set( q, qe - q );
+		ibuf.Set( rest );
+
+		// Nothing else to send?  Send the answers now.
+
+		if( sp == se && flush2.Length() )
+		    continue;
+	    }
+
+	    if( p[1].revents & POLLOUT )
+	    {
+		int l = write( 1, sp, se - sp );
+
+		if( l < 0 )
+		    break;
+
+		sp += l;
+		sent += l;
+	    }
+	    else if( p[1].revents )
+	    {
+		break;
+	    }
+	}
+
+	close( fd );
+
+	if( out >= 0 && ibuf.Length() &&
+	    write( out, ibuf.Text(), ibuf.Length() ) != (int)ibuf.Length() )
+	{
+	    e->Sys( "write", opts[ 'o' ]->Text() );
+	}
+
+	if( out >= 0 && close( out ) < 0 )
+	    e->Sys( "close", opts[ 'o' ]->Text() );
+
+	int ms = timer.Time();
+
+	if( !opts[ 'q' ] )
+	    fprintf( stderr,
+		"replay: %lld bytes sent, %lld received, %d.%03ds, %.1f MB/s\n",
+		(long long)sent, (long long)rcvd, ms / 1000, ms % 1000,
+		ms ? sent / 1048.576 / ms : 0.0 );
+
+	return e->Test() ? 1 : 0;
+# else
+	e->Set( replayUnsupported );
+	return 1;
+# endif
+}
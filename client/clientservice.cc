@@ -39,6 +39,7 @@
 # include <ticket.h>
 
 # include "clientmerge.h"
+# include "clientmergepipe.h"
 # include "clientresolvea.h"
 # include "clientuser.h"
 # include <msgclient.h>
@@ -310,6 +311,7 @@ clientOpenFile( Client *client, Error *e )
 	FileSys *fs = 0;
 
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *clientHandle = client->GetVar( P4Tag::v_handle, e );
 	StrPtr *modTime = client->GetVar( P4Tag::v_time );
@@ -573,6 +575,8 @@ clientCloseFile( Client *client, Error *e )
 	if( client_nullsync )
 	    return;
 
+	client->DrainMerges();
+
 	StrPtr *clientHandle = client->GetVar( P4Tag::v_handle, e );
 	StrPtr *func = client->GetVar( P4Tag::v_func, e );
 	StrPtr *commit = client->GetVar( P4Tag::v_commit );
@@ -669,6 +673,7 @@ clientMoveFile( Client *client, Error *e )
 	// Move file, clientPath is old,  targetPath is new
 
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *targetPath = client->transfname->GetVar( P4Tag::v_path2, e );
 	StrPtr *targetType = client->GetVar( P4Tag::v_type2, e );
@@ -739,6 +744,7 @@ void
 clientDeleteFile( Client *client, Error *e )
 {
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
 	StrPtr *noclobber = client->GetVar( P4Tag::v_noclobber );
@@ -839,6 +845,7 @@ void
 clientChmodFile( Client *client, Error *e )
 {
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *perms = client->GetVar( P4Tag::v_perms, e );
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
@@ -880,6 +887,8 @@ clientChmodFile( Client *client, Error *e )
 void
 clientConvertFile( Client *client, Error *e )
 {
+	client->DrainMerges();
+
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *perms      = client->GetVar( P4Tag::v_perms, e );
 	StrPtr *fromCS     = client->GetVar( StrRef( P4Tag::v_charset ), 1 );
@@ -1064,6 +1073,7 @@ void
 clientCheckFile( Client *client, Error *e )
 {
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
 	StrPtr *wildType = client->GetVar( P4Tag::v_type2 );
@@ -1271,6 +1281,8 @@ clientCheckFile( Client *client, Error *e )
 void
 clientActionResolve( Client *client, Error *e )
 {
+	client->DrainMerges();
+
 	// So as to be 100% translatable, action resolve gets
 	// all of its strings sent as Error objects from the server.
 
@@ -1437,6 +1449,11 @@ clientOpenMerge( Client *client, Error *e )
 	delete s;
 	s = 0;
 
+	// A merge of this file still being finished goes first;
+	// those of other files can carry on.
+
+	client->DrainMerges( clientPath );
+
 	// very old servers do not send result type
 	if( !resultType )
 	    resultType = clientType;
@@ -1553,6 +1570,60 @@ clientWriteMerge( Client *client, Error *e )
 	client->OutputError( e );
 }
 
+/*
+ * clientMergeResult() - vars telling the server what became of a merge
+ *
+ * Returns 0 if the merge is to be declined.
+ */
+
+static int
+clientMergeResult( StrDict *vars, ClientMerge *merge, MergeStatus stat )
+{
+	const StrPtr *resultDigest;
+
+	switch( stat )
+	{
+	case CMS_QUIT:	// user wants to quit
+	case CMS_SKIP:	// skip the integration record
+	    return 0;
+
+	case CMS_MERGED: // accepted merged theirs and yours
+	    resultDigest = merge->GetMergeDigest();
+	    if( resultDigest )
+		vars->SetVar( P4Tag::v_digest, resultDigest );
+	    vars->SetVar( P4Tag::v_mergeHow, "merged" );
+	    break;
+
+	case CMS_EDIT: // accepted edited merge
+	    vars->SetVar( P4Tag::v_mergeHow, "edit" );
+	    break;
+
+	case CMS_THEIRS: // accepted theirs
+	{
+	    resultDigest = merge->GetTheirDigest();
+	    if( resultDigest )
+		vars->SetVar( P4Tag::v_digest, resultDigest );
+	    vars->SetVar( P4Tag::v_mergeHow, "theirs" );
+	    const char *forced = "no";
+	    if( merge->GetYourChunks() > 0 ||
+		merge->GetConflictChunks() > 0 )
+		forced = "yes";
+	    else if( merge->GetTheirChunks() > 0 )
+		forced = "theirs";
+	    vars->SetVar( P4Tag::v_force, forced );
+	    break;
+	}
+	case CMS_YOURS:	// accepted yours
+	    resultDigest = merge->GetYourDigest();
+	    if( resultDigest )
+		vars->SetVar( P4Tag::v_digest, resultDigest );
+	    vars->SetVar( P4Tag::v_mergeHow, "yours" );
+	    break;
+	}
+
+	return 1;
+}
+
 void
 clientCloseMerge( Client *client, Error *e )
 {
@@ -1561,8 +1632,9 @@ clientCloseMerge( Client *client, Error *e )
 	StrPtr *mergeDecline = client->GetVar( P4Tag::v_mergeDecline );
 	StrPtr *mergePerms = client->GetVar( P4Tag::v_mergePerms );
 	StrPtr *mergeAuto = client->GetVar( P4Tag::v_mergeAuto );
-	const StrPtr *resultDigest;
 	ClientMerge *merge;
+	ClientMergePipe *pipe;
+	MergeForce force = CMF_AUTO;
 	int manualMerge = 0;
 
 	if( e->Test() )
@@ -1583,6 +1655,37 @@ clientCloseMerge( Client *client, Error *e )
 
 	merge->SetError( e );
 
+	// 'auto' means skip conflicts.
+	// 'force' means accept conflicts.
+
+	if( !mergeAuto )
+	    manualMerge = 1;
+	else if( *mergeAuto == "safe" )
+	    force = CMF_SAFE;
+	else if( *mergeAuto == "force" )
+	    force = CMF_FORCE;
+	else if( *mergeAuto != "auto" )
+	    manualMerge = 1;
+
+	// Automatic merges can be finished off by worker threads,
+	// while we get on with the next file: see clientmergepipe.h.
+	// server2 < 11 can't take CMS_EDIT, which is handled below.
+
+	if( !merge->IsError() && mergeConfirm && !manualMerge &&
+	    client->protocolServer >= 11 &&
+	    ( pipe = client->MergePipe() ) )
+	{
+	    StrBufDict results;
+	    MergeStatus stat = merge->AutoResolve( force );
+
+	    if( !clientMergeResult( &results, merge, stat ) )
+		mergeConfirm = mergeDecline;
+
+	    pipe->Queue( merge, stat, &results, clientHandle, mergeConfirm,
+			mergeDecline, mergePerms );
+	    return;
+	}
+
 	// Accept or decline integration depending on what Resolve() said.
 
 	// If mergeConfirm is null, it means sender detected error and
@@ -1606,25 +1709,18 @@ clientCloseMerge( Client *client, Error *e )
 		merge->Chmod( "rw", e );
 
 	    // Do automatic merge if requested.
-	    // 'auto' means skip conflicts.
-	    // 'force' means accept conflicts.
 
-	    if( mergeAuto && *mergeAuto == "safe" )
-	    {
-		stat = merge->AutoResolve( CMF_SAFE );
-	    }
-	    else if( mergeAuto && *mergeAuto == "force" )
-	    {
-		stat = merge->AutoResolve( CMF_FORCE );
-	    }
-	    else if( mergeAuto && *mergeAuto == "auto" )
-	    {
-		stat = merge->AutoResolve( CMF_AUTO );
-	    }
-	    else // manual merge
+	    // A manual resolve may want the files themselves: write out
+	    // any held in memory, skipping the file if that fails.
+
+	    if( !manualMerge )
+		stat = merge->AutoResolve( force );
+	    else
 	    {
-		stat = (MergeStatus)client->GetUi()->Resolve( merge, e );
-	        manualMerge = 1;
+		merge->WriteTemps( e );
+
+		stat = e->Test() ? CMS_SKIP :
+		    (MergeStatus)client->GetUi()->Resolve( merge, e );
 	    }
 
 	    // server2 < 11 can't take CMS_EDIT.
@@ -1635,49 +1731,8 @@ clientCloseMerge( Client *client, Error *e )
 	    // Formulate response to server according to user's action.
 	    // If the target file was updated
 
-	    switch( stat )
-	    {
-	    case CMS_QUIT:	// user wants to quit
+	    if( !clientMergeResult( client, merge, stat ) )
 		mergeConfirm = mergeDecline;
-		break;
-
-	    case CMS_SKIP:	// skip the integration record
-		mergeConfirm = mergeDecline;
-		break;
-
-	    case CMS_MERGED: // accepted merged theirs and yours
-		resultDigest = merge->GetMergeDigest();
-		if( resultDigest )
-		    client->SetVar( P4Tag::v_digest, resultDigest );
-		client->SetVar( P4Tag::v_mergeHow, "merged" );
-		break;
-
-	    case CMS_EDIT: // accepted edited merge
-		client->SetVar( P4Tag::v_mergeHow, "edit" );
-		break;
-
-	    case CMS_THEIRS: // accepted theirs
-	    {
-		resultDigest = merge->GetTheirDigest();
-		if( resultDigest )
-		    client->SetVar( P4Tag::v_digest, resultDigest );
-		client->SetVar( P4Tag::v_mergeHow, "theirs" );
-		const char *forced = "no";
-		if( merge->GetYourChunks() > 0 ||
-		    merge->GetConflictChunks() > 0 )
-		    forced = "yes";
-		else if( merge->GetTheirChunks() > 0 )
-		    forced = "theirs";
-		client->SetVar( P4Tag::v_force, forced );
-		break;
-	    }
-	    case CMS_YOURS:	// accepted yours
-		resultDigest = merge->GetYourDigest();
-		if( resultDigest )
-		    client->SetVar( P4Tag::v_digest, resultDigest );
-		client->SetVar( P4Tag::v_mergeHow, "yours" );
-		break;
-	    }
 
 	    // Move selected file into position
 
@@ -1725,6 +1780,7 @@ void
 clientSendFile( Client *client, Error *e )
 {
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientPath = client->transfname->GetVar( P4Tag::v_path, e );
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
 	StrPtr *perms = client->GetVar( P4Tag::v_perms );
@@ -2379,7 +2435,7 @@ clientMessage( Client *client, Error *e )
 	if( client != client->translated )
 	{
 	    errorDict = ((TransDict *)client->translated)
-		->CreateErrorOutputDict();
+		->ErrorOutputDict();
 	}
 	rcvErr.UnMarshall1( *errorDict );
 
@@ -2406,9 +2462,6 @@ clientMessage( Client *client, Error *e )
 	            client->GetUi()->Message( &te );
 	    }
 	}
-
-	if( errorDict != client )
-	    delete errorDict;
 }
 
 void
@@ -2951,6 +3004,30 @@ clientFatalError( Client *client, Error *e )
 	client->GotReleased();
 }
 
+//
+// clientFlush1 - answer the server's flow control
+// clientRelease - the server is done
+//
+// Merges still being finished on worker threads owe the server their
+// confirms first: see clientmergepipe.h.  Flush1's vars are for flush2,
+// not for them, so drain before CopyVars().
+//
+
+void
+clientFlush1( Client *client, Error *e )
+{
+	client->DrainMerges();
+	client->CopyVars();
+	client->Invoke( P4Tag::p_flush2 );
+}
+
+void
+clientRelease( Client *client, Error *e )
+{
+	client->DrainMerges();
+	client->GotReleased();
+}
+
 void clientReceiveFiles( Client *client, Error *e );
 
 /*
@@ -3010,6 +3087,8 @@ const RpcDispatch clientDispatch[] = {
 	P4Tag::c_SetPassword,	RpcCallback(clientSetPassword),
 	P4Tag::c_SSO,		RpcCallback(clientSingleSignon),
 
+	P4Tag::p_flush1,	RpcCallback(clientFlush1),
+	P4Tag::p_release,	RpcCallback(clientRelease),
 	P4Tag::p_protocol,	RpcCallback(clientProtocol),
 	P4Tag::p_errorHandler,	RpcCallback(clientFatalError),
 
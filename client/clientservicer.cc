@@ -9,12 +9,14 @@
 # endif
 
 # include <stdhdrs.h>
+# include <ctype.h>
 
 # include <strbuf.h>
 # include <strdict.h>
 # include <strops.h>
 # include <strarray.h>
 # include <strtable.h>
+# include <strpool.h>
 # include <error.h>
 # include <mapapi.h>
 # include <handler.h>
@@ -67,6 +69,260 @@ class ReconcileHandle : public LastChance {
 			int delCount;
 } ;
 
+/*
+ * ReconcileFiles - the files reconcile add found, with sizes and digests
+ *
+ * A scan can find millions of files, so rather than a StrBuf apiece
+ * (and more for their sizes and digests) the names go in a StrPool
+ * and the sizes and MD5 digests in binary columns alongside.
+ *
+ * Send() says where they go once found: Flush() sends them to the
+ * server (less any in 'skip', the depot's sorted list) with the
+ * confirm.  Given a batch size, Put() flushes each full batch as the
+ * scan goes, and so holds no more than that many; see
+ * clientReconcileAdd().  Those batches carry only their own files,
+ * and go duplex: while the server answers them, we dispatch what it
+ * sends rather than let both pipes fill.  The last goes with the
+ * confirm's usual copy of the server's vars.
+ */
+
+class ReconcileFiles {
+
+    public:
+			ReconcileFiles()
+			{
+			    files = 0;
+			    sizes = 0;
+			    digests = 0;
+			    digested = 0;
+			    count = max = 0;
+
+			    client = 0;
+			    confirm = 0;
+			    skip = 0;
+			    skipIndex = 0;
+			    sendSizes = sendDigests = 0;
+			    batchSize = batch = sent = 0;
+			}
+			~ReconcileFiles()
+			{
+			    delete []files;
+			    delete []sizes;
+			    delete []digests;
+			    delete []digested;
+			}
+
+	void		Put( const StrPtr &file, offL_t size = 0 );
+	void		SetDigest( const StrPtr &digest );
+	void		SetDigest( FileSys *f, Error *e );
+
+	int		Count() { return count; }
+	const StrPtr	*File( int i ) { return &files[i]; }
+	offL_t		Size( int i ) { return sizes[i]; }
+	int		Digest( int i, StrBuf &digest );
+
+	void		Send( Client *client, const StrPtr *confirm,
+				StrArray *skip, int sendSizes,
+				int sendDigests, int batchSize );
+	void		Flush( int last );
+
+    private:
+
+	StrPool		names;
+	StrRef		*files;
+	offL_t		*sizes;
+	unsigned char	*digests;	// 16 bytes each, or 0 if none
+	char		*digested;	// 1 if that file's digest is set
+	int		count;
+	int		max;
+
+	Client		*client;
+	const StrPtr	*confirm;
+	StrArray	*skip;		// sorted; files to leave out
+	int		skipIndex;
+	int		sendSizes;
+	int		sendDigests;
+	int		batchSize;	// 0: all at once
+	int		batch;		// batches sent
+	int		sent;		// files sent
+
+} ;
+
+void
+ReconcileFiles::Put( const StrPtr &file, offL_t size )
+{
+	// Streaming?  Send a full batch before starting the next: its
+	// last file may still be waiting for SetDigest().
+
+	if( batchSize && count == batchSize )
+	    Flush( 0 );
+
+	if( count == max )
+	{
+	    int newMax = max * 2 + 64;
+	    StrRef *f = new StrRef[ newMax ];
+	    offL_t *s = new offL_t[ newMax ];
+
+	    for( int i = 0; i < count; i++ )
+		f[i] = files[i];
+
+	    memcpy( s, sizes, count * sizeof( offL_t ) );
+
+	    if( digests )
+	    {
+		unsigned char *d = new unsigned char[ newMax * 16 ];
+		char *h = new char[ newMax ];
+		memcpy( d, digests, count * 16 );
+		memcpy( h, digested, count );
+		memset( h + count, 0, newMax - count );
+		delete []digests;
+		delete []digested;
+		digests = d;
+		digested = h;
+	    }
+
+	    delete []files;
+	    delete []sizes;
+
+	    files = f;
+	    sizes = s;
+	    max = newMax;
+	}
+
+	names.Save( file, files[ count ] );
+	sizes[ count++ ] = size;
+}
+
+void
+ReconcileFiles::SetDigest( const StrPtr &digest )
+{
+	// For the last file Put().  Digests are MD5s in hex: anything
+	// else (say, the file couldn't be read) leaves it without one.
+
+	if( digest.Length() != 32 )
+	    return;
+
+	for( int i = 0; i < 32; i++ )
+	    if( !isxdigit( (unsigned char)digest.Text()[i] ) )
+		return;
+
+	if( !digests )
+	{
+	    digests = new unsigned char[ max * 16 ];
+	    digested = new char[ max ];
+	    memset( digested, 0, max );
+	}
+
+	StrOps::XtoO( digest.Text(), digests + ( count - 1 ) * 16, 16 );
+	digested[ count - 1 ] = 1;
+}
+
+void
+ReconcileFiles::SetDigest( FileSys *f, Error *e )
+{
+	// A file that can't be read goes without a digest.  The error
+	// is passed on (the first, if there are more), but doesn't keep
+	// the files after it from being read.
+
+	StrBuf digest;
+	Error de;
+
+	f->Digest( &digest, &de );
+
+	if( !de.Test() )
+	    SetDigest( digest );
+	else if( !e->Test() )
+	    *e = de;
+}
+
+int
+ReconcileFiles::Digest( int i, StrBuf &digest )
+{
+	if( !digests || !digested[i] )
+	    return 0;
+
+	digest.Clear();
+	StrOps::OtoX( digests + i * 16, 16, digest );
+	return 1;
+}
+
+void
+ReconcileFiles::Send( Client *client, const StrPtr *confirm,
+	StrArray *skip, int sendSizes, int sendDigests, int batchSize )
+{
+	this->client = client;
+	this->confirm = confirm;
+	this->skip = skip;
+	this->sendSizes = sendSizes;
+	this->sendDigests = sendDigests;
+	this->batchSize = batchSize > 0 ? batchSize : 0;
+}
+
+void
+ReconcileFiles::Flush( int last )
+{
+	StrBuf digest;
+	int n = 0;
+
+	for( int i = 0; i < count; i++ )
+	{
+	    // Leave out files the depot has.  The files come in the
+	    // scan's order, which is skip's, so the place in skip
+	    // carries over from batch to batch.
+
+	    int l = -1;
+
+	    while( skip && skipIndex < skip->Count() &&
+		   ( l = files[i].SCompare( *skip->Get( skipIndex ) ) ) > 0 )
+		++skipIndex;
+
+	    if( skip && skipIndex < skip->Count() && !l )
+	    {
+		++skipIndex;
+		continue;
+	    }
+
+	    client->SetVar( P4Tag::v_file, n, files[i] );
+
+	    // Deleted files?  Send filesize info so the
+	    // server can try to pair up moves.
+
+	    if( sendSizes )
+		client->SetVar( P4Tag::v_fileSize, n, StrNum( sizes[i] ) );
+
+	    if( sendDigests && Digest( i, digest ) )
+		client->SetVar( P4Tag::v_digest, n, digest );
+
+	    ++n;
+	}
+
+	sent += n;
+
+	if( batchSize && !last )
+	{
+	    client->SetVar( P4Tag::v_batch, StrNum( batch++ ) );
+	    client->InvokeDuplex( confirm->Text() );
+	}
+	else
+	{
+	    if( batchSize )
+	    {
+		client->SetVar( P4Tag::v_batch, StrNum( batch++ ) );
+		client->SetVar( P4Tag::v_batchEnd, StrNum( sent ) );
+	    }
+
+	    client->Confirm( confirm );
+	}
+
+	// Empty, for the next batch.
+
+	names.Clear();
+	count = 0;
+
+	if( digests )
+	    memset( digested, 0, max );
+}
+
 /*
  * SendDir - utility method used by clientTraverseShort to decide if a
  *	     filename should be output as a file or as a directory (status -s)
@@ -133,6 +389,7 @@ void
 clientReconcileEdit( Client *client, Error *e )
 {
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
 	StrPtr *digest = client->GetVar( P4Tag::v_digest );
 	StrPtr *confirm = client->GetVar( P4Tag::v_confirm, e );
@@ -236,7 +493,7 @@ clientReconcileEdit( Client *client, Error *e )
 int
 clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 		    int noIgnore, int initial, int skipCheck, int skipCurrent,
-		    MapApi *map, StrArray *files, StrArray *dirs, int &idx,
+		    MapApi *map, ReconcileFiles *files, StrArray *dirs, int &idx,
 		    StrArray *depotFiles, int &ddx, const char *config, 
 		    Error *e )
 {
@@ -285,7 +542,7 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 		if( noIgnore || 
 	           !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 		{
-		    files->Put()->Set( fileName );
+		    files->Put( StrRef( fileName ) );
 		    found = 1;
 		}
 	    }
@@ -301,7 +558,7 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 	    if( noIgnore || 
 	        !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 	    {
-		files->Put()->Set( fileName );
+		files->Put( StrRef( fileName ) );
 		found = 1;
 	    }
 	    delete f;
@@ -456,7 +713,7 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 			{
 			    p->Set( fileName );
 			    (void)SendDir( p, cwd, dirs, idx, skipCurrent );
-			    files->Put()->Set( p );
+			    files->Put( *p );
 			    found = 1;
 			    break;
 			}
@@ -531,7 +788,7 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 		    {
 			p->Set( fileName );
 			(void)SendDir( p, cwd, dirs, idx, skipCurrent );
-			files->Put()->Set( p );
+			files->Put( *p );
 			found = 1;
 			break;
 		    }
@@ -566,12 +823,12 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 			{
 			    p->ToParent();
 			    p->SetLocal( *p, StrRef("...") );
-			    files->Put()->Set( p );
+			    files->Put( *p );
 			}
 			else if( SendDir( p, cwd, dirs, idx, skipCurrent ) )
-			    files->Put()->Set( p );
+			    files->Put( *p );
 			else
-			    files->Put()->Set( fileName );
+			    files->Put( StrRef( fileName ) );
 			found = 1;
 			break;
 		    }
@@ -593,8 +850,7 @@ clientTraverseShort( Client *client, StrPtr *cwd, const char *dir, int traverse,
 
 void
 clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
-		    int getDigests, MapApi *map, StrArray *files,
-		    StrArray *sizes, StrArray *digests,
+		    int getDigests, MapApi *map, ReconcileFiles *files,
 		    int &hasIndex, StrArray *hasList, const char *config, 
 		    Error *e )
 {
@@ -614,7 +870,6 @@ clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
 	StrBuf to;
 	CharSetCvt *cvt = ( (TransDict *)client->transfname )->ToCvt();
 	const char *fileName;
-	StrBuf localDigest;
 
 	// With unicode server and client using character set, we need
 	// to send files back as utf8.
@@ -638,13 +893,11 @@ clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
 		if( noIgnore || 
 	            !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 		{
-		    files->Put()->Set( fileName );
-		    sizes->Put()->Set( StrNum( f->GetSize() ) );
+		    files->Put( StrRef( fileName ), f->GetSize() );
 		    if( getDigests )
 		    {
 			f->Translator( ClientSvc::XCharset(client,FromClient));
-			f->Digest( &localDigest, e );
-			digests->Put()->Set( localDigest );
+			files->SetDigest( f, e );
 		    }
 		}
 	    }
@@ -660,13 +913,11 @@ clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
 	    if( noIgnore || 
 	        !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 	    {
-		files->Put()->Set( fileName );
-		sizes->Put()->Set( StrNum( f->GetSize() ) );
+		files->Put( StrRef( fileName ), f->GetSize() );
 		if( getDigests )
 		{
 		    f->Translator( ClientSvc::XCharset(client,FromClient));
-		    f->Digest( &localDigest, e );
-		    digests->Put()->Set( localDigest );
+		    files->SetDigest( f, e );
 		}
 	    }
 	    delete f;
@@ -768,21 +1019,18 @@ clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
 		    if( noIgnore || 
 	                !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 		    {
-			files->Put()->Set( fileName );
-			sizes->Put()->Set( StrNum( f->GetSize() ) );
+			files->Put( StrRef( fileName ), f->GetSize() );
 			if( getDigests )
 			{
 			    f->Translator( ClientSvc::XCharset(client,FromClient));
-			    f->Digest( &localDigest, e );
-			    digests->Put()->Set( localDigest );
+			    files->SetDigest( f, e );
 			}
 		    }
 		}
 		else if( traverse )
 		    clientTraverseDirs( client, f->Name(), traverse, noIgnore,
-					getDigests, map, files, sizes,
-					digests, hasIndex, hasList, 
-	                                config, e );
+					getDigests, map, files,
+					hasIndex, hasList, config, e );
 	    }
 	    else if( ( stat & FSF_EXISTS ) || ( stat & FSF_SYMLINK ) )
 	    {
@@ -803,13 +1051,11 @@ clientTraverseDirs( Client *client, const char *dir, int traverse, int noIgnore,
 		if( noIgnore || 
 	            !ignore->Reject( StrRef(f->Name()), ignored, config ) )
 		{
-		    files->Put()->Set( fileName );
-		    sizes->Put()->Set( StrNum( f->GetSize() ) );
+		    files->Put( StrRef( fileName ), f->GetSize() );
 		    if( getDigests )
 		    {
 			f->Translator( ClientSvc::XCharset(client,FromClient));
-			f->Digest( &localDigest, e );
-			digests->Put()->Set( localDigest );
+			files->SetDigest( f, e );
 		    }
 		}
 	    }
@@ -831,9 +1077,19 @@ clientReconcileAdd( Client *client, Error *e )
 	 * differs from clientScanDir in that it returns full
 	 * paths, supports traversing subdirectories, and checks
 	 * against a mapTable.
+	 *
+	 * The files go back as file/fileSize/digest vars, indexed,
+	 * with the confirm.  If the server sets batchSize (only if
+	 * we set the recbatch protocol), they go back as the scan
+	 * finds them instead: a confirm for every batchSize files,
+	 * numbered by a 'batch' var from 0, the last (perhaps empty)
+	 * marked by 'batchEnd', the count of files sent in all.  Only
+	 * the last carries the server's vars back, as a confirm does.
+	 * Not for summary (status -s), which sends directories.
 	 */
 
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *dir = client->transfname->GetVar( P4Tag::v_dir, e );
 	StrPtr *confirm = client->GetVar( P4Tag::v_confirm, e );
 	StrPtr *traverse = client->GetVar( "traverse" );
@@ -841,17 +1097,16 @@ clientReconcileAdd( Client *client, Error *e )
 	StrPtr *skipIgnore = client->GetVar( "skipIgnore" );
 	StrPtr *skipCurrent = client->GetVar( "skipCurrent" );
 	StrPtr *sendDigest = client->GetVar( "sendDigest" );
+	StrPtr *batchSize = client->GetVar( "batchSize" );
 	StrPtr *mapItem;
 
 	if( e->Test() )
 	    return;
 
 	MapApi *map = new MapApi;
-	StrArray *files = new StrArray();
-	StrArray *sizes = new StrArray();
+	ReconcileFiles *files = new ReconcileFiles;
 	StrArray *dirs = new StrArray();
 	StrArray *depotFiles = new StrArray();
-	StrArray *digests = new StrArray();
 
 	// Construct a MapTable object from the strings passed in by server
 
@@ -911,6 +1166,19 @@ clientReconcileAdd( Client *client, Error *e )
 	int hasIndex = 0;
 	const char *config = client->GetEnviro()->Get( "P4CONFIG" );
 
+	// Where the files go.  If we have the list from ReconcileEdit,
+	// leave out what's already in the depot (summary did so early),
+	// and with deleted files send sizes so the server can try to
+	// pair up moves.  A server that knows we can (recbatch) may ask
+	// for them in batches, as they're found.
+
+	StrArray *skip = recHandle && !summary ? recHandle->pathArray : 0;
+
+	files->Send( client, confirm, skip,
+		     skip && !sendDigest && recHandle->delCount,
+		     sendDigest != 0,
+		     batchSize && !summary ? batchSize->Atoi() : 0 );
+
 	if( summary != 0 )
 	{
 	    int idx = 0;
@@ -923,70 +1191,18 @@ clientReconcileAdd( Client *client, Error *e )
 	else
 	    clientTraverseDirs( client, dir->Text(), traverse != 0,
 				skipIgnore != 0, sendDigest != 0, map,
-				files, sizes, digests, hasIndex, 
+				files, hasIndex,
 				recHandle ? recHandle->pathArray : 0, 
 	                        config, e );
 	delete map;
 
-	// Compare list of files on client with list of files in the depot
-	// if we have this list from ReconcileEdit. Skip this comparison
-	// if summary because it was done already.
+	// Send what's left: everything, if not streaming.
 
-	if( recHandle && !summary )
-	{
-	    int i1 = 0, i2 = 0, i0 = 0, l = 0;
-
-	    while( i1 < files->Count() )
-	    {
-		if( i2 >= recHandle->pathArray->Count())
-		    l = -1;
-		else
-		    l = files->Get( i1 )->SCompare( 
-		        *recHandle->pathArray->Get( i2 ) );
+	files->Flush( 1 );
 
-		if( !l )
-		{
-		    ++i1;
-		    ++i2;
-		}
-		else if( l < 0 )
-		{
-		    client->SetVar( P4Tag::v_file, i0, *files->Get( i1 ) );
-		    if( !sendDigest && recHandle->delCount )
-		    {
-			// Deleted files?  Send filesize info so the
-			// server can try to pair up moves.
-
-			client->SetVar( P4Tag::v_fileSize, 
-					i0, *sizes->Get( i1 ) );
-		    }
-		    if( sendDigest )
-			client->SetVar( P4Tag::v_digest, i0, *digests->Get(i1));
-		    ++i0;
-		    ++i1;
-		}
-		else
-		{
-		    ++i2;
-		}
-	    }
-	}
-	else
-	{
-	    for( int j = 0; j < files->Count(); j++ )
-	    {
-		client->SetVar( P4Tag::v_file, j, *files->Get(j) );
-		if( sendDigest )
-		    client->SetVar( P4Tag::v_digest, j, *digests->Get(j) );
-	    }
-	}
-
-	client->Confirm( confirm );
 	delete files;
-	delete sizes;
 	delete dirs;
 	delete depotFiles;
-	delete digests;
 }
 
 void
@@ -1009,6 +1225,7 @@ clientExactMatch( Client *client, Error *e )
 	// index    = exact match
 
 	client->NewHandler();
+	client->DrainMerges();
 	StrPtr *clientType = client->GetVar( P4Tag::v_type );
 	StrPtr *digest = client->GetVar( P4Tag::v_digest );
 	StrPtr *fileSize = client->GetVar( P4Tag::v_fileSize );
@@ -17,9 +17,11 @@
 # endif
 
 # include <stdhdrs.h>
+# include <ctype.h>
 
 # include <strbuf.h>
 # include <strops.h>
+# include <validate.h>
 # include <strdict.h>
 # include <strtable.h>
 # include <enviro.h>
@@ -71,7 +73,7 @@ class MarshalDict : public StrBuf
 			{ AddString( StrRef( code ) ); AddString( value ); }
 
 	void		Add( const StrPtr &code, const StrPtr &value )
-			{ AddString( code ); AddString( value ); }
+			{ AddString( code ); AddValue( code, value ); }
 
 	void		Add( const char *code, int value )
 			{ AddString( StrRef( code ) ); AddInt( value ); }
@@ -88,6 +90,9 @@ class MarshalDict : public StrBuf
 	virtual void	AddInt( int value ) = 0;
 	virtual void	AddString( const StrPtr &value ) = 0;
 
+	virtual void	AddValue( const StrPtr &code, const StrPtr &value )
+			{ AddString( value ); }
+
 	void		AddCode( char c )
 			{ Extend( c ); }
 
@@ -241,6 +246,60 @@ class PhpDict : public MarshalDict
 } ;
 
 
+/*
+ * JsonDict : a MarshalDict that holds JSON objects, one per line.
+ *
+ * Unlike the other dictionaries, JsonDict doesn't Clear() itself
+ * on StartWrite(): records accumulate so that ClientUserJson can
+ * write them out in large blocks.  Strings are escaped as required
+ * by JSON (quote, backslash and control characters), and bytes that
+ * aren't valid UTF-8 are replaced by U+FFFD.  The values of numeric
+ * fstat fields are written as JSON numbers.
+ */
+
+class JsonDict : public MarshalDict
+{
+    public:
+
+	// Read/Write
+
+	void		StartWrite( const char *code );
+	void		EndWrite();
+
+	void		StartRead( Error *e );
+	void		EndRead( Error *e );
+
+
+	// Reading dictionary pairs
+
+	INLINE int	Get( StrBuf &var, StrBuf &val );
+
+    protected:
+
+	// Low level string/int/etc to implement MarshalDict interface
+
+	void		AddInt( int value );
+	void		AddString( const StrPtr &value );
+	void		AddValue( const StrPtr &code, const StrPtr &value );
+
+    private:
+
+	void		AddEscaped( const unsigned char *p,
+				const unsigned char *e );
+
+	void		AddSeparator()
+			{ if( elemCount ) AddCode( elemCount & 1 ? ':' : ',' );
+			  ++elemCount; }
+
+	void		SkipSpace();
+	int		UnpackString( StrBuf &buf );
+	int		UnpackValue( StrBuf &buf );
+
+	int		elemCount;	// Number of keys and values written
+
+} ;
+
+
 /*******************************************************************************
  * MarshalDict methods
  ******************************************************************************/
@@ -801,6 +860,403 @@ PhpDict::EndRead( Error *e )
 }
 
 
+/*******************************************************************************
+ *  JsonDict methods
+ ******************************************************************************/
+
+/*
+ * Characters that need escaping in a JSON string: the letter to
+ * follow the backslash, or 'u' for the \u00XX form.
+ */
+
+static const char jsonEscape[256] = {
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		// 0x00
+	'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',		// 0x08
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		// 0x10
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',		// 0x18
+	0,   0,   '"', 0,   0,   0,   0,   0,		// 0x20
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x28
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x30
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x38
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x40
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x48
+	0,   0,   0,   0,   0,   0,   0,   0,		// 0x50
+	0,   0,   0,   0,   '\\', 0,  0,   0,		// 0x58
+	// remainder zero
+} ;
+
+static const char jsonHex[] = "0123456789abcdef";
+
+/*
+ * Start a JSON object, appended to anything not yet written out.
+ */
+
+void
+JsonDict::StartWrite( const char *code )
+{
+	AddCode( '{' );
+	elemCount = 0;
+	Add( "code", StrRef( code ) );
+}
+
+/*
+ * Close the object, and the line it's on.
+ */
+
+void
+JsonDict::EndWrite()
+{
+	AddCode( '}' );
+	AddCode( '\n' );
+}
+
+/*
+ * Write an integer straight into the buffer.
+ */
+
+void
+JsonDict::AddInt( int value )
+{
+	AddSeparator();
+
+	char buf[ 12 ];
+	char *p = buf + sizeof( buf );
+	unsigned int u = value < 0 ? 0 - (unsigned int)value : value;
+
+	do *--p = '0' + u % 10;
+	while( u /= 10 );
+
+	if( value < 0 )
+	    *--p = '-';
+
+	Extend( p, buf + sizeof( buf ) - p );
+}
+
+/*
+ * Write a quoted string.  JSON strings are Unicode, so anything that
+ * isn't valid UTF-8 is replaced a byte at a time by U+FFFD.
+ */
+
+void
+JsonDict::AddString( const StrPtr &value )
+{
+	AddSeparator();
+	AddCode( '"' );
+
+	const unsigned char *p = (const unsigned char *)value.Text();
+	const unsigned char *e = p + value.Length();
+	CharSetUTF8Valid utf8;
+
+	for( ;; )
+	{
+	    const char *bad;
+
+	    utf8.Reset();
+
+	    if( utf8.Valid( (const char *)p, e - p, &bad ) == 1 )
+		break;
+
+	    AddEscaped( p, (const unsigned char *)bad );
+	    Extend( "\\ufffd", 6 );
+	    p = (const unsigned char *)bad + 1;
+	}
+
+	AddEscaped( p, e );
+	AddCode( '"' );
+}
+
+/*
+ * Write the escaped form of valid UTF-8, copying runs of characters
+ * that need no escaping in one go.
+ */
+
+void
+JsonDict::AddEscaped( const unsigned char *p, const unsigned char *e )
+{
+	for( ;; )
+	{
+	    const unsigned char *q = p;
+
+	    while( q < e && !jsonEscape[ *q ] )
+		++q;
+
+	    if( q > p )
+		Extend( (const char *)p, q - p );
+
+	    if( q == e )
+		break;
+
+	    char c = jsonEscape[ *q ];
+
+	    if( c == 'u' )
+	    {
+		char *b = Alloc( 6 );
+		b[0] = '\\';
+		b[1] = 'u';
+		b[2] = '0';
+		b[3] = '0';
+		b[4] = jsonHex[ *q >> 4 ];
+		b[5] = jsonHex[ *q & 0xf ];
+	    }
+	    else
+	    {
+		char *b = Alloc( 2 );
+		b[0] = '\\';
+		b[1] = c;
+	    }
+
+	    p = q + 1;
+	}
+}
+
+/*
+ * Write the value of a numeric fstat field as a number, if it is
+ * one: a plain decimal integer, as JSON would write it.
+ */
+
+static const char *const jsonNumeric[] = {
+	P4Tag::v_headRev, P4Tag::v_haveRev, P4Tag::v_workRev,
+	P4Tag::v_headChange, P4Tag::v_headTime, P4Tag::v_headModTime,
+	P4Tag::v_fileSize, P4Tag::v_otherOpen, 0
+} ;
+
+void
+JsonDict::AddValue( const StrPtr &code, const StrPtr &value )
+{
+	const char *p = value.Text();
+	const char *e = p + value.Length();
+
+	if( p < e && *p == '-' )
+	    ++p;
+
+	int number = p < e && ( *p != '0' || e - p == 1 );
+
+	for( ; number && p < e; p++ )
+	    number = isdigit( (unsigned char)*p );
+
+	for( int i = 0; number && jsonNumeric[i]; i++ )
+	{
+	    if( code != jsonNumeric[i] )
+		continue;
+
+	    AddSeparator();
+	    Extend( value.Text(), value.Length() );
+	    return;
+	}
+
+	AddString( value );
+}
+
+void
+JsonDict::SkipSpace()
+{
+	while( s.Length() && isspace( (unsigned char)s[0] ) )
+	    s.Set( s.Text() + 1, s.Length() - 1 );
+}
+
+/*
+ * Start reading a JSON object.
+ */
+
+void
+JsonDict::StartRead( Error *e )
+{
+	s.Set( *this );
+	elemCount = 0;
+
+	SkipSpace();
+
+	if( !GetChar( '{' ) )
+	    e->Set( MsgClient::BadMarshalInput );
+}
+
+/*
+ * Get the next member of the object; values that are not strings
+ * (numbers, true, false, null) are returned as their JSON text.
+ * Returns non-zero on success.
+ */
+
+INLINE int
+JsonDict::Get( StrBuf &var, StrBuf &val )
+{
+	SkipSpace();
+
+	if( !s.Length() || s[0] == '}' )
+	    return 0;
+
+	if( elemCount++ && !GetChar( ',' ) )
+	    return 0;
+
+	SkipSpace();
+
+	if( !UnpackString( var ) )
+	    return 0;
+
+	SkipSpace();
+
+	if( !GetChar( ':' ) )
+	    return 0;
+
+	SkipSpace();
+
+	return UnpackValue( val );
+}
+
+/*
+ * Unpack a quoted JSON string, undoing its escapes.  \\u escapes
+ * (including surrogate pairs) are written as UTF-8.
+ * Returns non-zero on success.
+ */
+
+int
+JsonDict::UnpackString( StrBuf &buf )
+{
+	if( !GetChar( '"' ) )
+	    return 0;
+
+	buf.Clear();
+
+	const char *p = s.Text();
+	const char *e = p + s.Length();
+
+	while( p < e && *p != '"' )
+	{
+	    const char *q = p;
+
+	    while( q < e && *q != '"' && *q != '\\' )
+		++q;
+
+	    buf.Extend( p, q - p );
+
+	    if( q == e || *q == '"' )
+	    {
+		p = q;
+		break;
+	    }
+
+	    // Backslash escape
+
+	    if( ++q == e )
+		return 0;
+
+	    switch( *q++ )
+	    {
+	    case '"':  buf.Extend( '"' ); break;
+	    case '\\': buf.Extend( '\\' ); break;
+	    case '/':  buf.Extend( '/' ); break;
+	    case 'b':  buf.Extend( '\b' ); break;
+	    case 'f':  buf.Extend( '\f' ); break;
+	    case 'n':  buf.Extend( '\n' ); break;
+	    case 'r':  buf.Extend( '\r' ); break;
+	    case 't':  buf.Extend( '\t' ); break;
+	    case 'u':
+		{
+		    unsigned int u = 0;
+
+		    for( int i = 0; i < 4; i++, q++ )
+		    {
+			if( q == e || !isxdigit( (unsigned char)*q ) )
+			    return 0;
+			u = u * 16 + ( isdigit( (unsigned char)*q )
+			    ? *q - '0' : ( *q | 0x20 ) - 'a' + 10 );
+		    }
+
+		    // High surrogate followed by \uDCxx low surrogate
+
+		    if( u >= 0xd800 && u < 0xdc00 && e - q >= 6 &&
+			q[0] == '\\' && q[1] == 'u' )
+		    {
+			StrBuf lo;
+			lo.Set( q + 2, 4 );
+			unsigned int l = strtoul( lo.Text(), 0, 16 );
+			if( l >= 0xdc00 && l < 0xe000 )
+			{
+			    u = 0x10000 + ( ( u - 0xd800 ) << 10 ) +
+				( l - 0xdc00 );
+			    q += 6;
+			}
+		    }
+
+		    if( u < 0x80 )
+		    {
+			buf.Extend( (char)u );
+		    }
+		    else if( u < 0x800 )
+		    {
+			buf.Extend( (char)( 0xc0 | u >> 6 ) );
+			buf.Extend( (char)( 0x80 | ( u & 0x3f ) ) );
+		    }
+		    else if( u < 0x10000 )
+		    {
+			buf.Extend( (char)( 0xe0 | u >> 12 ) );
+			buf.Extend( (char)( 0x80 | ( u >> 6 & 0x3f ) ) );
+			buf.Extend( (char)( 0x80 | ( u & 0x3f ) ) );
+		    }
+		    else
+		    {
+			buf.Extend( (char)( 0xf0 | u >> 18 ) );
+			buf.Extend( (char)( 0x80 | ( u >> 12 & 0x3f ) ) );
+			buf.Extend( (char)( 0x80 | ( u >> 6 & 0x3f ) ) );
+			buf.Extend( (char)( 0x80 | ( u & 0x3f ) ) );
+		    }
+		}
+		break;
+	    default:
+		return 0;
+	    }
+
+	    p = q;
+	}
+
+	buf.Terminate();
+
+	s.Set( (char *)p, e - p );
+
+	return GetChar( '"' );
+}
+
+/*
+ * Unpack a member value: a string, or the text of anything else.
+ */
+
+int
+JsonDict::UnpackValue( StrBuf &buf )
+{
+	if( s.Length() && s[0] == '"' )
+	    return UnpackString( buf );
+
+	p4size_t l = 0;
+
+	while( l < s.Length() && s[l] != ',' && s[l] != '}' &&
+	       !isspace( (unsigned char)s[l] ) )
+	    ++l;
+
+	if( !l )
+	    return 0;
+
+	buf.Set( s.Text(), l );
+	s.Set( s.Text() + l, s.Length() - l );
+
+	return 1;
+}
+
+/*
+ * Finish off the read of a JSON object.  The input is done with, so
+ * it's cleared: records written next (an error, say) start afresh.
+ */
+
+void
+JsonDict::EndRead( Error *e )
+{
+	SkipSpace();
+
+	if( !GetChar( '}' ) )
+	    e->Set( MsgClient::BadMarshalInput );
+
+	s.Set( "", 0 );
+	Clear();
+}
+
 /*******************************************************************************
  *  ClientUserMarshal methods
  ******************************************************************************/
@@ -1191,3 +1647,73 @@ ClientUserPhp::Prompt( const StrPtr &msg, StrBuf &buf, int noEcho, Error *e )
 {
     ClientUser::Prompt( msg, buf, noEcho, 1, e );
 }
+
+
+/*******************************************************************************
+ *  ClientUserJson methods
+ ******************************************************************************/
+
+/*
+ * ClientUserJson - ClientUser I/O is newline delimited JSON
+ *
+ * Records are streamed into the JsonDict itself, which is written
+ * out whenever it passes JSON_FLUSH bytes, so that a large tagged
+ * result costs neither a buffer nor a write per record.
+ */
+
+# define JSON_FLUSH	( 64 * 1024 )
+
+ClientUserJson::ClientUserJson()
+{
+	result = new JsonDict;
+}
+
+ClientUserJson::~ClientUserJson()
+{
+	Flush();
+}
+
+void
+ClientUserJson::WriteOutput( StrPtr *buf )
+{
+	if( buf->Length() >= JSON_FLUSH )
+	    Flush();
+}
+
+void
+ClientUserJson::Flush()
+{
+	if( result->Length() )
+	    fwrite( result->Text(), 1, result->Length(), stdout );
+
+	result->Clear();
+}
+
+/*
+ * Anything pending must reach the user before we wait on them,
+ * and input is read into the same buffer.  JsonDict::EndRead()
+ * clears the input away, so what's left after is a bad input or
+ * spec's error, which must go out too.
+ */
+
+void
+ClientUserJson::InputData( StrBuf *buf, Error *e )
+{
+	Flush();
+	fflush( stdout );
+	ClientUserMarshal::InputData( buf, e );
+	Flush();
+}
+
+void
+ClientUserJson::Prompt( const StrPtr &msg, StrBuf &buf, int noEcho, Error *e )
+{
+	Flush();
+	ClientUserMarshal::Prompt( msg, buf, noEcho, e );
+}
+
+void
+ClientUserJson::Finished()
+{
+	Flush();
+}
@@ -11,6 +11,8 @@
  * This implementation of ClientUser generates on stdout hash/
  * dictionary objects in the marshalled data format either Ruby or
  * Python. ClientUser::InputData reads such data from stdin.
+ * ClientUserJson writes (and reads) the same dictionaries as JSON
+ * objects, one per line.
  *
  * For ClientUser::OutputStat and InputData, if the 'spec' variable
  * is set (indicating that the data transferred is a cheesy ASCII form)
@@ -125,6 +127,23 @@ class ClientUserRuby : public ClientUserMarshal {
 			ClientUserRuby();
 } ;
 
+class ClientUserJson : public ClientUserMarshal {
+
+    public:
+			ClientUserJson();
+			~ClientUserJson();
+
+	virtual void	InputData( StrBuf *strbuf, Error *e );
+	virtual void	Prompt( const StrPtr &msg, StrBuf &buf,
+				int noEcho, Error *e );
+	virtual void	Finished();
+
+	virtual void	WriteOutput( StrPtr *buf );
+
+    private:
+	void		Flush();
+} ;
+
 
 /*
  * ClientUserPhp differs from the other ClientUserMarshal classes
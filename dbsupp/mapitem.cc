@@ -313,12 +313,23 @@ MapItem::Tree(
  *	   the last matching character in the parent's MapHalf, adjust it 
  *	   down if needed so as not to exceed the operlap with this
  *	   MapHalf, and start the match from there.
+ *
+ *	4. Trail.  With a MapTrail, the previous string's descent is
+ *	   replayed for as long as each step's Match1 looked only at
+ *	   the initial substring this string shares with that one.
+ *	   Sorted input mostly descends the same way each time.
  */
 
 MapItem *
-MapItem::Match( MapTableT dir, const StrPtr &from, MapItemArray *ands )
+MapItem::Match( 
+	MapTableT dir, 
+	const StrPtr &from, 
+	MapItemArray *ands,
+	MapTrail *trail )
 {
 	int coff = 0;
+	int step = 0;
+	int common = trail ? trail->Common( dir, from ) : -1;
 	int best = -1;
 	int bestnotands = -1;
 	int ourarray = 0;
@@ -362,9 +373,36 @@ MapItem::Match( MapTableT dir, const StrPtr &from, MapItemArray *ands )
 	     */
 
 	    int r = 0;
+	    MapTrail::Step *s = 0;
+
+	    if( common >= 0 && 
+		step < trail->count &&
+		( s = &trail->steps[ step ] )->tree == tree &&
+		s->extent <= common )
+	    {
+		r = s->r;
+		coff = s->coff;
+	    }
+	    else
+	    {
+		if( coff < t->half.GetFixedLen() )
+		    r = t->half.Match1( from, coff );
+
+		// Outcome depends on from[0..coff] on a mismatch,
+		// on from[0..fixedLen) on a match.
+
+		if( trail )
+		{
+		    common = -1;
+		    s = trail->Put( step );
+		    s->tree = tree;
+		    s->r = r;
+		    s->coff = coff;
+		    s->extent = r ? coff + 1 : t->half.GetFixedLen();
+		}
+	    }
 
-	    if( coff < t->half.GetFixedLen() )
-		r = t->half.Match1( from, coff );
+	    ++step;
 
 	    /*
 	     * Match?  Higher precedence?  Wildcard match?  Save. 
@@ -405,6 +443,13 @@ MapItem::Match( MapTableT dir, const StrPtr &from, MapItemArray *ands )
 	    else 		tree = t->center;
 	}
 
+	/*
+	 * Steps past where we stopped were for some earlier string.
+	 */
+
+	if( trail )
+	    trail->count = step;
+
 	/*
 	 * If we were dealing with & maps, we need to make sure we either:
 	 *   1. return the highest precedence non-andmap mapping
@@ -486,6 +531,48 @@ MapPairArray::Match( MapItem *item1, MapItem *tree2 )
 	} while( tree2 );
 }
 
+/*
+ * MapTrail -- remember the last descent for MapItem::Match()
+ */
+
+int
+MapTrail::Common( MapTableT dir, const StrPtr &from )
+{
+	// Different direction is a different tree: no trail.
+
+	int n = 0;
+
+	if( dir != this->dir )
+	    count = 0;
+	else
+	    for( ; n < (int)last.Length() && n < (int)from.Length(); n++ )
+		if( last[ n ] != from[ n ] )
+		    break;
+
+	this->dir = dir;
+	last.Set( from );
+
+	return n;
+}
+
+MapTrail::Step *
+MapTrail::Put( int n )
+{
+	if( n >= max )
+	{
+	    Step *o = steps;
+	    max = n + 32;
+	    steps = new Step[ max ];
+	    for( int i = 0; i < count; i++ )
+		steps[i] = o[i];
+	    delete []o;
+	}
+
+	count = n + 1;
+
+	return &steps[ n ];
+}
+
 /*
  * MapItemArray -- Slot ordered list of MapItems
  */
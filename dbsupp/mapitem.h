@@ -13,6 +13,7 @@
  */
 
 class MapItemArray;
+class MapTrail;
 class MapItem {
 
     public:
@@ -48,7 +49,7 @@ class MapItem {
 	void		Dump( MapTableT d, const char *name, int l = 0 );
 
 	MapItem *	Match( MapTableT dir, const StrPtr &from,
-			    MapItemArray *ands = 0 );
+			    MapItemArray *ands = 0, MapTrail *trail = 0 );
 
 	static MapItem *Tree( MapItem **s, MapItem **e,
 			    MapTableT dir, MapItem *parent,
@@ -192,6 +193,50 @@ class MapPairArray : public VVarArray {
 
 };
 
+/*
+ * MapTrail - the last descent of a MapTree, for MapItem::Match()
+ *
+ *	Records the MapHalf::Match1() outcome at each node visited, and
+ *	how much of the string each outcome depended on.  A following
+ *	string sharing that much of its initial substring gets the
+ *	same outcome without comparing again.  Only good for one tree:
+ *	Clear() it if the table changes.
+ *
+ *	MapTrail::Common() - length shared with the last string,
+ *		which then becomes this string.
+ */
+
+class MapTrail {
+
+    public:
+			MapTrail() { steps = 0; count = max = 0; dir = LHS; }
+			~MapTrail() { delete []steps; }
+
+	void		Clear() { count = 0; last.Clear(); }
+	int		Common( MapTableT dir, const StrPtr &from );
+
+    public:
+
+	struct Step {
+		MapItem	*tree;
+		int	r;
+		int	coff;
+		int	extent;
+	};
+
+	Step		*Put( int n );
+
+	Step		*steps;
+	int		count;
+
+    private:
+
+	int		max;
+	MapTableT	dir;
+	StrBuf		last;
+
+} ;
+
 /*
  * MapItemArray - array of MapItems, means for returning multiple results
  *                from Match()
@@ -235,6 +235,27 @@ class MapDisambiguate : public MapJoiner {
 	    map->Rhs()->Expand( *this, newRhs, params2 );
 	    m0->InsertNoDups( newLhs, newRhs, MfUnmap );
 	}
+
+	// Unmap whatever of map the higher precedence map2 occludes.
+
+	void Occlude()
+	{
+	    switch( map2->Flag() )
+	    {
+	    case MfRemap:
+	    case MfHavemap:
+		break;
+
+	    case MfAndmap:
+		map2->Lhs()->Join( map2->Rhs(), *this );
+		map2->Rhs()->Join( map->Rhs(), *this );
+		break;
+
+	    default:
+		map2->Lhs()->Join( map->Lhs(), *this );
+		map2->Rhs()->Join( map->Rhs(), *this );
+	    }
+	}
 } ;
 
 /*
@@ -300,6 +321,30 @@ MapTable::Disambiguate()
 {
 	MapDisambiguate j;
 
+	// Only mappings whose fixed (non-wild) heads and tails overlap
+	// can join, so rather than join each mapping against all those
+	// of higher precedence, we look them up in the LHS and RHS trees
+	// like MapTable::Join() does.  The trees give us candidates in
+	// slot order, so we need the chain to run in slot order (it
+	// does, short of a hand-slotted table) to keep the joins -- and
+	// thus InsertNoDups()' look back -- in their original order.
+
+	int indexed = count > 1;
+
+	for( MapItem *m = entry; indexed && m && m->Next(); m = m->Next() )
+	    if( m->Slot() <= m->Next()->Slot() )
+		indexed = 0;
+
+	if( indexed )
+	{
+	    if( !trees[ LHS ].tree ) MakeTree( LHS );
+	    if( !trees[ RHS ].tree ) MakeTree( RHS );
+	}
+
+	MapPairArray lhsPairs( LHS, LHS );
+	MapPairArray rhsPairs( RHS, RHS );
+	VarArray andmaps;
+
 	// From high precendence to low precedence
 
 	for( j.map = this->entry; j.map; j.map = j.map->Next() )
@@ -322,27 +367,54 @@ MapTable::Disambiguate()
 
 	    // From higher precedence back down to this mapping
 
-	    for( j.map2 = this->entry; 
-		 j.map2 != j.map;
-		 j.map2 = j.map2->Next() )
+	    if( !indexed )
 	    {
-		switch( j.map2->Flag() )
+		for( j.map2 = this->entry; 
+		     j.map2 != j.map;
+		     j.map2 = j.map2->Next() )
+		    j.Occlude();
+	    }
+	    else
+	    {
+		// Candidates from either tree, plus any &maps, which
+		// join against themselves whatever this mapping is.
+		// Sort() puts them back in precedence order; a mapping
+		// can turn up once from each tree.
+
+		lhsPairs.Clear();
+		lhsPairs.Match( j.map, trees[ LHS ].tree );
+
+		rhsPairs.Clear();
+		rhsPairs.Match( j.map, trees[ RHS ].tree );
+
+		for( int i = 0; i < rhsPairs.Count(); i++ )
+		    lhsPairs.Put( rhsPairs.Get( i ) );
+
+		for( int i = 0; i < andmaps.Count(); i++ )
+		    lhsPairs.Put( new MapPair( j.map, 
+				(MapItem *)andmaps.Get( i ), 0, 0 ) );
+
+		lhsPairs.Sort();
+
+		MapItem *last = 0;
+		MapPair *jp;
+
+		for( int i = 0; ( jp = lhsPairs.Get( i ) ); i++ )
 		{
-		case MfRemap:
-		case MfHavemap:
-		    break;
-
-		case MfAndmap:
-		    j.map2->Lhs()->Join( j.map2->Rhs(), j );
-		    j.map2->Rhs()->Join( j.map->Rhs(), j );
-		    break;
-
-		default:
-		    j.map2->Lhs()->Join( j.map->Lhs(), j );
-		    j.map2->Rhs()->Join( j.map->Rhs(), j );
+		    j.map2 = jp->tree2;
+		    delete jp;
+
+		    if( j.map2 == last || j.map2->Slot() <= j.map->Slot() )
+			continue;
+
+		    j.Occlude();
+		    last = j.map2;
 		}
 	    }
 
+	    if( j.map->Flag() == MfAndmap )
+		andmaps.Put( j.map );
+
 	    // now the original map entry
 
 	    j.m0->Insert( *j.map->Lhs(), *j.map->Rhs(), j.map->Flag() );
@@ -359,4 +431,3 @@ MapTable::Disambiguate()
 	Insert( j.m0, 1, 0 );
 	delete j.m0;
 }
-
@@ -636,14 +636,15 @@ MapItem *
 MapTable::Translate(
 	MapTableT dir,
 	const StrPtr &from,
-	StrBuf &to )
+	StrBuf &to,
+	MapTrail *trail )
 {
 	Error e;
 	if( !trees[ dir ].tree )
 	    MakeTree( dir );
 
 	MapItem *map = trees[ dir ].tree
-	    ? trees[ dir ].tree->Match( dir, from )
+	    ? trees[ dir ].tree->Match( dir, from, 0, trail )
 	    : 0;
 
 	// Expand into target string.
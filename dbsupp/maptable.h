@@ -118,6 +118,12 @@
  *		if nothing matches.  Direction is LHS (0) if 'from' 
  *		matches lhs, and RHS (1) if 'from' matches rhs.
  *
+ *	MapTable::Translate( MapTableT dir, char *from, StrBuf *to, trail )
+ *		As above, but remembers the search tree descent in the
+ *		MapTrail so that the next 'from' can skip the comparisons
+ *		of whatever initial substring it shares with this one.
+ *		Best for sorted input.
+ *
  *	MapTable::Validate( char *lhs, char *rhs, Error *e )
  *		Verifies that a mapping has the same wildcards on both
  *		sides.
@@ -135,6 +141,7 @@ class MapTree;
 class MapHalf;
 class StrBuf;
 class MapItemArray;
+class MapTrail;
 
 enum MapTableT { 
 	LHS, 		// do operation on left-hand-side strings
@@ -207,7 +214,8 @@ class MapTable {
 	MapTable *	StripMap( MapFlag mapFlag );
 	MapTable *	Swap( MapTable *m );
 	int		CountByFlag( MapFlag mapFlag );
-	MapItem *	Translate( MapTableT dir, const StrPtr &f, StrBuf &t );
+	MapItem *	Translate( MapTableT dir, const StrPtr &f, StrBuf &t,
+			    MapTrail *trail = 0 );
 	MapItemArray *	Explode( MapTableT dir, const StrPtr &f );
 	void		Validate( const StrPtr &l, const StrPtr &r, Error *e );
 	void		ValidHalf( MapTableT dir, Error *e );
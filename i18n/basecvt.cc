@@ -12,6 +12,13 @@
  * UTF-8 to UTF-16 conversions.
  */
 
+# define NEED_THREADS
+
+# ifdef OS_NT
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+# endif // OS_NT
+
 #include <stdhdrs.h>
 #include <strbuf.h>
 #include <debug.h>
@@ -19,6 +26,7 @@
 #include "i18napi.h"
 #include "charcvt.h"
 #include "charman.h"
+#include "utfscan.h"
 
 CharSetCvt::~CharSetCvt()
 {
@@ -340,6 +348,25 @@ CharSetCvtUTF816::Cvt(const char **sourcestart, const char *sourceend,
 
 	while( *sourcestart < sourceend && *targetstart < targetend - 1 )
 	{
+	    // Widen runs of ASCII a block at a time.
+
+	    if( !( **sourcestart & 0x80 ) )
+	    {
+		int n = sourceend - *sourcestart;
+
+		if( n > ( targetend - *targetstart ) / 2 )
+		    n = ( targetend - *targetstart ) / 2;
+
+		n = UtfScan::AsciiToUtf16( *sourcestart, n,
+					   *targetstart, fileinvert );
+		CountAscii( *sourcestart, n );
+
+		*sourcestart += n;
+		*targetstart += 2 * n;
+		checkBOM = 0;
+		continue;
+	    }
+
 	    v = **sourcestart & 0xff;
 	    int l;
 	    if ( v & 0x80 )
@@ -452,6 +479,28 @@ CharSetCvtUTF168::Cvt(const char **sourcestart, const char *sourceend,
 
 	while( *sourcestart < sourceend-1 && *targetstart < targetend )
 	{
+	    // Narrow runs of ASCII a block at a time, once past any BOM.
+	    // (v is left as the last character, as the loop below would.)
+
+	    if( !checkBOM )
+	    {
+		int n = ( sourceend - *sourcestart ) / 2;
+
+		if( n > targetend - *targetstart )
+		    n = targetend - *targetstart;
+
+		n = UtfScan::Utf16ToAscii( *sourcestart, n,
+					   *targetstart, fileinvert );
+
+		if( n )
+		{
+		    *sourcestart += 2 * n;
+		    *targetstart += n;
+		    v = (*targetstart)[-1] & 0xff;
+		    continue;
+		}
+	    }
+
 	    if( fileinvert )
 	    {
 		v = **sourcestart & 0xff;
@@ -602,3 +651,193 @@ CharSetCvt::MapThru(unsigned short v,
 
 	return d;
 }
+
+/*
+ * CharSetCvt::MapIndex - direct lookup over a MapEnt table
+ *
+ * Each entry is filled in with MapThru()'s own answer, so tables
+ * with duplicates (or out of order, as UCS2toEUCJP is) index the
+ * same way they search.  No table maps anything to 0xffff, which
+ * marks the unmapped slots.
+ */
+
+CharSetCvt::MapIndex::MapIndex( const MapEnt *m, int n )
+{
+	table = m;
+	next = 0;
+
+	empty = new unsigned short[ 256 ];
+	for( int i = 0; i < 256; i++ )
+	{
+	    empty[ i ] = NOMAP;
+	    pages[ i ] = empty;
+	}
+
+	for( const MapEnt *e = m; e < m + n; e++ )
+	{
+	    unsigned short *&p = pages[ e->cfrom >> 8 ];
+
+	    if( p == empty )
+	    {
+		p = new unsigned short[ 256 ];
+		memcpy( p, empty, 256 * sizeof( *p ) );
+	    }
+
+	    p[ e->cfrom & 0xff ] = MapThru( e->cfrom, m, n, NOMAP );
+	}
+
+	for( int c = 0; c < 128; c++ )
+	    asciiStop[ c ] = c > 0x20 && Map( c, NOMAP ) != c;
+}
+
+CharSetCvt::MapIndex::~MapIndex()
+{
+	for( int i = 0; i < 256; i++ )
+	    if( pages[ i ] != empty )
+		delete [] pages[ i ];
+
+	delete [] empty;
+}
+
+/*
+ * CharSetCvt::FindIndex() - get the MapIndex for a table, building it
+ *
+ * The indexes are kept for the life of the process.  There are only a
+ * handful of tables, but converters (and case folding) are built from
+ * many threads, so the list is locked.  It's called as converters are
+ * constructed and during static initialization (charfold.cc), so on
+ * NT the lock is created on first use rather than by an initializer.
+ */
+
+static CharSetCvt::MapIndex *mapIndexes;
+
+# ifdef OS_NT
+static HANDLE mapIndexLock;
+
+static HANDLE
+MapIndexLock()
+{
+	if( !mapIndexLock )
+	{
+	    HANDLE h = CreateMutex( NULL, FALSE, NULL );
+
+	    if( InterlockedCompareExchangePointer(
+			(PVOID volatile *)&mapIndexLock, h, NULL ) )
+		CloseHandle( h );
+	}
+
+	return mapIndexLock;
+}
+# elif defined( HAVE_PTHREAD )
+static pthread_mutex_t mapIndexLock = PTHREAD_MUTEX_INITIALIZER;
+# endif
+
+static struct MapIndexCleanup {
+	~MapIndexCleanup()
+	{
+	    while( CharSetCvt::MapIndex *x = mapIndexes )
+	    {
+		mapIndexes = x->next;
+		delete x;
+	    }
+	}
+} mapIndexCleanup;
+
+const CharSetCvt::MapIndex *
+CharSetCvt::FindIndex( const MapEnt *m, int n )
+{
+	MapIndex *x;
+
+# ifdef OS_NT
+	WaitForSingleObject( MapIndexLock(), INFINITE );
+# elif defined( HAVE_PTHREAD )
+	pthread_mutex_lock( &mapIndexLock );
+# endif
+
+	for( x = mapIndexes; x; x = x->next )
+	    if( x->table == m )
+		break;
+
+	if( !x )
+	{
+	    x = new MapIndex( m, n );
+	    x->next = mapIndexes;
+	    mapIndexes = x;
+	}
+
+# ifdef OS_NT
+	ReleaseMutex( mapIndexLock );
+# elif defined( HAVE_PTHREAD )
+	pthread_mutex_unlock( &mapIndexLock );
+# endif
+
+	return x;
+}
+
+/*
+ * CharSetCvt::CopyAscii() - copy a run of 7-bit characters straight
+ *
+ * For converters that pass ASCII through unchanged: copies from the
+ * source up to the first byte with the high bit set, or flagged in
+ * 'stop' (if given), scanning a block at a time where it can, and
+ * keeps the line and character counts.  Returns the bytes copied.
+ */
+
+int
+CharSetCvt::CopyAscii( const char **sourcestart, const char *sourceend,
+		char **targetstart, char *targetend, const char *stop )
+{
+	int n = sourceend - *sourcestart;
+
+	if( n > targetend - *targetstart )
+	    n = targetend - *targetstart;
+
+	if( !stop )
+	{
+	    n = UtfScan::AsciiSpan( *sourcestart, n );
+	}
+	else
+	{
+	    const unsigned char *s = (const unsigned char *)*sourcestart;
+	    const unsigned char *p = s;
+	    const unsigned char *e = s + n;
+
+	    while( p < e && !( *p & 0x80 ) && !stop[ *p ] )
+		++p;
+
+	    n = p - s;
+	}
+
+	if( !n )
+	    return 0;
+
+	memcpy( *targetstart, *sourcestart, n );
+	CountAscii( *sourcestart, n );
+
+	*sourcestart += n;
+	*targetstart += n;
+
+	return n;
+}
+
+/*
+ * CharSetCvt::CountAscii() - line and character counts for a run
+ *
+ * Same counting as the converters do a character at a time.
+ */
+
+void
+CharSetCvt::CountAscii( const char *p, int n )
+{
+	const char *e = p + n;
+	const char *nl;
+
+	while( ( nl = (const char *)memchr( p, '\n', e - p ) ) )
+	{
+	    ++linecnt;
+	    charcnt = 0;
+	    p = nl + 1;
+	}
+
+	charcnt += e - p;
+}
@@ -419,6 +419,14 @@ CharSetCvtUTF8toShiftJis::Cvt(const char **sourcestart, const char *sourceend,
 
 	while (*sourcestart < sourceend && *targetstart < targetend)
 	{
+# ifndef UNICODEMAPPING
+	    if( !( **sourcestart & 0x80 ) &&
+		CopyAscii( sourcestart, sourceend, targetstart, targetend, 0 ) )
+	    {
+		checkBOM = 0;
+		continue;
+	    }
+# endif
 	    v = **sourcestart & 0xff;
 	    int l;
 	    if (v & 0x80)
@@ -448,7 +456,7 @@ CharSetCvtUTF8toShiftJis::Cvt(const char **sourcestart, const char *sourceend,
 		    }
 # endif
 		    // at this point v is UCS 2
-		    newv = MapThru(v, UCS2toShiftJis, MapCount(), 0xfffd);
+		    newv = index->Map(v, 0xfffd);
 		    if (newv != 0xfffd)
 		    {
 		    emitit:		    
@@ -530,6 +538,11 @@ CharSetCvtShiftJistoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 
     while (*sourcestart < sourceend && *targetstart < targetend)
     {
+	if( !( **sourcestart & 0x80 ) &&
+	    CopyAscii( sourcestart, sourceend, targetstart, targetend,
+			index->asciiStop ) )
+	    continue;
+
 	v = **sourcestart & 0xff;
 	int l = 0;
 	if ((v & 0x80) && (v < 0xa1 || v >= 0xe0))
@@ -545,7 +558,7 @@ CharSetCvtShiftJistoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 	}
 	oldv = v;
 	if (v > 0x20)
-	    v = MapThru(v, ShiftJistoUCS2, MapCount(), 0xfffd);
+	    v = index->Map(v, 0xfffd);
 	if (v == 0xfffd)
 	{
 	    int upper, lower;
@@ -645,6 +658,14 @@ CharSetCvtUTF8toEUCJP::Cvt(const char **sourcestart, const char *sourceend,
 
 	while (*sourcestart < sourceend && *targetstart < targetend)
 	{
+	    if( !( **sourcestart & 0x80 ) &&
+		CopyAscii( sourcestart, sourceend, targetstart, targetend,
+			index->asciiStop ) )
+	    {
+		checkBOM = 0;
+		continue;
+	    }
+
 	    v = **sourcestart & 0xff;
 
 	    int l = 0; // extra characters expected
@@ -679,7 +700,7 @@ CharSetCvtUTF8toEUCJP::Cvt(const char **sourcestart, const char *sourceend,
 		    // at this point v is UCS 2
 		case 0:
 		    oldv = v;
-		    v = MapThru(v, UCS2toEUCJP, MapCount(), 0xfffd);
+		    v = index->Map(v, 0xfffd);
 		    if (v == 0xfffd && oldv >= 0xe000 && oldv <= 0xe757)
 		    {
 			// user defined character
@@ -759,6 +780,14 @@ CharSetCvtEUCJPtoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 
 	while( (*sourcestart < sourceend) && (*targetstart < targetend) )
 	{
+	    // 0x7f is a lead byte here, but the table doesn't map it
+	    // so asciiStop stops on it.
+
+	    if( !( **sourcestart & 0x80 ) &&
+		CopyAscii( sourcestart, sourceend, targetstart, targetend,
+			index->asciiStop ) )
+		continue;
+
 	    v = **sourcestart & 0xff;
 
 	    int l = 0; // extra characters expected
@@ -791,7 +820,7 @@ CharSetCvtEUCJPtoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 	    }
 	    oldv = v;
 	    if ( v > 0x20 )
-		v = MapThru(v, EUCJPtoUCS2, MapCount(), 0xfffd);
+		v = index->Map(v, 0xfffd);
 	    if (v == 0xfffd)
 	    {
 		// check for user-defined character
@@ -984,6 +1013,13 @@ CharSetCvtUTF8toCp::Cvt(const char **sourcestart, const char *sourceend,
 
 	while (*sourcestart < sourceend && *targetstart < targetend)
 	{
+	    if( !( **sourcestart & 0x80 ) &&
+		CopyAscii( sourcestart, sourceend, targetstart, targetend, 0 ) )
+	    {
+		checkBOM = 0;
+		continue;
+	    }
+
 	    v = **sourcestart & 0xff;
 	    int l;
 	    if (v & 0x80)
@@ -1013,7 +1049,7 @@ CharSetCvtUTF8toCp::Cvt(const char **sourcestart, const char *sourceend,
 		    }
 # endif
 		    // at this point v is UCS 2
-		    newv = MapThru(v, toMap, toMapSize, 0xfffd);
+		    newv = index->Map(v, 0xfffd);
 		    if (newv != 0xfffd)
 		    {
 		    emitit:		    
@@ -1122,6 +1158,10 @@ CharSetCvtCptoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 
     while (*sourcestart < sourceend && *targetstart < targetend)
     {
+	if( !( **sourcestart & 0x80 ) &&
+	    CopyAscii( sourcestart, sourceend, targetstart, targetend, 0 ) )
+	    continue;
+
 	v = **sourcestart & 0xff;
 	int l = 0;
 	if ( isDoubleByte( v ) )
@@ -1137,7 +1177,7 @@ CharSetCvtCptoUTF8::Cvt(const char **sourcestart, const char *sourceend,
 	}
 	oldv = v;
 	if (v > 0x7f)
-	    v = MapThru(v, toMap, toMapSize, 0xfffd);
+	    v = index->Map(v, 0xfffd);
 	if (v == 0xfffd)
 	{
 	    lasterr = NOMAPPING;
@@ -62,6 +62,42 @@ public:
 	unsigned short cfrom, cto;
     };
 
+    /*
+     * MapIndex - direct lookup over a MapEnt table
+     *
+     * Built once per table (see FindIndex()) as 256 pages of 256
+     * entries indexed by the high then low byte, giving the same
+     * answers as MapThru() on that table without its binary search.
+     * Pages with no entries share one empty page.  asciiStop flags
+     * the 7-bit characters above 0x20 the table doesn't map to
+     * themselves, for converters whose ASCII goes through the table.
+     * Converters look theirs up when constructed, not on each Cvt().
+     */
+
+    class MapIndex {
+    public:
+	MapIndex( const MapEnt *m, int n );
+	~MapIndex();
+
+	unsigned short Map( unsigned short v, unsigned short d ) const
+	{
+	    unsigned short c = pages[ v >> 8 ][ v & 0xff ];
+	    return c == NOMAP ? d : c;
+	}
+
+	const MapEnt *table;
+	char asciiStop[ 128 ];
+	MapIndex *next;
+
+    private:
+	enum { NOMAP = 0xffff };
+
+	unsigned short *pages[ 256 ];
+	unsigned short *empty;
+    };
+
+    static const MapIndex *FindIndex( const MapEnt *, int );
+
     static char bytesFromUTF8[];
     static unsigned long offsetsFromUTF8[];
     static unsigned long minimumFromUTF8[];
@@ -83,6 +119,10 @@ protected:
 
     static unsigned short MapThru( unsigned short, const MapEnt *,
 		int, unsigned short );
+
+    int CopyAscii( const char **sourcestart, const char *sourceend,
+		char **targetstart, char *targetend, const char *stop );
+    void CountAscii( const char *, int );
 private:
     char *fastbuf;
     int fastsize;
@@ -208,6 +248,9 @@ class CharSetCvt8859_1toUTF8 : public CharSetCvt {
 
 class CharSetCvtUTF8toShiftJis : public CharSetCvtFromUTF8 {
  public:
+    CharSetCvtUTF8toShiftJis()
+	: index( FindIndex( UCS2toShiftJis, MapCount() ) ) {}
+
     virtual CharSetCvt *Clone();
 
     virtual CharSetCvt *ReverseCvt();
@@ -217,6 +260,7 @@ class CharSetCvtUTF8toShiftJis : public CharSetCvtFromUTF8 {
 
 private:
     static MapEnt UCS2toShiftJis[];
+    const MapIndex *index;
 
     friend void verifymaps();
     friend void dumpmaps();
@@ -229,6 +273,9 @@ private:
 
 class CharSetCvtShiftJistoUTF8 : public CharSetCvt {
  public:
+    CharSetCvtShiftJistoUTF8()
+	: index( FindIndex( ShiftJistoUCS2, MapCount() ) ) {}
+
     virtual CharSetCvt *Clone();
 
     virtual CharSetCvt *ReverseCvt();
@@ -240,6 +287,7 @@ class CharSetCvtShiftJistoUTF8 : public CharSetCvt {
 
 private:
     static MapEnt ShiftJistoUCS2[];
+    const MapIndex *index;
 
     friend void verifymaps();
     friend void dumpmaps();
@@ -252,6 +300,9 @@ private:
 
 class CharSetCvtUTF8toEUCJP : public CharSetCvtFromUTF8 {
  public:
+    CharSetCvtUTF8toEUCJP()
+	: index( FindIndex( UCS2toEUCJP, MapCount() ) ) {}
+
     virtual CharSetCvt *Clone();
 
     virtual CharSetCvt *ReverseCvt();
@@ -261,6 +312,7 @@ class CharSetCvtUTF8toEUCJP : public CharSetCvtFromUTF8 {
 
 private:
     static MapEnt UCS2toEUCJP[];
+    const MapIndex *index;
 
     friend void verifymaps();
     friend void dumpmaps();
@@ -273,6 +325,9 @@ private:
 
 class CharSetCvtEUCJPtoUTF8 : public CharSetCvt {
  public:
+    CharSetCvtEUCJPtoUTF8()
+	: index( FindIndex( EUCJPtoUCS2, MapCount() ) ) {}
+
     virtual CharSetCvt *Clone();
 
     virtual CharSetCvt *ReverseCvt();
@@ -284,6 +339,7 @@ class CharSetCvtEUCJPtoUTF8 : public CharSetCvt {
 
 private:
     static MapEnt EUCJPtoUCS2[];
+    const MapIndex *index;
 
     friend void verifymaps();
     friend void dumpmaps();
@@ -334,7 +390,7 @@ private:
 class CharSetCvtUTF8toCp : public CharSetCvtFromUTF8 {
  protected:
     CharSetCvtUTF8toCp( const MapEnt *tMap, int toSz )
-	: toMap(tMap), toMapSize(toSz) {}
+	: toMap(tMap), toMapSize(toSz), index( FindIndex( tMap, toSz ) ) {}
 
  public:
     virtual int Cvt(const char **sourcestart, const char *sourceend,
@@ -343,6 +399,7 @@ class CharSetCvtUTF8toCp : public CharSetCvtFromUTF8 {
 private:
     const MapEnt *toMap;
     int toMapSize;
+    const MapIndex *index;
     virtual void printmap( unsigned short, unsigned short, unsigned short );
     virtual void printmap( unsigned short, unsigned short );
 };
@@ -410,7 +467,7 @@ class CharSetCvtUTF8toCp950 : public CharSetCvtUTF8toCp
 class CharSetCvtCptoUTF8 : public CharSetCvt {
  protected:
     CharSetCvtCptoUTF8( const MapEnt *tMap, int toSz )
-	: toMap(tMap), toMapSize(toSz) {}
+	: toMap(tMap), toMapSize(toSz), index( FindIndex( tMap, toSz ) ) {}
 
  public:
     virtual int Cvt(const char **sourcestart, const char *sourceend,
@@ -419,6 +476,7 @@ class CharSetCvtCptoUTF8 : public CharSetCvt {
  private:
     const MapEnt *toMap;
     int toMapSize;
+    const MapIndex *index;
     virtual int isDoubleByte( int leadByte ) = 0;
     virtual void printmap( unsigned short, unsigned short, unsigned short );
     virtual void printmap( unsigned short, unsigned short );
@@ -2,6 +2,7 @@
 #include <strbuf.h>
 #include "i18napi.h"
 #include "charcvt.h"
+#include "utfscan.h"
 
 static const CharSetCvt::MapEnt caseFold[] = {
 0x00B5, 0x03BC, // MICRO SIGN
@@ -1030,101 +1031,200 @@ static const int caseFoldCnt = sizeof( caseFold ) / sizeof( *caseFold );
 static const int extendedCaseFoldCnt =
     sizeof( extendedCaseFold ) / sizeof( *extendedCaseFold );
 
-int
-CharSetCvt::Utf8Fold( const StrPtr *s, StrBuf *d )
+/*
+ * Utf8FoldRun() - fold a run of UTF-8, appending it to d
+ *
+ * ASCII is lowered a block at a time; everything else is looked up
+ * through direct indexes over caseFold and extendedCaseFold, which
+ * answer as MapThru() on them would.  The indexes are found at static
+ * init, before there are threads to race for them.  If the fold reaches
+ * 'mark' on a character boundary, *markLen gets the length of d there.
+ */
+
+static const CharSetCvt::MapIndex *foldIndex =
+	CharSetCvt::FindIndex( caseFold, caseFoldCnt );
+static const CharSetCvt::MapIndex *extendedFoldIndex =
+	CharSetCvt::FindIndex( extendedCaseFold, extendedCaseFoldCnt );
+
+static int
+Utf8FoldRun( const unsigned char *t, const unsigned char *e, StrBuf *d,
+	const unsigned char *mark = 0, int *markLen = 0 )
 {
-	const unsigned char *t = s->UText();
-	const unsigned char *e = s->UEnd();
 	int v, l;
 
-	while( t < e )
+	for( ;; )
 	{
+	    if( t == mark )
+		*markLen = d->Length();
+
+	    if( t >= e )
+		break;
+
+	    if( !( *t & 0x80 ) )
+	    {
+		int n = ( t < mark ? mark : e ) - t;
+		char *o = d->Alloc( n );
+		int m = UtfScan::AsciiLower( (const char *)t, n, o );
+		d->SetLength( d->Length() - ( n - m ) );
+		t += m;
+		continue;
+	    }
+
 	    v = *t++;
-	    if( v & 0x80 )
+	    l = CharSetCvt::bytesFromUTF8[ v ];
+	    if ( l + t > e )
 	    {
-		l = CharSetCvt::bytesFromUTF8[ v ];
-		if ( l + t > e )
-		{
-		    // lasterr = PARTIALCHAR;
-		    return 1;
-		}
-		switch( l )
+		// lasterr = PARTIALCHAR;
+		return 1;
+	    }
+	    switch( l )
+	    {
+	    default:
+		// lasterr = NOMAPPING;
+		return 1;
+	    case 3:
+		v <<= 6;
+		v += 0xff & *t++;
+		// fall through...
+	    case 2:
+		v <<= 6;
+		v += 0xff & *t++;
+		// fall through...
+	    case 1:
+		v <<= 6;
+		v += 0xff & *t++;
+		v -= CharSetCvt::offsetsFromUTF8[l];
+# ifdef STRICT_UTF8
+		if( v < CharSetCvt::minimumFromUTF8[l] )
 		{
-		default:
+		    // illegal over long UTF8 sequence
 		    // lasterr = NOMAPPING;
 		    return 1;
-		case 3:
-		    v <<= 6;
-		    v += 0xff & *t++;
-		    // fall through...
-		case 2:
-		    v <<= 6;
-		    v += 0xff & *t++;
-		    // fall through...
-		case 1:
-		    v <<= 6;
-		    v += 0xff & *t++;
-		    v -= CharSetCvt::offsetsFromUTF8[l];
-# ifdef STRICT_UTF8
-		    if( v < CharSetCvt::minimumFromUTF8[l] )
-		    {
-			// illegal over long UTF8 sequence
-			// lasterr = NOMAPPING;
-			return 1;
-		    }
-#endif
 		}
-		// v is unicode position
+#endif
+	    }
+	    // v is unicode position
 # ifdef STRICT_UTF8
-		// check for invalid unicode positions
-		if( ( v & 0xfffe ) == 0xfffe || ( v & 0x1ff800 ) == 0xd800 ||
-		    ( v >= 0xfdd0 && v <= 0xfdef ) )
-		{
-		    //lasterr = NOMAPPING;
-		    return 1;
-		}
+	    // check for invalid unicode positions
+	    if( ( v & 0xfffe ) == 0xfffe || ( v & 0x1ff800 ) == 0xd800 ||
+		( v >= 0xfdd0 && v <= 0xfdef ) )
+	    {
+		//lasterr = NOMAPPING;
+		return 1;
+	    }
 # endif
-		// fold and extend
-		if( v < 0x10000 )
+	    // fold and extend
+	    if( v < 0x10000 )
+	    {
+		unsigned short f = foldIndex->Map( v, 0 );
+		if( f )
+		    v = f;
+		// extend emited multi-byte character
+		if( v >= 0x800 )
 		{
-		    unsigned short f = CharSetCvt::MapThru( v,
-			caseFold, caseFoldCnt, 0 );
-		    if( f )
-			v = f;
-		    // extend emited multi-byte character
-		    if( v >= 0x800 )
-		    {
-			d->Extend( 0xe0 | ( v >> 12 ) );
-			d->Extend( 0x80 | (( v >> 6 ) & 0x3f ) );
-		    }
-		    else
-		    {
-			d->Extend( 0xc0 | ( v >> 6 ) );
-		    }
+		    d->Extend( 0xe0 | ( v >> 12 ) );
+		    d->Extend( 0x80 | (( v >> 6 ) & 0x3f ) );
 		}
 		else
 		{
-		    // extended Plane
-		    // note we can not fold into here or from here...
-		    unsigned short f = CharSetCvt::MapThru( v & 0xffff,
-			extendedCaseFold, extendedCaseFoldCnt, 0 );
-		    if( f )
-			v = f | 0x10000;
-		    d->Extend( 0xf0 | ( v >> 18 ) );
-		    d->Extend( 0x80 | ( ( v >> 12 ) & 0x3f ) );
-		    d->Extend( 0x80 | ( ( v >> 6 ) & 0x3f ) );
+		    d->Extend( 0xc0 | ( v >> 6 ) );
 		}
-		d->Extend( 0x80 | ( v & 0x3f ) );
 	    }
 	    else
 	    {
-		// simple ASCII fold
-		if( v >= 'A' && v <= 'Z' )
-		    d->Extend( v + 'a' - 'A' );
-		else
-		    d->Extend( v );
+		// extended Plane
+		// note we can not fold into here or from here...
+		unsigned short f = extendedFoldIndex->Map( v & 0xffff, 0 );
+		if( f )
+		    v = f | 0x10000;
+		d->Extend( 0xf0 | ( v >> 18 ) );
+		d->Extend( 0x80 | ( ( v >> 12 ) & 0x3f ) );
+		d->Extend( 0x80 | ( ( v >> 6 ) & 0x3f ) );
 	    }
+	    d->Extend( 0x80 | ( v & 0x3f ) );
 	}
 
 	return 0;
 }
+
+/*
+ * CharSetCvt::Utf8Fold() - case fold UTF-8, appending it to d
+ *
+ * Returns non-zero if s isn't valid UTF-8.  Paths being folded one
+ * after another mostly share their directories, so the folded form
+ * of the last few directory prefixes is kept per thread and reused;
+ * where MT_STATIC isn't per thread there's no cache, as it would be
+ * shared unlocked.  Folding is per character, so a
+ * prefix that the fold left on a character boundary folds the same
+ * in front of anything.
+ */
+
+# define FOLDCACHE_SIZE	4
+# define FOLDCACHE_MAX	240
+
+struct FoldCacheEnt {
+	int	len;
+	int	flen;
+	char	src[ FOLDCACHE_MAX ];
+	char	fold[ FOLDCACHE_MAX * 3 / 2 ];
+} ;
+
+# ifdef HAVE_MT_STATIC
+MT_STATIC FoldCacheEnt foldCache[ FOLDCACHE_SIZE ];
+MT_STATIC int foldCacheNext;
+# endif
+
+int
+CharSetCvt::Utf8Fold( const StrPtr *s, StrBuf *d )
+{
+	const unsigned char *t = s->UText();
+	const unsigned char *e = s->UEnd();
+
+# ifndef HAVE_MT_STATIC
+	return Utf8FoldRun( t, e, d );
+# else
+	// The directory prefix runs through the last separator.
+
+	const unsigned char *p = e;
+
+	while( p > t && p[-1] != '/' && p[-1] != '\\' )
+	    --p;
+
+	int len = p - t;
+
+	if( !len || len > FOLDCACHE_MAX )
+	    return Utf8FoldRun( t, e, d );
+
+	for( int i = 0; i < FOLDCACHE_SIZE; i++ )
+	{
+	    FoldCacheEnt &c = foldCache[ i ];
+
+	    if( c.len == len && !memcmp( c.src, t, len ) )
+	    {
+		d->Extend( c.fold, c.flen );
+		return Utf8FoldRun( p, e, d );
+	    }
+	}
+
+	int start = d->Length();
+	int mark = -1;
+
+	if( Utf8FoldRun( t, e, d, p, &mark ) )
+	    return 1;
+
+	int flen = mark - start;
+
+	if( mark >= 0 && flen <= (int)sizeof( foldCache[0].fold ) )
+	{
+	    FoldCacheEnt &c = foldCache[ foldCacheNext ];
+	    foldCacheNext = ( foldCacheNext + 1 ) % FOLDCACHE_SIZE;
+
+	    c.len = len;
+	    c.flen = flen;
+	    memcpy( c.src, t, len );
+	    memcpy( c.fold, d->Text() + start, flen );
+	}
+
+	return 0;
+# endif
+}
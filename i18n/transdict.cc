@@ -19,24 +19,235 @@
 # include "charcvt.h"
 # include "transdict.h"
 
+/*
+ * TransDict - a client's dictionary, as seen through a charset
+ *
+ * Values fetched from the server's dictionary ('other') are converted
+ * and kept here for the rest of the message, indexed by name so that
+ * later lookups needn't scan the table.
+ *
+ * Variable names are protocol tags, and most values (paths, revs,
+ * digests, sizes) are 7-bit too.  When the converters pass 7-bit text
+ * through unchanged -- as all but the UTF-16/32 ones do -- such names
+ * and values skip conversion, and 7-bit values are handed back from
+ * 'other' as they are, without a copy.
+ */
+
+static int
+TransAscii( const char *p, int l )
+{
+	// 0x01 - 0x7f: NUL goes through the converter, in case
+
+	for( ; l > 0; --l, ++p )
+	    if( (unsigned char)( *p - 1 ) >= 0x7f )
+		return 0;
+
+	return 1;
+}
+
+static int
+TransProbe( CharSetCvt *cvt )
+{
+	// Does the converter pass 7-bit text unchanged?
+
+	char ascii[ 127 ];
+	int l;
+
+	for( int i = 0; i < 127; i++ )
+	    ascii[i] = i + 1;
+
+	cvt->ResetErr();
+	const char *t = cvt->FastCvt( ascii, sizeof( ascii ), &l );
+	int same = t && l == sizeof( ascii ) && !memcmp( t, ascii, l );
+
+	cvt->ResetErr();
+	cvt->ResetCnt();
+
+	return same;
+}
+
+static unsigned int
+TransHash( const StrPtr &var )
+{
+	unsigned int h = 0;
+	const char *p = var.Text();
+
+	for( int l = var.Length(); l > 0; --l )
+	    h = 293 * h + (unsigned char)*p++;
+
+	return h;
+}
+
 TransDict::TransDict(StrDict *o, CharSetCvt *f)
     : other(o), fromOther(f)
 {
 	toOther = f->ReverseCvt();
+
+	fromAscii = TransProbe( fromOther );
+	toAscii = TransProbe( toOther );
+
+	transerr = 0;
+	index = 0;
+	indexSize = 0;
+	quesDict = 0;
 }
 
 TransDict::~TransDict()
 {
+	delete quesDict;
+	delete []index;
 	delete fromOther;
 	delete toOther;
 }
 
+/*
+ * TransDict::ErrorOutputDict() - a TransDictQues for an incoming message
+ *
+ * Unlike CreateErrorOutputDict(), the dictionary is ours: it is
+ * cleared and handed out again for the next message.
+ */
+
+TransDictQues *
+TransDict::ErrorOutputDict()
+{
+	if( !quesDict )
+	    quesDict = CreateErrorOutputDict();
+
+	quesDict->Clear();
+
+	return quesDict;
+}
+
+/*
+ * TransDict::Find() - look up a translated variable in the index
+ * TransDict::Remember() - index the variable just added, return its value
+ * TransDict::Insert() - add the x'th variable to the index
+ * TransDict::Reindex() - rebuild the index, sized for the table
+ *
+ * The index is open addressed, at most half full, and holds the
+ * table position + 1 (0 for an empty slot).  Like StrBufDict's scan,
+ * it finds the first of any variables set twice.
+ */
+
+int
+TransDict::Find( const StrPtr &var )
+{
+	if( !indexSize )
+	    return -1;
+
+	StrRef v, val;
+
+	for( unsigned int h = TransHash( var ); ; ++h )
+	{
+	    int x = index[ h & ( indexSize - 1 ) ] - 1;
+
+	    if( x < 0 )
+		return -1;
+
+	    StrBufDict::VGetVarX( x, v, val );
+
+	    if( v == var )
+		return x;
+	}
+}
+
+StrPtr *
+TransDict::Remember()
+{
+	int x = GetCount() - 1;
+
+	if( GetCount() * 2 > indexSize )
+	    Reindex();
+	else
+	    Insert( x );
+
+	return GetValX( x );
+}
+
+void
+TransDict::Insert( int x )
+{
+	StrRef var, val, v;
+
+	StrBufDict::VGetVarX( x, var, val );
+
+	for( unsigned int h = TransHash( var ); ; ++h )
+	{
+	    int *slot = &index[ h & ( indexSize - 1 ) ];
+
+	    if( !*slot )
+	    {
+		*slot = x + 1;
+		return;
+	    }
+
+	    StrBufDict::VGetVarX( *slot - 1, v, val );
+
+	    if( v == var )
+		return;
+	}
+}
+
+void
+TransDict::Reindex()
+{
+	int size = 16;
+
+	while( size < GetCount() * 2 )
+	    size <<= 1;
+
+	if( size > indexSize )
+	{
+	    delete []index;
+	    index = new int[ size ];
+	    indexSize = size;
+	}
+
+	memset( index, 0, indexSize * sizeof( int ) );
+
+	for( int x = 0; x < GetCount(); x++ )
+	    Insert( x );
+}
+
+void
+TransDict::VClear()
+{
+	if( GetCount() )
+	    memset( index, 0, indexSize * sizeof( int ) );
+
+	StrBufDict::VClear();
+}
+
+void
+TransDict::VRemoveVar( const StrPtr &var )
+{
+	// Client::VSetVar() calls this for every variable it sets,
+	// so don't scan the table for ones we never translated.
+
+	if( Find( var ) < 0 )
+	    return;
+
+	while( StrBufDict::VGetVar( var ) )
+	    StrBufDict::VRemoveVar( var );
+
+	Reindex();
+}
+
 void
 TransDict::VSetVar( const StrPtr &var, const StrPtr &val )
 {
 	int translen;
 	const char *transbuf;
 
+	// 7-bit: other has it just as we'd return it
+
+	if( toAscii && TransAscii( val.Text(), val.Length() ) )
+	{
+	    other->SetVar( var, val );
+	    transerr = 0;
+	    return;
+	}
+
 	toOther->ResetErr();
 	transbuf = toOther->FastCvt(val.Text(),	val.Length(), &translen);
 	if (transbuf)
@@ -44,6 +255,7 @@ TransDict::VSetVar( const StrPtr &var, const StrPtr &val )
 	    other->SetVar(var.Text(), StrRef(transbuf, translen));
 	    // careful about the order here...
 	    StrBufDict::VSetVar(var, val);
+	    Remember();
 	}
 	else
 	{
@@ -56,9 +268,21 @@ TransDict::VSetVar( const StrPtr &var, const StrPtr &val )
 StrPtr *
 TransDict::VGetVar( const StrPtr &var )
 {
-	fromOther->ResetErr();
-	StrPtr *ret = StrBufDict::VGetVar( var );
-	if (!ret)
+	int x = Find( var );
+
+	if( x >= 0 )
+	{
+	    transerr = 0;
+	    return GetValX( x );
+	}
+
+	StrPtr *ret;
+
+	if( toAscii && TransAscii( var.Text(), var.Length() ) )
+	{
+	    ret = other->GetVar( var );
+	}
+	else
 	{
 	    toOther->ResetErr();
 	    const char *cp = toOther->FastCvt( var.Text(), var.Length() );
@@ -71,27 +295,28 @@ TransDict::VGetVar( const StrPtr &var )
 	    }
 
 	    ret = other->GetVar( cp );
+	}
+
+	fromOther->ResetErr();
 
-	    if (ret)
+	if( ret && !( fromAscii && TransAscii( ret->Text(), ret->Length() ) ) )
+	{
+	    int translen;
+	    const char *transbuf = fromOther->FastCvt( ret->Text(),
+						       ret->Length(),
+						       &translen );
+	    // XXX if the translation failed we should probably
+	    // have an error indication of translation failure
+	    if( transbuf )
 	    {
-		int translen;
-		const char *transbuf = fromOther->FastCvt( ret->Text(),
-							   ret->Length(),
-							   &translen );
-		// XXX if the translation failed we should probably
-		// have an error indication of translation failure
-		if( transbuf )
-		{
-		    // XXX Set the translated value
-		    StrBufDict::VSetVar( var,
-					StrRef( transbuf, translen ) );
-		    ret = StrBufDict::VGetVar( var );
-		}
-		else
-		{
-		    notransbuf = *ret;
-		    ret = NULL;
-		}
+		// XXX Set the translated value
+		StrBufDict::VSetVar( var, StrRef( transbuf, translen ) );
+		ret = Remember();
+	    }
+	    else
+	    {
+		notransbuf = *ret;
+		ret = NULL;
 	    }
 	}
 	transerr = fromOther->LastErr();
@@ -106,15 +331,24 @@ TransDict::VGetVarX( int x, StrRef &var, StrRef &val )
 	ret = other->GetVar( x, var, val );
 	if( ret )
 	{
+	    int asciiVar = fromAscii && TransAscii( var.Text(), var.Length() );
+
+	    // Both 7-bit: hand back other's, as is
+
+	    if( asciiVar && TransAscii( val.Text(), val.Length() ) )
+		return ret;
+
 	    int translen;
 	    fromOther->ResetErr();
-	    const char *cp = fromOther->FastCvt( var.Text(),
-					       var.Length(),
-					       &translen );
+	    const char *cp = asciiVar ? 0 : fromOther->FastCvt( var.Text(),
+							       var.Length(),
+							       &translen );
 
 	    StrBuf holdvar;
 
-	    if( cp )
+	    if( asciiVar )
+		holdvar = var;
+	    else if( cp )
 		holdvar = StrRef( cp, translen );
 	    else {
 		notransbuf = var;
@@ -139,6 +373,8 @@ TransDict::VGetVarX( int x, StrRef &var, StrRef &val )
 		transerr = fromOther->LastErr();
 	    }
 
+	    Remember();
+
 	    // XXX this is needed to get var and val pointing at
 	    // stable memory
 	    ret = StrBufDict::VGetVarX( GetCount() - 1, var, val );
@@ -167,6 +403,8 @@ TransDictQues::VGetVar( const StrPtr &var )
 	StrPtr *val = other->GetVar( var );
 	if ( !val )
 	    return NULL;
+	if ( ascii && TransAscii( val->Text(), val->Length() ) )
+	    return val;
 	fromOther->ResetErr();
 	int translen;
 	const char *transbuf = fromOther->FastCvtQues( val->Text(),
@@ -7,9 +7,10 @@
 class TransDictQues : public StrBufDict {
 	StrDict *other;
 	CharSetCvt *fromOther;
+	int ascii;
 public:
-	TransDictQues( StrDict *o, CharSetCvt *f )
-	    : other(o), fromOther(f) {}
+	TransDictQues( StrDict *o, CharSetCvt *f, int a = 0 )
+	    : other(o), fromOther(f), ascii(a) {}
 	~TransDictQues();
 private:
 	StrPtr *VGetVar( const StrPtr &var );
@@ -22,16 +23,32 @@ public:
 	TransDict(StrDict *o, CharSetCvt *f);
 	~TransDict();
 	TransDictQues *CreateErrorOutputDict()
-	    { return new TransDictQues( other, fromOther ); }
+	    { return new TransDictQues( other, fromOther, fromAscii ); }
+	TransDictQues *ErrorOutputDict();
 	CharSetCvt *FromCvt() { return fromOther; }
 	CharSetCvt *ToCvt() { return toOther; }
 
 private:
 	StrPtr *VGetVar( const StrPtr &var );
 	void	VSetVar( const StrPtr &var, const StrPtr &val );
+	void	VRemoveVar( const StrPtr &var );
 	int	VGetVarX( int, StrRef &, StrRef & );
 	void	VSetError( const StrPtr &, Error * );
+	void	VClear();
+
+	int	Find( const StrPtr &var );
+	StrPtr	*Remember();
+	void	Insert( int x );
+	void	Reindex();
 
 	int transerr;
 	StrBuf notransbuf;
+
+	int fromAscii;		// converters pass 7-bit text unchanged
+	int toAscii;
+
+	int *index;		// hash of names to entries, +1
+	int indexSize;
+
+	TransDictQues *quesDict;	// for ErrorOutputDict()
 };
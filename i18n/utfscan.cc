@@ -0,0 +1,158 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * utfscan.cc - block scans for the unicode converters and validator
+ */
+
+# include <stdhdrs.h>
+
+# include "utfscan.h"
+
+# if defined( __SSE2__ ) || defined( _M_X64 ) || \
+	( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+# define UTFSCAN_SSE2
+# include <emmintrin.h>
+# endif
+
+int
+UtfScan::AsciiSpan( const char *s, int n )
+{
+	const char *p = s;
+	const char *e = s + n;
+
+# ifdef UTFSCAN_SSE2
+	while( e - p >= 16 )
+	{
+	    __m128i x = _mm_loadu_si128( (const __m128i *)p );
+	    if( _mm_movemask_epi8( x ) )
+		break;
+	    p += 16;
+	}
+# else
+	const P4INT64 high = (P4INT64)0x80808080 << 32 | 0x80808080;
+
+	while( e - p >= 8 )
+	{
+	    P4INT64 w;
+	    memcpy( &w, p, sizeof( w ) );
+	    if( w & high )
+		break;
+	    p += 8;
+	}
+# endif
+
+	while( p < e && !( *p & 0x80 ) )
+	    ++p;
+
+	return p - s;
+}
+
+int
+UtfScan::AsciiToUtf16( const char *s, int n, char *t, int le )
+{
+	const char *p = s;
+	const char *e = s + n;
+
+# ifdef UTFSCAN_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	while( e - p >= 16 )
+	{
+	    __m128i x = _mm_loadu_si128( (const __m128i *)p );
+	    if( _mm_movemask_epi8( x ) )
+		break;
+
+	    __m128i lo = le ? _mm_unpacklo_epi8( x, zero )
+			    : _mm_unpacklo_epi8( zero, x );
+	    __m128i hi = le ? _mm_unpackhi_epi8( x, zero )
+			    : _mm_unpackhi_epi8( zero, x );
+
+	    _mm_storeu_si128( (__m128i *)t, lo );
+	    _mm_storeu_si128( (__m128i *)( t + 16 ), hi );
+
+	    p += 16;
+	    t += 32;
+	}
+# endif
+
+	for( ; p < e && !( *p & 0x80 ); ++p, t += 2 )
+	{
+	    t[ !le ] = *p;
+	    t[ le ] = 0;
+	}
+
+	return p - s;
+}
+
+int
+UtfScan::Utf16ToAscii( const char *s, int n, char *t, int le )
+{
+	const char *p = s;
+	const char *e = s + 2 * n;
+
+# ifdef UTFSCAN_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i high = _mm_set1_epi16( (short)0xff80 );
+
+	while( e - p >= 16 )
+	{
+	    __m128i x = _mm_loadu_si128( (const __m128i *)p );
+
+	    if( !le )
+		x = _mm_or_si128( _mm_slli_epi16( x, 8 ),
+				  _mm_srli_epi16( x, 8 ) );
+
+	    __m128i ok = _mm_cmpeq_epi16( _mm_and_si128( x, high ), zero );
+	    if( _mm_movemask_epi8( ok ) != 0xffff )
+		break;
+
+	    _mm_storel_epi64( (__m128i *)t, _mm_packus_epi16( x, x ) );
+
+	    p += 16;
+	    t += 8;
+	}
+# endif
+
+	for( ; p < e && !p[ le ] && !( p[ !le ] & 0x80 ); p += 2 )
+	    *t++ = p[ !le ];
+
+	return ( p - s ) / 2;
+}
+
+int
+UtfScan::AsciiLower( const char *s, int n, char *t )
+{
+	const char *p = s;
+	const char *e = s + n;
+
+# ifdef UTFSCAN_SSE2
+	const __m128i a1 = _mm_set1_epi8( 'A' - 1 );
+	const __m128i z1 = _mm_set1_epi8( 'Z' + 1 );
+	const __m128i bit = _mm_set1_epi8( 0x20 );
+
+	while( e - p >= 16 )
+	{
+	    __m128i x = _mm_loadu_si128( (const __m128i *)p );
+	    if( _mm_movemask_epi8( x ) )
+		break;
+
+	    __m128i upper = _mm_and_si128( _mm_cmpgt_epi8( x, a1 ),
+					   _mm_cmpgt_epi8( z1, x ) );
+	    x = _mm_or_si128( x, _mm_and_si128( upper, bit ) );
+
+	    _mm_storeu_si128( (__m128i *)t, x );
+
+	    p += 16;
+	    t += 16;
+	}
+# endif
+
+	for( ; p < e && !( *p & 0x80 ); ++p )
+	    *t++ = *p >= 'A' && *p <= 'Z' ? *p + 'a' - 'A' : *p;
+
+	return p - s;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * utfscan.h - block scans for the unicode converters and validator
+ *
+ * Text in any of the unicode encodings is mostly ASCII, which each
+ * of these scans moves a block at a time: 16 bytes with SSE2 (always
+ * there on x86_64, and when the compiler targets it on x86), 8 with
+ * plain words elsewhere.  Each stops at the first unit that isn't
+ * 7-bit, leaving it for the converter's own loop, so error positions
+ * and LastErr() are what they were.
+ *
+ * Public methods:
+ *
+ *	UtfScan::AsciiSpan() - count of leading 7-bit bytes
+ *	UtfScan::AsciiToUtf16() - widen leading 7-bit bytes to UTF-16
+ *	UtfScan::Utf16ToAscii() - narrow leading UTF-16 units below 0x80
+ *	UtfScan::AsciiLower() - copy leading 7-bit bytes, lowercased
+ *
+ *	'n' is the most units to take (bytes for UTF-8, pairs of bytes
+ *	for UTF-16); 'le' selects little-endian UTF-16.  Each returns
+ *	the count of units taken.
+ */
+
+class UtfScan {
+
+    public:
+
+	static int	AsciiSpan( const char *s, int n );
+
+	static int	AsciiToUtf16( const char *s, int n, char *t, int le );
+	static int	Utf16ToAscii( const char *s, int n, char *t, int le );
+
+	static int	AsciiLower( const char *s, int n, char *t );
+
+} ;
@@ -5,6 +5,7 @@
  */
 
 #include "validate.h"
+#include "utfscan.h"
 
 /*
  * ValidateCharSet
@@ -95,6 +96,18 @@ CharSetUTF8Valid::Valid( const char *buf, int len, const char **retp )
 {
 	while( len-- > 0 )
 	{
+	    // Skip runs of ASCII a block at a time.
+
+	    if( !followcnt && !( *buf & 0x80 ) )
+	    {
+		int n = UtfScan::AsciiSpan( buf, len + 1 );
+		buf += n;
+		len -= n - 1;
+		if( retp )
+		    *retp = buf - 1;
+		continue;
+	    }
+
 	    int chflags = validmap[0xff & *buf];
 
 	    if( followcnt )
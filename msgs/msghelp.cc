@@ -876,6 +876,7 @@ ErrorId MsgHelp::HelpEnvironment = { ErrorOf( ES_HELP, 16, E_INFO, EV_NONE, 0  )
 "    P4LOGINSSO       Client side credentials script  p4 help triggers\n"
 "    P4MERGE          Merge program to use on client  p4 help resolve\n"
 "    P4MERGEUNICODE   Merge program to use on client  p4 help resolve\n"
+"    P4MUX            Socket of a local 'p4 mux'      Perforce Command Reference\n"
 "    P4PAGER          Pager for 'p4 resolve' output   p4 help resolve\n"
 "    P4PASSWD         User password passed to server  p4 help passwd\n"
 "    P4PORT           Port to which client connects   p4 help info\n"
@@ -8540,6 +8541,8 @@ ErrorId MsgHelp::HelpConfigurables = { ErrorOf( ES_HELP, 130, E_INFO, EV_NONE, 0
 "	monitor                  0 Server monitoring level\n"
 "	monitor.lsof          none Set to /usr/bin/lsof to enable on Linux\n"
 "	net.backlog             10 Maximum pending connections queue length\n"
+"	net.connect.delay      250 Ms before also trying the other IP family\n"
+"	net.dns.ttl             30 Seconds to reuse a server's address lookup\n"
 "	net.keepalive.disable    0 Disable sending TCP keepalive packets\n"
 "	net.keepalive.idle       0 Seconds before starting to send keepalives\n"
 "	net.keepalive.interval   0 Seconds between sending keepalives\n"
@@ -8637,7 +8640,13 @@ ErrorId MsgHelp::HelpConfigurables = { ErrorOf( ES_HELP, 130, E_INFO, EV_NONE, 0
 "	----               ------- ---\n"
 "	filesys.binaryscan     64K 'add' looks this far for binary chars\n"
 "	filesys.bufsize         4K Client file I/O buffer size\n"
+"	filesys.resolvemem      1M Resolve files this small in memory\n"
+"	filesys.resolve.threads  2 Threads finishing 'resolve -a' merges\n"
+"	filesys.resolve.maxfiles 64 Max merges queued for those threads\n"
+"	filesys.resolve.maxmem 10M Max merge data queued for those threads\n"
 "	lbr.verify.out           1 Verify contents from the server to client\n"
+"	net.connect.delay      250 Ms before also trying the other IP family\n"
+"	net.dns.ttl             30 Seconds to reuse a server's address lookup\n"
 "	net.keepalive.disable    0 Disable sending TCP keepalive packets\n"
 "	net.keepalive.idle       0 Seconds before starting to send keepalives\n"
 "	net.keepalive.interval   0 Seconds between sending keepalives\n"
@@ -8645,8 +8654,10 @@ ErrorId MsgHelp::HelpConfigurables = { ErrorOf( ES_HELP, 130, E_INFO, EV_NONE, 0
 "	net.maxwait              0 Seconds to wait for a network read or write\n"
 "	net.rfc3484              0 Allow OS to choose between IPv4 and IPv6\n"
 "	net.tcpsize           512K TCP sndbuf/rcvbuf sizes set at connect\n"
+"	ssl.client.sessions     16 SSL servers to keep sessions for resuming\n"
 "	sys.rename.max          10 Limit for retrying a failed file rename\n"
 "	sys.rename.wait       1000 Timeout in ms between file rename attempts\n"
+"	sys.sort.threads         0 Threads sorting 64K+ names (0: just one)\n"
 "\n"
 };
 
@@ -81,6 +81,8 @@ const char P4Tag::v_attr[] = "attr";
 const char P4Tag::v_authServer[] = "authServer";
 const char P4Tag::v_autoLogin[] = "autoLogin";
 const char P4Tag::v_baseName[] = "baseName";
+const char P4Tag::v_batch[] = "batch";
+const char P4Tag::v_batchEnd[] = "batchEnd";
 const char P4Tag::v_bits[] = "bits";
 const char P4Tag::v_blockCount[] = "blockCount";
 const char P4Tag::v_broker[] = "broker";
@@ -245,6 +247,7 @@ const char P4Tag::v_rUserPrompt[] = "rUserPrompt";
 const char P4Tag::v_rUserResult[] = "rUserResult";
 const char P4Tag::v_rcvbuf[] = "rcvbuf";
 const char P4Tag::v_reason[] = "reason";
+const char P4Tag::v_recbatch[] = "recbatch";
 const char P4Tag::v_remap[] = "remap";
 const char P4Tag::v_remoteFunc[] = "remoteFunc";
 const char P4Tag::v_remoteMap[] = "remoteMap";
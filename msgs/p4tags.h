@@ -97,6 +97,8 @@ struct P4Tag {
 	static const char v_authServer[];
 	static const char v_autoLogin[];
 	static const char v_baseName[];
+	static const char v_batch[];
+	static const char v_batchEnd[];
 	static const char v_bits[];
 	static const char v_blockCount[];
 	static const char v_broker[];
@@ -261,6 +263,7 @@ struct P4Tag {
 	static const char v_rUserResult[];
 	static const char v_rcvbuf[];
 	static const char v_reason[];
+	static const char v_recbatch[];
 	static const char v_remap[];
 	static const char v_remoteFunc[];
 	static const char v_remoteMap[];
@@ -9,6 +9,9 @@
  * This file is part of Perforce - the FAST SCM System.
  */
 
+# define NEED_THREADS
+# define NEED_TIME
+
 # include <stdhdrs.h>
 # include <strbuf.h>
 # include <error.h>
@@ -16,6 +19,87 @@
 # include "netaddrinfo.h"
 # include "netutils.h"
 
+/*
+ * The lookup cache
+ *
+ * getaddrinfo() doesn't tell us the DNS TTL, so an entry lasts for the
+ * 'ttl' seconds the caller gives CachePut() (net.dns.ttl, for connects).
+ * A handful of entries is plenty: a client talks to a server or two, a
+ * proxy or replica to its upstream.  Entries hold our own copy of the
+ * addrinfo list, and CacheGet() hands out another copy, so that each
+ * NetAddrInfo frees its own list without taking the lock.
+ *
+ * Without pthreads (e.g. NT) nothing is cached.
+ */
+
+# ifdef HAVE_PTHREAD
+
+const int NetAddrCacheSize = 16;
+
+struct NetAddrCacheEntry {
+	StrBuf		host;
+	StrBuf		port;
+	int		family;
+	int		socktype;
+	int		key;
+	time_t		expires;
+	addrinfo	*list;
+} ;
+
+static NetAddrCacheEntry cache[ NetAddrCacheSize ];
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+# endif
+
+static addrinfo *
+CopyList( const addrinfo *ai )
+{
+	addrinfo *head = NULL;
+	addrinfo **tail = &head;
+
+	for( ; ai; ai = ai->ai_next )
+	{
+	    addrinfo *c = new addrinfo;
+
+	    *c = *ai;
+	    c->ai_next = NULL;
+	    c->ai_addr = NULL;
+	    c->ai_canonname = NULL;
+
+	    if( ai->ai_addr )
+	    {
+		char *a = new char[ ai->ai_addrlen ];
+		::memcpy( a, ai->ai_addr, ai->ai_addrlen );
+		c->ai_addr = (sockaddr *)a;
+	    }
+
+	    if( ai->ai_canonname )
+	    {
+		int l = ::strlen( ai->ai_canonname ) + 1;
+		c->ai_canonname = new char[ l ];
+		::memcpy( c->ai_canonname, ai->ai_canonname, l );
+	    }
+
+	    *tail = c;
+	    tail = &c->ai_next;
+	}
+
+	return head;
+}
+
+static void
+FreeList( addrinfo *ai )
+{
+	while( ai )
+	{
+	    addrinfo *n = ai->ai_next;
+	    delete [] (char *)ai->ai_addr;
+	    delete [] ai->ai_canonname;
+	    delete ai;
+	    ai = n;
+	}
+}
+
 // ctor
 NetAddrInfo::NetAddrInfo(
 	const StrPtr &hostname,
@@ -23,7 +107,8 @@ NetAddrInfo::NetAddrInfo(
 : m_serverinfo(NULL),
   m_hostname(hostname),
   m_portname(portname),
-  m_status(0)
+  m_status(0),
+  m_cached(false)
 {
 	::memset(&m_hints, 0, sizeof m_hints);
 	m_hints.ai_family = AF_UNSPEC; // AF_INET or AF_INET6 to force version
@@ -33,8 +118,23 @@ NetAddrInfo::NetAddrInfo(
 // dtor
 NetAddrInfo::~NetAddrInfo()
 {
-	if( m_serverinfo )
-	    ::freeaddrinfo(m_serverinfo); // free the linked list
+	FreeInfo();
+}
+
+// free the linked list
+void
+NetAddrInfo::FreeInfo()
+{
+	if( !m_serverinfo )
+	    return;
+
+	if( m_cached )
+	    FreeList( m_serverinfo );
+	else
+	    ::freeaddrinfo( m_serverinfo );
+
+	m_serverinfo = NULL;
+	m_cached = false;
 }
 
 // get family
@@ -94,11 +194,7 @@ NetAddrInfo::GetInfo(Error *e)
 
 
 	// calling GetInfo again? free memory allocated by the previous call
-	if( m_serverinfo )
-	{
-	    ::freeaddrinfo( m_serverinfo );
-	    m_serverinfo = NULL;
-	}
+	FreeInfo();
 
 	if( (m_status = ::getaddrinfo(hname, pname, &m_hints, &m_serverinfo)) != 0 )
 	{
@@ -111,3 +207,118 @@ NetAddrInfo::GetInfo(Error *e)
 	return true;
 }
 
+
+// use a cached lookup of the same host, port, hints and key, if unexpired
+bool
+NetAddrInfo::CacheGet(int key)
+{
+# ifdef HAVE_PTHREAD
+	time_t now = time( 0 );
+	addrinfo *list = NULL;
+
+	pthread_mutex_lock( &cacheLock );
+
+	for( int i = 0; i < NetAddrCacheSize; i++ )
+	{
+	    NetAddrCacheEntry &c = cache[i];
+
+	    if( c.list && c.expires > now &&
+		c.family == m_hints.ai_family &&
+		c.socktype == m_hints.ai_socktype &&
+		c.key == key &&
+		c.host == m_hostname && c.port == m_portname )
+	    {
+		list = CopyList( c.list );
+		break;
+	    }
+	}
+
+	pthread_mutex_unlock( &cacheLock );
+
+	if( !list )
+	    return false;
+
+	FreeInfo();
+	m_serverinfo = list;
+	m_cached = true;
+	m_status = 0;
+
+	return true;
+# else
+	return false;
+# endif
+}
+
+// remember a successful lookup for 'ttl' seconds, under 'key'
+void
+NetAddrInfo::CachePut(int key, int ttl)
+{
+# ifdef HAVE_PTHREAD
+	if( ttl <= 0 || !m_serverinfo )
+	    return;
+
+	time_t now = time( 0 );
+	addrinfo *list = CopyList( m_serverinfo );
+	addrinfo *old;
+	int i, slot = 0;
+
+	pthread_mutex_lock( &cacheLock );
+
+	// The same lookup, or else an empty or expired entry, or
+	// else the one expiring soonest.
+
+	for( i = 0; i < NetAddrCacheSize; i++ )
+	{
+	    NetAddrCacheEntry &c = cache[i];
+
+	    if( c.list &&
+		c.family == m_hints.ai_family &&
+		c.socktype == m_hints.ai_socktype &&
+		c.key == key &&
+		c.host == m_hostname && c.port == m_portname )
+	    {
+		slot = i;
+		break;
+	    }
+
+	    if( !c.list || c.expires <= now )
+		slot = i;
+	    else if( cache[ slot ].list &&
+		     cache[ slot ].expires > now &&
+		     c.expires < cache[ slot ].expires )
+		slot = i;
+	}
+
+	NetAddrCacheEntry &c = cache[ slot ];
+
+	old = c.list;
+	c.host.Set( m_hostname );
+	c.port.Set( m_portname );
+	c.family = m_hints.ai_family;
+	c.socktype = m_hints.ai_socktype;
+	c.key = key;
+	c.expires = now + ttl;
+	c.list = list;
+
+	pthread_mutex_unlock( &cacheLock );
+
+	FreeList( old );
+# endif
+}
+
+// forget all cached lookups
+void
+NetAddrInfo::CacheClear()
+{
+# ifdef HAVE_PTHREAD
+	pthread_mutex_lock( &cacheLock );
+
+	for( int i = 0; i < NetAddrCacheSize; i++ )
+	{
+	    FreeList( cache[i].list );
+	    cache[i].list = NULL;
+	}
+
+	pthread_mutex_unlock( &cacheLock );
+# endif
+}
@@ -12,6 +12,10 @@
  *
  *	NetAddrInfo - Transform a network address string into a format suitable
  *	           for accept/connect
+ *
+ * CacheGet() and CachePut() keep resolved addresses for reuse by later
+ * lookups of the same host, port and hints, for 'ttl' seconds: see
+ * netaddrinfo.cc.
  */
 
 # include "netportipv6.h"
@@ -54,6 +58,16 @@ public:
 	bool
 	GetInfo(Error *e);
 
+	// use or remember a lookup keyed on host, port, hints and 'key'
+	bool
+	CacheGet(int key);
+
+	void
+	CachePut(int key, int ttl);
+
+	static void
+	CacheClear();
+
 	int
 	GetStatus()
 	{
@@ -91,4 +105,8 @@ private:
 	const StrPtr	m_hostname;
 	const StrPtr	m_portname;
 	int		m_status;
+	bool		m_cached;	// m_serverinfo is a copy from the cache
+
+	void
+	FreeInfo();
 };
@@ -32,6 +32,11 @@ NetBuffer::NetBuffer( NetTransport *t )
 	int size = p4tunable.Get( P4TUNE_NET_BUFSIZE );
 	int rcvsize = p4tunable.Get( P4TUNE_NET_RCVBUFSIZE );
 
+	// Gather whole records for transports that send them (SSL).
+
+	if( t->GetSendRecordSize() > size )
+	    size = t->GetSendRecordSize();
+
 	recvBuf.Alloc( rcvsize );
 	sendBuf.Alloc( size );
 
@@ -40,6 +40,7 @@
  *	NetTransport::GetAddress() - return connection's local address
  *	NetTransport::GetPeerAddress() - return address of the peer
  *	NetTransport::GetBuffering() - return transport level send buffering
+ *	NetTransport::GetSendRecordSize() - the most sent as one record, or 0
  */
 
 # ifndef __NETCONNECT_H__
@@ -140,6 +141,7 @@ class NetTransport : public KeepAlive {
 	virtual void	SetBreak( KeepAlive *breakCallback ) = 0;
 	virtual int	GetSendBuffering() = 0;
 	virtual int	GetRecvBuffering() = 0;
+	virtual int	GetSendRecordSize() { return 0; }
 	virtual void    GetEncryptionType(StrBuf &value)
 	                {
 			    value.Clear();
@@ -64,6 +64,8 @@
 # include "datetime.h"
 # include "filesys.h"
 # include "pathsys.h"
+# include <hostenv.h>
+# include <strops.h>
 
 # include <keepalive.h>
 # include "netsupport.h"
@@ -315,6 +317,65 @@ fail:
 	return;
 }
 
+/**
+ * NetSslTransport::GetSendRecordSize
+ *
+ * @brief a TLS record carries up to 16K: NetBuffer gathers that much
+ * before sending, so small writes don't each become a record (with its
+ * own header, MAC and padding) and a system call.
+ */
+int
+NetSslTransport::GetSendRecordSize()
+{
+	return SSL3_RT_MAX_PLAIN_LENGTH;
+}
+
+/**
+ * NetSslTransport::IsAlive
+ *
+ * @brief as NetTcpTransport::IsAlive, but through SSL: a peer closing
+ * an idle connection sends a close_notify alert first, which a peek at
+ * the socket takes for data.  SSL_peek() reads any such record without
+ * consuming application data.
+ */
+int
+NetSslTransport::IsAlive()
+{
+	if( !ssl )
+	    return NetTcpTransport::IsAlive();
+
+	if( SSL_get_shutdown( ssl ) & SSL_RECEIVED_SHUTDOWN )
+	    return 0;
+
+	int readable = 1;
+	int writeable = 0;
+
+	if( selector->Select( readable, writeable, 0 ) < 0 )
+	    return 0;
+
+	if( !readable && !SSL_pending( ssl ) )
+	    return 1;
+
+	char c;
+	int l = SSL_peek( ssl, &c, 1 );
+	SSLLOGFUNCTION( "NetSslTransport::IsAlive SSL_peek" );
+
+	if( l > 0 )
+	    return 1;
+
+	switch( SSL_get_error( ssl, l ) )
+	{
+	case SSL_ERROR_WANT_READ:
+	case SSL_ERROR_WANT_WRITE:
+	    // Just handshake records (a session ticket, say).
+	    ERR_clear_error();
+	    return 1;
+	default:
+	    ERR_clear_error();
+	    return 0;
+	}
+}
+
 void
 NetSslTransport::GetPeerFingerprint(StrBuf &value)
 {
@@ -535,6 +596,9 @@ NetSslTransport::DoHandshake( Error *e )
 	SSL_set_bio( ssl, bio, bio );
 	SSLLOGFUNCTION( "NetSslTransport::DoHandshake SSL_set_bio" );
 
+	if( !isAccepted )
+	    ResumeSession();
+
 	if( !SslHandshake(e) )
 	    goto fail;
 
@@ -575,6 +639,14 @@ NetSslTransport::DoHandshake( Error *e )
 	    }
 	    X509_free( serverCert );
 	    SSLLOGFUNCTION( "X509_free" );
+
+	    if( SSL_session_reused( ssl ) )
+	    {
+		TRANSPORT_PRINT( SSLDEBUG_CONNECT,
+			"NetSslTransport::DoHandshake resumed session" );
+	    }
+	    else
+		SaveSession();
 	}
 
 	return;
@@ -767,6 +839,182 @@ NetSslTransport::SslHandshake( Error *e )
 }
 
 
+/**
+ * NetSslTransport::GetSessionFile
+ *
+ * @brief where the client keeps sessions for resuming: beside the
+ * trust file, as P4TRUST with ".sessions" appended.  Each line is a
+ * port and the hex of its last session, most recent first.
+ *
+ * @param path, set empty if there is no trust file
+ */
+void
+NetSslTransport::GetSessionFile( StrBuf &path )
+{
+	HostEnv h;
+	Enviro  enviro;
+	char    *trust;
+
+	if( ( trust = enviro.Get( "P4TRUST" ) ) )
+	    path.Set( trust );
+	else if( !h.GetTrustFile( path, &enviro ) )
+	    path.Clear();
+
+	if( path.Length() )
+	    path.Append( ".sessions" );
+}
+
+/**
+ * NetSslTransport::ResumeSession
+ *
+ * @brief offer the server the last session we had with it, if it
+ * hasn't expired.  A server that has forgotten it (or can't decrypt
+ * its ticket) simply does a full handshake.  Nothing here fails the
+ * connection.
+ */
+void
+NetSslTransport::ResumeSession()
+{
+	if( !p4tunable.Get( P4TUNE_SSL_CLIENT_SESSIONS ) )
+	    return;
+
+	StrBuf path;
+	GetSessionFile( path );
+
+	if( !path.Length() )
+	    return;
+
+	const StrPtr &port = GetPortParser().String();
+	FileSys *f = FileSys::Create( FST_TEXT );
+	StrBuf line, der;
+	Error e;
+
+	f->Set( path );
+	f->Open( FOM_READ, &e );
+
+	while( !e.Test() && f->ReadLine( &line, &e ) )
+	{
+	    char *sp = strchr( line.Text(), ' ' );
+
+	    if( !sp || sp - line.Text() != port.Length() ||
+		strncmp( line.Text(), port.Text(), port.Length() ) )
+		continue;
+
+	    StrOps::XtoO( StrRef( sp + 1, line.End() - sp - 1 ), der );
+
+	    const unsigned char *p = (const unsigned char *)der.Text();
+	    SSL_SESSION *session = d2i_SSL_SESSION( NULL, &p, der.Length() );
+
+	    if( session &&
+		SSL_SESSION_get_time( session ) +
+		SSL_SESSION_get_timeout( session ) > time( 0 ) )
+	    {
+		SSL_set_session( ssl, session );
+		SSLLOGFUNCTION( "NetSslTransport::ResumeSession SSL_set_session" );
+	    }
+
+	    if( session )
+		SSL_SESSION_free( session );
+	    break;
+	}
+
+	f->Close( &e );
+	delete f;
+
+	// A bad entry is just not resumed.
+
+	ERR_clear_error();
+}
+
+/**
+ * NetSslTransport::SaveSession
+ *
+ * @brief after a full handshake, put the new session at the head of
+ * the session file, keeping ssl.client.sessions servers.  The file
+ * holds session keys, so it is written owner-only, through a temp file
+ * renamed into place so concurrent clients don't see it half written.
+ */
+void
+NetSslTransport::SaveSession()
+{
+	int max = p4tunable.Get( P4TUNE_SSL_CLIENT_SESSIONS );
+	SSL_SESSION *session = SSL_get_session( ssl );
+
+	if( !max || !session )
+	    return;
+
+	StrBuf path;
+	GetSessionFile( path );
+
+	if( !path.Length() )
+	    return;
+
+	int len = i2d_SSL_SESSION( session, NULL );
+
+	if( len <= 0 )
+	    return;
+
+	const StrPtr &port = GetPortParser().String();
+	StrBuf der, out, line;
+	unsigned char *p = (unsigned char *)der.Alloc( len );
+
+	i2d_SSL_SESSION( session, &p );
+
+	out << port << " ";
+	StrOps::OtoX( der, out );
+	out << "\n";
+
+	// Keep other servers' sessions, up to max in all.
+
+	FileSys *f = FileSys::Create( FST_TEXT );
+	Error e;
+	int n = 1;
+
+	f->Set( path );
+	f->Open( FOM_READ, &e );
+
+	while( !e.Test() && n < max && f->ReadLine( &line, &e ) )
+	{
+	    if( !strncmp( line.Text(), port.Text(), port.Length() ) &&
+		line[ port.Length() ] == ' ' )
+		continue;
+
+	    out << line << "\n";
+	    ++n;
+	}
+
+	f->Close( &e );
+	e.Clear();
+
+	FileSys *tmp = FileSys::CreateTemp( FST_TEXT );
+	tmp->MakeLocalTemp( path.Text() );
+	tmp->Perms( FPM_RWO );
+	tmp->Open( FOM_WRITE, &e );
+
+	// Owner-only before anything is in it
+
+	if( !e.Test() )
+	    tmp->Chmod( FPM_RWO, &e );
+
+	if( !e.Test() )
+	    tmp->Write( &out, &e );
+
+	tmp->ClearDeleteOnClose();
+	tmp->Close( &e );
+
+	if( !e.Test() )
+	    tmp->Rename( f, &e );
+	else
+	    tmp->Unlink( 0 );
+
+	if( e.Test() )
+	    TRANSPORT_PRINTF( SSLDEBUG_ERROR,
+		"NetSslTransport::SaveSession failed to write %s", path.Text() );
+
+	delete tmp;
+	delete f;
+}
+
 /*
  * NetSslTransport::SendOrReceive() - send or receive data as ready
  *
@@ -1097,22 +1345,40 @@ NetSslTransport::SendOrReceive( NetIoPtrs &io, Error *se, Error *re )
 		write_waiton_read = false;
 		write_waiton_write = false;
 
-		/* perform the write from the start of the buffer */
-		int l = SSL_write( ssl, io.sendPtr, io.sendEnd - io.sendPtr );
-		SSLLOGFUNCTION( "NetSslTransport::SendOrReceive SSL_write" );
+		/*
+		 * perform the write from the start of the buffer, and
+		 * keep going while the socket takes whole records, rather
+		 * than a select() per record.  The switch below sees how
+		 * the last write went.
+		 */
+		int l;
+		int sent = 0;
+
+		for( ;; )
+		{
+		    l = SSL_write( ssl, io.sendPtr, io.sendEnd - io.sendPtr );
+		    SSLLOGFUNCTION( "NetSslTransport::SendOrReceive SSL_write" );
+
+		    if( l <= 0 )
+			break;
+
+		    TRANSPORT_PRINTF( SSLDEBUG_TRANS,
+			    "NetSslTransport send %d bytes\n", l );
+		    lastRead = 0;
+		    io.sendPtr += l;
+		    sent = 1;
+
+		    if( io.sendPtr >= io.sendEnd )
+			break;
+		}
 
 		switch ( sslError = SSL_get_error( ssl, l ) )
 		{
 		case SSL_ERROR_NONE:
 		    /*
-		     * no errors occurred.  update the new buffer size and signal
-		     * that "have data" by returning 1.
+		     * no errors occurred.  signal that "have data" by
+		     * returning 1.
 		     */
-		    if( l > 0 )
-			TRANSPORT_PRINTF( SSLDEBUG_TRANS,
-				"NetSslTransport send %d bytes\n", l );
-		    lastRead = 0;
-		    io.sendPtr += l;
 		    return 1;
 
 		    break;
@@ -1124,8 +1390,10 @@ NetSslTransport::SendOrReceive( NetIoPtrs &io, Error *se, Error *re )
 		case SSL_ERROR_WANT_READ:
 		    /*
 		     * we need to retry the write after A is available for
-		     * reading
+		     * reading; if we sent some first, the next call will.
 		     */
+		    if( sent )
+			return 1;
 		    TRANSPORT_PRINT( SSLDEBUG_ERROR,
 			    "SSL_write returned SSL_ERROR_WANT_READ" );
 		    write_waiton_read = true;
@@ -1133,8 +1401,10 @@ NetSslTransport::SendOrReceive( NetIoPtrs &io, Error *se, Error *re )
 		case SSL_ERROR_WANT_WRITE:
 		    /*
 		     * we need to retry the write after A is available for
-		     * writing
+		     * writing; if we sent some first, the next call will.
 		     */
+		    if( sent )
+			return 1;
 		    TRANSPORT_PRINT( SSLDEBUG_ERROR,
 			    "SSL_write returned SSL_ERROR_WANT_WRITE" );
 		    write_waiton_write = true;
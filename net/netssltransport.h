@@ -104,6 +104,8 @@ class NetSslTransport : public NetTcpTransport
 	    }
 	void    
 	GetPeerFingerprint(StrBuf &value);
+	int             GetSendRecordSize();
+	int             IsAlive();
 
     private:
 	void            SslClientInit( Error *e );
@@ -120,6 +122,11 @@ class NetSslTransport : public NetTcpTransport
 	static bool     VerifyKeyFile( const char *path );
 	bool            SslHandshake( Error *e );
 
+	// Client-side session cache, kept next to P4TRUST
+	static void     GetSessionFile( StrBuf &path );
+	void            ResumeSession();
+	void            SaveSession();
+
 	static unsigned long  sCompileVersion;
 	static SSL_CTX *sServerCtx;
 	static SSL_CTX *sClientCtx;
@@ -302,6 +302,279 @@ NetTcpEndPoint::CreateSocket(
 	return fd;
 }
 
+# ifdef USE_SELECTOR
+
+static void
+SetNonBlocking( int fd, int on )
+{
+# ifdef OS_NT
+	u_long u_value = on;
+	ioctlsocket( fd, FIONBIO, &u_value );
+# else
+	int f = fcntl( fd, F_GETFL, 0 );
+	fcntl( fd, F_SETFL, on ? (f | O_NONBLOCK) : (f & ~O_NONBLOCK) );
+# endif
+}
+
+static bool
+ConnectInProgress()
+{
+# ifdef OS_NT
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+# else
+	return errno == EINPROGRESS;
+# endif
+}
+
+/*
+ * ConnectWait() - wait for one of the connecting sockets to finish
+ *
+ * Waits at most 'msecs' milliseconds, or forever if msecs < 0, on the
+ * sockets of fds[0..n) that aren't -1.  Returns the index of one that
+ * has connected or failed (see SO_ERROR), -1 on timeout, or -2 if
+ * select() itself fails.  NT shows a failed connect as an exception
+ * rather than as writable.
+ */
+
+static int
+ConnectWait( const int *fds, int n, int msecs )
+{
+	int i, maxfd = -1;
+
+	for( i = 0; i < n; i++ )
+	    if( fds[i] > maxfd )
+	        maxfd = fds[i];
+
+	if( maxfd < 0 )
+	    return -1;
+
+	for( ;; )
+	{
+	    struct timeval tv;
+	    tv.tv_sec = msecs / 1000;
+	    tv.tv_usec = ( msecs % 1000 ) * 1000;
+
+# ifdef USE_SELECT_BITARRAY
+	    BitArray wfd( maxfd + 1 < FD_SETSIZE ? FD_SETSIZE : maxfd + 1 );
+
+	    for( i = 0; i < n; i++ )
+	        if( fds[i] != -1 )
+	            wfd.tas( fds[i] );
+
+	    int r = select( maxfd + 1, 0, (fd_set *)wfd.fdset(), 0,
+	                    msecs >= 0 ? &tv : 0 );
+# else
+	    fd_set wfd, xfd;
+	    FD_ZERO( &wfd );
+	    FD_ZERO( &xfd );
+
+	    for( i = 0; i < n; i++ )
+	        if( fds[i] != -1 )
+	        {
+	            FD_SET( fds[i], &wfd );
+	            FD_SET( fds[i], &xfd );
+	        }
+
+	    int r = select( maxfd + 1, 0, &wfd, &xfd, msecs >= 0 ? &tv : 0 );
+# endif
+
+	    if( r < 0 && errno == EINTR )
+	        continue;
+
+	    if( r < 0 )
+	        return -2;
+
+	    if( r == 0 )
+	        return -1;
+
+	    for( i = 0; i < n; i++ )
+	    {
+	        if( fds[i] == -1 )
+	            continue;
+# ifdef USE_SELECT_BITARRAY
+	        if( wfd[ fds[i] ] )
+	            return i;
+# else
+	        if( FD_ISSET( fds[i], &wfd ) || FD_ISSET( fds[i], &xfd ) )
+	            return i;
+# endif
+	    }
+
+	    return -1;
+	}
+}
+
+// as CreateSocket() reports a failed connect
+static void
+ConnectFailed( Error *e, const addrinfo *aip, int err )
+{
+	StrBuf addrBuf;
+	NetUtils::GetAddress( aip->ai_family, aip->ai_addr, RAF_PORT, addrBuf );
+	Error::SetNetError( err );
+
+	if( aip->ai_family == AF_INET6 )
+	    e->Net2( "connect (IPv6)", addrBuf.Text() );
+	else
+	    e->Net( "connect", addrBuf.Text() );
+}
+
+/*
+ * NetTcpEndPoint::RaceConnect() - connect to whichever address answers first
+ *
+ * For ports allowing both IPv4 and IPv6 ("tcp46:", "tcp64:" and the ssl
+ * ones, or net.rfc3484) whose host has addresses in both.  Trying one
+ * family and then the other, a family that's black-holed costs the
+ * whole connect timeout first.  Instead, as in RFC 8305 ("Happy
+ * Eyeballs"), the addresses are tried alternating families, starting
+ * with 'af_first', each with a non-blocking connect.  If an attempt
+ * hasn't finished within 'delay' milliseconds (net.connect.delay) the
+ * next is started alongside it; one failing starts the next at once.
+ * The first to connect wins, and the others are closed.
+ *
+ * Returns the connected socket, set back to blocking, or -1 with 'e'
+ * holding the failures, as CreateSocket() would report them.
+ */
+
+int
+NetTcpEndPoint::RaceConnect(
+	const NetAddrInfo &ai,
+	int af_first,
+	int delay,
+	Error *e )
+{
+	const int maxAddrs = 16;
+
+	const addrinfo *first[ maxAddrs ];
+	const addrinfo *other[ maxAddrs ];
+	const addrinfo *addrs[ maxAddrs ];
+	int fds[ maxAddrs ];
+	int nFirst = 0, nOther = 0, n = 0;
+	int i;
+
+	for( const addrinfo *aip = ai.begin(); aip != ai.end(); aip = aip->ai_next )
+	{
+	    if( aip->ai_family == af_first )
+	    {
+	        if( nFirst < maxAddrs )
+	            first[ nFirst++ ] = aip;
+	    }
+	    else if( (aip->ai_family == AF_INET) || (aip->ai_family == AF_INET6) )
+	    {
+	        if( nOther < maxAddrs )
+	            other[ nOther++ ] = aip;
+	    }
+	}
+
+	for( i = 0; (i < nFirst || i < nOther) && n < maxAddrs; i++ )
+	{
+	    if( i < nFirst )
+	        addrs[ n++ ] = first[i];
+	    if( i < nOther && n < maxAddrs )
+	        addrs[ n++ ] = other[i];
+	}
+
+	int started = 0;	// attempts begun
+	int live = 0;		// begun and not yet failed
+	int winner = -1;
+
+	while( winner < 0 && (started < n || live) )
+	{
+	    if( started < n )
+	    {
+	        const addrinfo *aip = addrs[ i = started++ ];
+
+	        if( DEBUG_CONNECT )
+	        {
+	            StrBuf addr;
+	            NetUtils::GetAddress( aip->ai_family, aip->ai_addr, RAF_PORT, addr );
+	            TRANSPORT_PRINTF( DEBUG_CONNECT, "NetTcpEndPoint race connect %s",
+	                addr.Text() );
+	        }
+
+	        fds[i] = ::socket( aip->ai_family, aip->ai_socktype, aip->ai_protocol );
+
+	        if( fds[i] == -1 )
+	        {
+	            e->Net( "socket", "create" );
+	            continue;
+	        }
+
+	        SetupSocket( fds[i], aip->ai_family, AT_CONNECT, e );
+	        SetNonBlocking( fds[i], 1 );
+
+	        if( connect( fds[i], aip->ai_addr, aip->ai_addrlen ) == 0 )
+	        {
+	            winner = i;
+	            break;
+	        }
+
+	        if( !ConnectInProgress() )
+	        {
+	            ConnectFailed( e, aip, Error::GetNetError() );
+	            NET_CLOSE_SOCKET( fds[i] );
+	            fds[i] = -1;
+	            continue;
+	        }
+
+	        ++live;
+	    }
+
+	    // Wait for one to finish; with more to start, only for 'delay'.
+
+	    i = ConnectWait( fds, started, started < n ? delay : -1 );
+
+	    if( i == -1 )
+	        continue;
+
+	    if( i == -2 )
+	    {
+	        e->Net( "select", "connect" );
+	        break;
+	    }
+
+	    int soerr = 0;
+	    TYPE_SOCKLEN len = sizeof( soerr );
+
+	    if( getsockopt( fds[i], SOL_SOCKET, SO_ERROR,
+	                    reinterpret_cast<SOCKOPT_T *>(&soerr), &len ) < 0 )
+	        soerr = Error::GetNetError();
+
+	    if( !soerr )
+	    {
+	        winner = i;
+	        break;
+	    }
+
+	    ConnectFailed( e, addrs[i], soerr );
+	    NET_CLOSE_SOCKET( fds[i] );
+	    fds[i] = -1;
+	    --live;
+	}
+
+	for( i = 0; i < started; i++ )
+	    if( i != winner && fds[i] != -1 )
+	        NET_CLOSE_SOCKET( fds[i] );
+
+	if( winner >= 0 )
+	{
+	    if( DEBUG_CONNECT )
+	    {
+	        StrBuf addr;
+	        NetUtils::GetAddress( addrs[ winner ]->ai_family,
+	            addrs[ winner ]->ai_addr, RAF_PORT, addr );
+	        TRANSPORT_PRINTF( DEBUG_CONNECT, "NetTcpEndPoint race won by %s",
+	            addr.Text() );
+	    }
+
+	    SetNonBlocking( fds[ winner ], 0 );
+	    return fds[ winner ];
+	}
+
+	return -1;
+}
+
+# endif /* USE_SELECTOR */
+
 /**
  * return true if we resolved the address, false otherwise
  */
@@ -350,6 +623,24 @@ NetTcpEndPoint::GetAddrInfo( AddrType type, NetAddrInfo &ai, Error *e )
 	}
 
 	ai.SetHintsFlags( ai_flags );
+
+	/*
+	 * Connects reuse a recent lookup (of the same host, port and
+	 * hints) for net.dns.ttl seconds, rather than resolving the
+	 * host every time.  The retries below may change the flags,
+	 * so the cache is keyed on the ones we started with.
+	 */
+	const int ttl = (type == AT_CONNECT) ? p4tunable.Get( P4TUNE_NET_DNS_TTL ) : 0;
+	const int cacheKey = ai_flags;
+
+	if( ttl && ai.CacheGet( cacheKey ) )
+	{
+	    TRANSPORT_PRINTF( DEBUG_CONNECT,
+		    "NetTcpEndPoint::GetAddrInfo(port=%s) [cached]",
+		    hostPort.Text() );
+	    return true;
+	}
+
 	bool result = ai.GetInfo(e);   // resolve the host and service/port names (IPv4 and/or IPv6)
 	if( !result )
 	{
@@ -397,6 +688,9 @@ NetTcpEndPoint::GetAddrInfo( AddrType type, NetAddrInfo &ai, Error *e )
 	    }
 	}
 
+	if( result && ttl )
+	    ai.CachePut( cacheKey, ttl );
+
 	return result;
 }
 
@@ -480,6 +774,37 @@ NetTcpEndPoint::BindOrConnect( AddrType type, struct Error *e )
 	 * if the transport didn't specify an IPv4 or IPv6 preference (via
 	 * transport prefix or numeric address).
 	 */
+	/*
+	 * A connect that may use either family, to a host with addresses
+	 * in both, races them rather than trying one after the other:
+	 * see RaceConnect().  net.connect.delay=0 turns that off.
+	 */
+# ifdef USE_SELECTOR
+	const int delay = p4tunable.Get( P4TUNE_NET_CONNECT_DELAY );
+
+	if( (type == AT_CONNECT) && delay && pp.MayIPv4() && pp.MayIPv6() )
+	{
+	    bool have4 = false, have6 = false;
+
+	    for( const addrinfo *aip = ai.begin(); aip != ai.end(); aip = aip->ai_next )
+	    {
+	        have4 |= (aip->ai_family == AF_INET);
+	        have6 |= (aip->ai_family == AF_INET6);
+	    }
+
+	    if( have4 && have6 )
+	    {
+	        int af_first = (af_target != AF_UNSPEC) ? af_target
+	                                                : ai.begin()->ai_family;
+
+	        fd = RaceConnect( ai, af_first, delay, e );
+	        if( fd != -1 )
+	            e->Clear();
+	        return fd;
+	    }
+	}
+# endif
+
 	fd = CreateSocket( type, ai, af_target, false, e );
 	if( fd == -1 )
 	{
@@ -64,6 +64,7 @@ class NetTcpEndPoint : public NetEndPoint {
 	bool		GetAddrInfo( AddrType type, NetAddrInfo &ai, Error *e );
 	int		BindOrConnect( AddrType type, Error *e );
 	int		CreateSocket( AddrType type, const NetAddrInfo &ai, int af_target, bool useAlternate, Error *e );
+	int		RaceConnect( const NetAddrInfo &ai, int af_first, int delay, Error *e );
 	void		SetupSocket( int fd, int ai_family, AddrType type, Error *e );
 
 	// subclasses can override this to do more setup on the socket, if desired
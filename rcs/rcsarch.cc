@@ -26,12 +26,17 @@
  *	RcsList::RcsList() - append new list member onto chain
  *
  * 	RcsText::Save() - copy text into a new buffer
+ *	RcsText::Keep() - copy text into the archive's RcsTextPool
+ *
+ *	RcsTextPool::Keep() - copy text into the pool's blocks
  *
  *	RcsChunk::Save() - save offset/length pointers of @ block
  *
  * Internal routines:
  *
  *	RcsListFree() - free RcsList chain
+ *	RcsRevHash() - hash a revision name
+ *	RcsArchive::IndexRevision() - add a revision to the name index
  *
  * History:
  *	6-10-95 (seiwald) - added lost support for 'branch rev' in ,v header.
@@ -58,11 +63,12 @@ RcsText::Save(
 	int nlen,
 	const char *trace )
 {
-	if( text )
+	if( text && !pooled )
 	    delete [] text;
 
 	len = nlen;
 	text = new char[ nlen + 1 ];
+	pooled = 0;
 
 	memcpy( text, ntext, nlen );
 
@@ -72,6 +78,58 @@ RcsText::Save(
 	    p4debug.printf( ": %s: %s\n", trace, text );
 }
 
+void
+RcsText::Keep( 
+	const char *ntext,
+	int nlen,
+	RcsTextPool *pool,
+	const char *trace )
+{
+	if( text && !pooled )
+	    delete [] text;
+
+	len = nlen;
+	text = pool->Keep( ntext, nlen );
+	pooled = 1;
+
+	if( DEBUG_CORE )
+	    p4debug.printf( ": %s: %s\n", trace, text );
+}
+
+char *
+RcsTextPool::Keep(
+	const char *ntext,
+	int nlen )
+{
+	/* Parse() tokens are short; a block holds many */
+
+	if( nlen + 1 > left )
+	{
+	    Block *b = new Block;
+	    b->next = blocks;
+	    blocks = b;
+	    left = sizeof( b->text );
+	}
+
+	char *text = blocks->text + sizeof( blocks->text ) - left;
+
+	memcpy( text, ntext, nlen );
+	text[ nlen ] = 0;
+	left -= nlen + 1;
+
+	return text;
+}
+
+RcsTextPool::~RcsTextPool()
+{
+	while( blocks )
+	{
+	    Block *b = blocks;
+	    blocks = blocks->next;
+	    delete b;
+	}
+}
+
 void
 RcsChunk::Save(
 	RcsChunk *src,
@@ -119,6 +177,23 @@ RcsListFree( RcsList *list )
 	}
 }
 
+static int
+RcsRevHash( const char *r )
+{
+	int revHash = 0;
+
+	while( *r )
+	    revHash = ( revHash << 4 ) ^ (*r++) ;
+
+	return revHash;
+}
+
+static inline int
+RcsRevSlot( int revHash, int bits )
+{
+	return (unsigned int)revHash * 2654435769u >> ( 32 - bits );
+}
+
 RcsRev *
 RcsArchive::AddRevision(
 	const char	*revName,
@@ -126,18 +201,17 @@ RcsArchive::AddRevision(
 	RcsRev		*prevRev,
 	Error		*e )
 {
-	int revHash = 0;
-	const char *r = revName;
 	RcsRev *rev = new RcsRev;
 
 	rev->deleted = 0;
 	rev->branches = 0;
-	rev->revName.Save( revName, strlen( revName ), "revname" );
 
-	while( *r )
-	    revHash = ( revHash << 4 ) ^ (*r++) ;
+	if( pool )
+	    rev->revName.Keep( revName, strlen( revName ), pool, "revname" );
+	else
+	    rev->revName.Save( revName, strlen( revName ), "revname" );
 
-	rev->revHash = revHash;
+	rev->revHash = RcsRevHash( revName );
 
 	if( append )
 	    prevRev = revTail;
@@ -156,31 +230,69 @@ RcsArchive::AddRevision(
 	if( prevRev == revTail )
 	    revTail = rev;
 
+	IndexRevision( rev );
+
 	return rev;
 }
 
+/*
+ * RcsArchive::IndexRevision() - add a revision to the name index
+ *
+ * Open hashing, doubling the table to keep chains short.  If the
+ * name is already there, the earlier revision keeps it, as that's
+ * what a scan of the chain from the head would find.
+ */
+
+void
+RcsArchive::IndexRevision( RcsRev *rev )
+{
+	rev->hashNext = 0;
+
+	if( !revIndex || revCount >= ( 2 << revIndexBits ) )
+	{
+	    RcsRev **old = revIndex;
+	    int oldSize = revIndex ? 1 << revIndexBits : 0;
+
+	    revIndexBits = revIndex ? revIndexBits + 1 : 6;
+	    revIndex = new RcsRev *[ 1 << revIndexBits ];
+	    memset( revIndex, 0, sizeof( RcsRev * ) << revIndexBits );
+
+	    for( int i = 0; i < oldSize; i++ )
+		for( RcsRev *r = old[i], *n; r; r = n )
+	    {
+		RcsRev **slot = &revIndex[ RcsRevSlot( r->revHash, revIndexBits ) ];
+		n = r->hashNext;
+		r->hashNext = *slot;
+		*slot = r;
+	    }
+
+	    delete [] old;
+	}
+
+	RcsRev **slot = &revIndex[ RcsRevSlot( rev->revHash, revIndexBits ) ];
+
+	for( ; *slot; slot = &(*slot)->hashNext )
+	    if( (*slot)->revHash == rev->revHash && 
+		!strcmp( (*slot)->revName.text, rev->revName.text ) )
+		return;
+
+	*slot = rev;
+	++revCount;
+}
+
 RcsRev *
 RcsArchive::FindRevision(
 	const char 	*revName,
 	Error 		*e ) 
 {
 	RcsRev *r;
-	const char *rs = revName;
-	int revHash = 0;
-
-	while( *rs )
-	    revHash = ( revHash << 4 ) ^ (*rs++) ;
+	int revHash = RcsRevHash( revName );
 
-	/* We make a first pass starting at the lastFoundRev, figuring */
-	/* that in-order scans are the most common (and should go fast). */
+	/* Revisions are indexed by name as they're added. */
 
-	for( r = lastFoundRev; r; r = (RcsRev *)r->qNext )
-	{
-	    if( r->revHash == revHash && !strcmp( r->revName.text, revName ) )
-		return lastFoundRev = r;
-	}
-
-	for( r = revHead; r; r = (RcsRev *)r->qNext )
+	if( revIndex )
+	    for( r = revIndex[ RcsRevSlot( revHash, revIndexBits ) ]; 
+		 r; r = r->hashNext )
 	{
 	    if( r->revHash == revHash && !strcmp( r->revName.text, revName ) )
 		return lastFoundRev = r;
@@ -226,6 +338,11 @@ RcsArchive::RcsArchive()
 	revTail = 0;
 	lastFoundRev = 0;
 	chunkCnt = 0;
+	revIndex = 0;
+	revIndexBits = 0;
+	revCount = 0;
+	pool = 0;
+	parser = 0;
 }
 
 RcsArchive::~RcsArchive()
@@ -249,5 +366,12 @@ RcsArchive::~RcsArchive()
 
 	    delete rev;
 	}
+
+	delete [] revIndex;
+
+	/* After the revisions, whose strings are in the pool */
+
+	ParseFree();
+	delete pool;
 }
 
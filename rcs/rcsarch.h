@@ -14,6 +14,7 @@
  *	RcsRev - all information about a revision
  *	RcsChunk - a pointer/length back into the RCS file for @ text
  *	RcsText - an allocated string with its strlen().
+ *	RcsTextPool - blocks of RcsText strings from the parse
  *
  * Public methods:
  *
@@ -23,11 +24,13 @@
  *	RcsArchive::FindRevision() - find a revision on the chain
  *	RcsArchive::NextRevision() - conveniently follow the rev's next pointer
  *	RcsArchive::Parse() - parse the whole RCS archive
+ *	RcsArchive::ParseText() - parse on to a revision's log and text
  * 	RcsArchive::FollowRevision() - compute successor to current rev
  *
  *	RcsList::RcsList() - append new list member onto chain
  *
  * 	RcsText::Save() - copy text into a new buffer
+ *	RcsText::Keep() - copy text into the archive's RcsTextPool
  *
  *	RcsChunk::Save() - save offset/length pointers of @ block
  *
@@ -42,6 +45,7 @@
 
 class FileSys;
 class ReadFile;
+struct RcsParse;
 
 typedef int RcsLine;		// when counting lines
 typedef offL_t RcsSize;		// when counting bytes in file
@@ -69,17 +73,52 @@ struct RcsChunk
 	RcsChunkAt	atWork;		/* what to do with @'s */
 };
 
+/*
+ * RcsTextPool - blocks of RcsText strings from the parse
+ *
+ * Parse() makes several little strings for each revision, which
+ * live as long as the archive unless rewritten.  Rather than new
+ * each one, RcsText::Keep() copies them into blocks that the archive
+ * frees all at once.
+ */
+
+class RcsTextPool
+{
+    public:
+			RcsTextPool() { blocks = 0; left = 0; }
+			~RcsTextPool();
+
+	char		*Keep( const char *ntext, int nlen );
+
+    private:
+
+	struct Block {
+		Block	*next;
+		char	text[ 8000 ];
+	} ;
+
+	Block		*blocks;
+	int		left;
+
+} ;
+
 /*
  * RcsText - an allocated string with its strlen().
+ *
+ * Save() makes a copy this RcsText owns; Keep() puts it in an
+ * RcsTextPool, which owns it instead.
  */
 
 struct RcsText
 {
-	inline		RcsText() { text = 0; len = 0; }
-	inline		~RcsText() { delete [] text; }
-	inline void	Clear() { delete [] text; text = 0; len = 0; }
+	inline		RcsText() { text = 0; len = 0; pooled = 0; }
+	inline		~RcsText() { if( !pooled ) delete [] text; }
+	inline void	Clear() { if( !pooled ) delete [] text; 
+			          text = 0; len = 0; pooled = 0; }
 
 	void 		Save( const char *ntext, int nlen, const char *trace );
+	void 		Keep( const char *ntext, int nlen, 
+				RcsTextPool *pool, const char *trace );
 
 	inline void	Save( RcsText &ntext, const char *trace )
 			{ Save( ntext.text, ntext.len, trace ); }
@@ -89,6 +128,7 @@ struct RcsText
 
 	char		*text;
 	int		len;
+	int		pooled;
 };
 
 /*
@@ -114,6 +154,7 @@ struct RcsList
 struct RcsRev
 {
 	RcsRev 		*qNext;
+	RcsRev		*hashNext;	/* RcsArchive's revision index */
 
 	/* Stuff in the header */
 
@@ -146,6 +187,7 @@ class RcsArchive
 
 	void    	Parse( ReadFile *file, 
 				const char *toThisRev, Error *e );
+	void		ParseText( RcsRev *rev, Error *e );
 
 	RcsRev		*AddRevision( const char *revName, 
 				int insert, RcsRev *prevRev, Error *e );
@@ -181,4 +223,20 @@ class RcsArchive
 
 	int		chunkCnt;
 
+    private:
+
+	void		IndexRevision( RcsRev *rev );
+	void		ParseFree();
+
+	/* Revisions hashed by name, for FindRevision() */
+
+	RcsRev		**revIndex;
+	int		revIndexBits;
+	int		revCount;
+
+	/* Header strings; the parse, if stopped short of the end */
+
+	RcsTextPool	*pool;
+	RcsParse	*parser;
+
 };
@@ -148,6 +148,15 @@ RcsCkin::RcsCkin(
 	RcsDate date;
 	RcsRevPlace place;
 
+	/*
+	 * We're rewriting the archive, so we'll need all of it.
+	 */
+
+	archive->ParseText( 0, e );
+
+	if( e->Test() )
+	    goto fail;
+
 	/*
 	 * Use RcsRevPlace to figure out this rev's relationship to 
 	 * existing revs.  The 'place' flag says whether its on the trunk
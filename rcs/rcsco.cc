@@ -16,23 +16,29 @@
  *	RcsCkout::RcsCkOut() - set up for checkout
  *	RcsCkout::~RcsCkout() - finish and dispose of an RcsCkout
  *	RcsCkout::Ckout() - build up the piece table for given rev
+ *	RcsCkout::CkoutEach() - build up several revs, one pass down the deltas
  *	RcsCkout::Read() - read text from a revision recreated by Ckout()
  *
  * Private methods:
  *
  *	RcsCkout::ApplyExit() - apply a revision's worth of diffs
+ *	RcsCkout::Head() - start the piece table with the head rev
+ *	RcsCkout::Follow() - apply edits from the current rev to another
+ *	RcsCkout::Ready() - set up Read() for the current rev
  *
  * Internal classes/structures:
  *
  * 	RcsEdit - a single add or delete block from a diff
  * 	RcsPiece - a piece of an RcsEdit
+ *	RcsArena - blocks of RcsEdits and RcsPieces, freed all at once
  *
  * Internal routines:
  *
- *	RcsPieceSplit() - split an entry in piece table 
- *	RcsPiecePosition() - move currPtr to point to piece to be edited
- *	RcsPieceInsert() - make an insertion edit before the current piece
- *	RcsPieceDelete() - make a deletion edit at the current piece
+ *	RcsPieceSplit() - split the piece tree at a line number
+ *	RcsPieceJoin() - join two piece trees end to end
+ *	RcsPieceChain() - chain the piece tree's pieces in order for Read()
+ *
+ *	RcsFollows() - can the deltas be followed from one rev to another
  *
  *	RcsEditSkip() - read and toss whole lines from file
  * 	RcsAtStrip() - turn @@'s into @'s, handling @@ split across calls
@@ -94,10 +100,10 @@
 
 struct RcsEdit
 {
-	struct RcsEdit *chain;	/* just for freeing */
 	RcsChunk	chunk;		/* actual location of edit text */
 	RcsChunk	readChunk;	/* chunk copy eaten by RcsCkoutRead */
 	RcsLine		readLineOffset;	/* # lines between chunk & readChunk */
+	unsigned int	readGen;	/* readChunk good if RcsCkout's */
 
 } ;
 
@@ -110,6 +116,12 @@ struct RcsEdit
  * edit, and so we instead string together the active pieces of RcsEdits.  
  * Each RcsPiece points back to the original RcsEdit, and says what subset 
  * of the lines in that edit are still active.
+ *
+ * While Ckout() applies deltas, the pieces form a tree (a treap) in
+ * line order, each node knowing how many lines are beneath it, so
+ * that finding an edit's line costs log(pieces) rather than a walk
+ * down a list.  Once the revision is built, the pieces are chained
+ * in order for Read().
  */
 
 struct RcsPiece
@@ -119,217 +131,252 @@ struct RcsPiece
 	RcsLine		lineCount;	/* bogusly big == whole edit */
 	RcsEdit		*edit;
 
-} ;
+	/* piece tree */
 
-/*
- * Piece table routines.
- */
+	struct RcsPiece *left;		/* earlier lines */
+	struct RcsPiece *right;		/* later lines */
+	P4INT64		lines;		/* lineCount of us and below */
+	unsigned int	priority;	/* random; parents' are higher */
+
+} ;
 
 /*
- * RcsPieceSplit() - split an entry in piece table 
- *
- * We need to make an edit (add or delete a piece) in the middle of
- * and old piece.  We always make our inserts between pieces and our
- * deletions from the head of a piece, so we split the old piece in
- * two.  The part we are not interested in is the "split", which
- * the currPtr moves past.  The part we are interested in lives on
- * as the "piece".
+ * RcsArena - blocks of RcsEdits and RcsPieces, freed all at once
  *
- * Both the split piece and the original point to the same "chunk":
- * that is, the same piece of the RCS file that contains the lines
- * to be added.  The pieces differ in their lineOffset and lineCount
- * values: the two new pieces point to their respective shares of the
- * old piece's lines.
- *
- * ***
- *
- * Ok, General, why the three stars on currPtr?
- *
- * We actually reference three things with this:
- *
- *	We reference and update the contents of the current piece
- *	via piece->xxx (which is (**currPtr)->xxx.
- *
- *	The pointer to the current piece is actually kept as the
- *	previous piece's next pointer.  If we insert a new piece, 
- *	we have to update that previous piece's next pointer
- *	by setting **currPtr.
- *
- *	As we sweep past pieces in search of the currLineNumber,
- *	we note our progress by updating the caller's pointer
- *	to the previous piece's next pointer.  That's *currPtr.
+ * A checkout of a deep revision makes and discards lots of pieces,
+ * so rather than new and delete each one we carve them out of blocks
+ * and let the RcsCkout's destructor toss the lot.  The arena also
+ * deals out the pieces' random treap priorities.
  */
 
-static void
-RcsPieceSplit(
-	RcsPiece ***currPtr,
-	RcsLine *currLineNumber,
-	RcsLine splitCount,
-	Error *e )
+struct RcsPieceBlock
 {
-	RcsPiece *piece = **currPtr;
-	RcsPiece *split = new RcsPiece;
-
-	/* split piece contains first half */
-
-	split->chain = piece;
-	split->edit = piece->edit;
-	split->lineOffset = piece->lineOffset;
-	split->lineCount = splitCount;
-	**currPtr = split;
-
-	/* old piece contains second half */
+	RcsPieceBlock	*chain;
+	RcsPiece	pieces[ 256 ];
+} ;
 
-	piece->lineOffset += split->lineCount;
-	piece->lineCount -= split->lineCount;
+struct RcsEditBlock
+{
+	RcsEditBlock	*chain;
+	RcsEdit		edits[ 64 ];
+} ;
 
-	if( DEBUG_EDIT_FINE )
-	    p4debug.printf( "split moved lineOffset to %d by %d\n", 
-			piece->lineOffset, split->lineCount );
+struct RcsArena
+{
+			RcsArena()
+			{
+			    pieceBlocks = 0; piecesLeft = 0;
+			    editBlocks = 0; editsLeft = 0;
+			    seed = 2463534242U;
+			}
 
-	/* advance past the split piece */
+			~RcsArena();
 
-	*currLineNumber += split->lineCount;
-	*currPtr = &split->chain;
+	RcsPiece	*NewPiece( RcsEdit *edit, 
+			    RcsLine lineOffset, RcsLine lineCount );
 
-	if( DEBUG_EDIT_FINE )
-	    p4debug.printf( "split skipped to line %d\n", *currLineNumber );
-}
+	RcsEdit		*NewEdit();
 
+	RcsPieceBlock	*pieceBlocks;
+	int		piecesLeft;
+	RcsEditBlock	*editBlocks;
+	int		editsLeft;
+	unsigned int	seed;
 
-/*
- * RcsPiecePosition() - move currPtr to point to piece to be edited
- *
- * We need to make an edit, so we scan down the piece list, moving
- * currPtr, until we find the piece that contains the first line
- * affected by the edit.  If the first line affected is in the middle
- * of a piece, we split that piece up.
- */
+} ;
 
-static void
-RcsPiecePosition(
-	RcsPiece ***currPtr,
-	RcsLine *currLineNumber,
-	RcsLine editLineNumber, 
-	Error *e )
+RcsArena::~RcsArena()
 {
-	RcsPiece *piece = **currPtr;
-	RcsLine splitCount;
-
-	/* Advance until we find the piece that contains editLineNumber. */
-	/* We assume that it is this piece or after. */
+	for( RcsPieceBlock *p = pieceBlocks; p; )
+	{
+	    RcsPieceBlock *next = p->chain;
+	    delete p;
+	    p = next;
+	}
 
-	if( editLineNumber < *currLineNumber )
+	for( RcsEditBlock *e = editBlocks; e; )
 	{
-	    e->Set( MsgLbr::Edit0 );
-	    return;
+	    RcsEditBlock *next = e->chain;
+	    delete e;
+	    e = next;
 	}
+}
 
-	while( piece && editLineNumber >= *currLineNumber + piece->lineCount )
+RcsPiece *
+RcsArena::NewPiece(
+	RcsEdit *edit,
+	RcsLine lineOffset,
+	RcsLine lineCount )
+{
+	if( !piecesLeft )
 	{
-	    *currLineNumber += piece->lineCount;
-	    *currPtr = &piece->chain;
-	    piece = piece->chain;
+	    RcsPieceBlock *b = new RcsPieceBlock;
+	    b->chain = pieceBlocks;
+	    pieceBlocks = b;
+	    piecesLeft = 256;
 	}
 
-	if( DEBUG_EDIT_FINE )
-	    p4debug.printf( "advance skipped to line %d\n", *currLineNumber );
+	RcsPiece *piece = &pieceBlocks->pieces[ --piecesLeft ];
+
+	/* xorshift32 */
 
-	/* If the new piece starts in the middle of the old, we have */
-	/* to split off the front of the old. */
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
 
-	if( ( splitCount = editLineNumber - *currLineNumber ) > 0 )
-	    RcsPieceSplit( currPtr, currLineNumber, splitCount, e );
+	piece->chain = 0;
+	piece->edit = edit;
+	piece->lineOffset = lineOffset;
+	piece->lineCount = lineCount;
+	piece->left = 0;
+	piece->right = 0;
+	piece->lines = lineCount;
+	piece->priority = seed;
+
+	return piece;
+}
+
+RcsEdit *
+RcsArena::NewEdit()
+{
+	if( !editsLeft )
+	{
+	    RcsEditBlock *b = new RcsEditBlock;
+	    b->chain = editBlocks;
+	    editBlocks = b;
+	    editsLeft = 64;
+	}
+
+	return &editBlocks->edits[ --editsLeft ];
 }
 
 /*
- * RcsPieceInsert() - make an insertion edit before the current piece
- *
- * This handles the diff 'aX Y' edits: add lines.  Since we are already
- * positioned before the first line affected, we just insert our new
- * piece.
+ * Piece tree routines.
  */
 
-static void
-RcsPieceInsert(
-	RcsPiece ***currPtr,
-	RcsLine *currLineNumber,
-	RcsLine editLineCount,
-	RcsEdit *edit,
-	Error *e )
+static inline P4INT64
+RcsPieceLines( RcsPiece *piece )
 {
-	RcsPiece *newPiece = new RcsPiece;
-
-	newPiece->lineOffset = 0;
-	newPiece->lineCount = editLineCount;
-	newPiece->edit = edit;
+	return piece ? piece->lines : 0;
+}
 
-	/* Now we just insert the newPiece before piece */
+static inline void
+RcsPieceCount( RcsPiece *piece )
+{
+	piece->lines = RcsPieceLines( piece->left ) + piece->lineCount +
+		       RcsPieceLines( piece->right );
+}
 
-	newPiece->chain = **currPtr;
-	**currPtr = newPiece;
+/*
+ * RcsPieceJoin() - join two piece trees end to end
+ *
+ * All of the lines of 'front' come before those of 'back'.  The root
+ * with the higher priority stays on top.
+ */
 
-	/* Advance past the new piece */
+static RcsPiece *
+RcsPieceJoin(
+	RcsPiece *front,
+	RcsPiece *back )
+{
+	if( !front ) return back;
+	if( !back ) return front;
 
-	*currPtr = &newPiece->chain;
+	if( front->priority > back->priority )
+	{
+	    front->right = RcsPieceJoin( front->right, back );
+	    RcsPieceCount( front );
+	    return front;
+	}
+	else
+	{
+	    back->left = RcsPieceJoin( front, back->left );
+	    RcsPieceCount( back );
+	    return back;
+	}
 }
 
 /*
- * RcsPieceDelete() - make a deletion edit at the current piece
- *
- * This handles the diff 'dX Y' edits: delete lines.  We are already
- * positioned at the first line affected, so we delete (and free)
- * whole pieces as necessary to delete lines, and then, if the lines
- * to be deleted end in the middle of a piece, delete the lines from
- * the beginning of that piece.  We do that simply by adjusting the
- * piece's lineOffset and lineCount, which say where in the chunk 
- * are the piece's lines.
+ * RcsPieceSplit() - split the piece tree at a line number
+ *
+ * Puts the first 'lines' lines of the tree into *front and the rest
+ * into *back.  If the split lands in the middle of a piece, that piece
+ * is split in two.  Both halves point to the same RcsEdit, differing 
+ * only in their lineOffset and lineCount values: the two new pieces 
+ * point to their respective shares of the old piece's lines.
  */
 
 static void
-RcsPieceDelete( 
-	RcsPiece ***currPtr,
-	RcsLine *currLineNumber,
-	RcsLine editLineCount,
-	Error *e )
+RcsPieceSplit(
+	RcsPiece *piece,
+	P4INT64 lines,
+	RcsPiece **front,
+	RcsPiece **back,
+	RcsArena *arena )
 {
-	RcsPiece *piece = **currPtr;
+	if( !piece )
+	{
+	    *front = *back = 0;
+	    return;
+	}
 
-	/* Delete any pieces that are wholly deleted by this edit. */
+	P4INT64 leftLines = RcsPieceLines( piece->left );
 
-	while( piece && editLineCount >= piece->lineCount )
+	if( lines <= leftLines )
+	{
+	    RcsPieceSplit( piece->left, lines, front, &piece->left, arena );
+	    RcsPieceCount( piece );
+	    *back = piece;
+	}
+	else if( lines >= leftLines + piece->lineCount )
 	{
-	    /* Point past the curr piece */
+	    RcsPieceSplit( piece->right, lines - leftLines - piece->lineCount,
+			&piece->right, back, arena );
+	    RcsPieceCount( piece );
+	    *front = piece;
+	}
+	else
+	{
+	    /* split piece contains first half */
 
-	    **currPtr = piece->chain;
-	    *currLineNumber += piece->lineCount;
-	    editLineCount -= piece->lineCount;
+	    RcsLine splitCount = (RcsLine)( lines - leftLines );
+	    RcsPiece *split = arena->NewPiece( 
+				piece->edit, piece->lineOffset, splitCount );
 
-	    if( DEBUG_EDIT_FINE )
-		p4debug.printf( "delete skipped to line %d\n", *currLineNumber );
+	    /* old piece contains second half */
 
-	    delete piece;
+	    piece->lineOffset += splitCount;
+	    piece->lineCount -= splitCount;
 
-	    piece = **currPtr;
+	    if( DEBUG_EDIT_FINE )
+		p4debug.printf( "split moved lineOffset to %d by %d\n", 
+			piece->lineOffset, splitCount );
+
+	    *front = RcsPieceJoin( piece->left, split );
+	    piece->left = 0;
+	    RcsPieceCount( piece );
+	    *back = piece;
 	}
+}
 
-	/* The edit may delete the initial part of the remaining piece. */
+/*
+ * RcsPieceChain() - chain the piece tree's pieces in order for Read()
+ */
 
-	if( editLineCount )
+static void
+RcsPieceChain(
+	RcsPiece *piece,
+	RcsPiece ***tail )
+{
+	while( piece )
 	{
-	    if( !piece )
-	    {
-		e->Set( MsgLbr::Edit1 );
-		return;
-	    }
-
-	    piece->lineOffset += editLineCount;
-	    piece->lineCount -= editLineCount;
-	    *currLineNumber += editLineCount;
-
-	    if( DEBUG_EDIT_FINE )
-		p4debug.printf( "delete skipped to line %d\n", *currLineNumber );
+	    RcsPieceChain( piece->left, tail );
+	    **tail = piece;
+	    *tail = &piece->chain;
+	    piece = piece->right;
 	}
+
+	**tail = 0;
 }
 
 /*
@@ -374,6 +421,10 @@ RcsEditSkip(
  * by applying the diffs that bring the head back to that revision. 
  * RcsEditApply() applies one revision's diffs to the current RcsCkout.
  *
+ * The diff's line numbers are those of the text before any of its
+ * edits, and its edits come in line order, so we keep count of the
+ * lines added less those deleted to find where each lands now.
+ *
  * Bad things can happen if the wrong diff is applied.
  */
 
@@ -383,8 +434,8 @@ RcsCkout::ApplyEdit(
 	Error *e )
 {
 	RcsSize chunkOffset;
-	RcsPiece **piecePtr;
 	RcsLine lineNumber;
+	P4INT64 shift;
 
 	/* Position file for scanning text */
 
@@ -392,6 +443,11 @@ RcsCkout::ApplyEdit(
 	    p4debug.printf( "applying edit for %s: %lld bytes at %lld\n",
 			rev->revName.text, rev->text.length, rev->text.offset );
 
+	archive->ParseText( rev, e );
+
+	if( e->Test() )
+	    return;
+
 	if( !rev->text.file )
 	{
 	    e->Set( MsgLbr::NoRev3 ) << rev->revName.text;
@@ -403,7 +459,7 @@ RcsCkout::ApplyEdit(
 	/* Initialize sweep. */
 
 	lineNumber = 1;
-	piecePtr = &pieces;
+	shift = 0;
 
 	/* As long as there is something left in this revision... */
 
@@ -414,6 +470,7 @@ RcsCkout::ApplyEdit(
 	    char editAction;
 	    char line[ 64 ], *p;
 	    RcsEdit *edit;
+	    RcsPiece *front, *back, *gone;
 	    int l;
 
 	    /* Get the action line */
@@ -445,7 +502,7 @@ RcsCkout::ApplyEdit(
 
 	    if( editAction == 'a' )
 	    {
-		edit = new RcsEdit;
+		edit = arena->NewEdit();
 
 		/* add means add after; we mean before */
 
@@ -461,48 +518,67 @@ RcsCkout::ApplyEdit(
 				editLineCount,
 				rev->text.length - chunkOffset );
 
-		/* Initialize readChunk for RcsCkout::Read() */
+		/* RcsCkout::Read() initializes readChunk */
 
-		edit->readChunk = edit->chunk;
-		edit->readLineOffset = 0;
+		edit->readGen = 0;
 
-		/* Chain edits so they can be freed */
+		chunkOffset += edit->chunk.length;
+	    }
 
-		edit->chain = edits;
-		edits = edit;
+	    /* Edits must come in order, and not overlap. */
 
-		chunkOffset += edit->chunk.length;
+	    if( editLineNumber < lineNumber )
+	    {
+		e->Set( MsgLbr::Edit0 );
+		return;
 	    }
 
-	    /* Advance throught the pieces list until we find the piece */
-	    /* with our editLineNumber.  Split that piece, if necessary, */
-	    /* to make piecePtr point to the insertion/deletion position. */
+	    lineNumber = editLineNumber;
 
-	    RcsPiecePosition( &piecePtr, &lineNumber, editLineNumber, e );
+	    /* Split the pieces where the edit goes, splitting a piece */
+	    /* in two if the edit lands in its middle. */
 
-	    if( e->Test() )
+	    RcsPieceSplit( pieces, editLineNumber - 1 + shift, 
+			&front, &back, arena );
+
+	    if( RcsPieceLines( front ) < editLineNumber - 1 + shift )
+	    {
+		pieces = front;
+		e->Set( MsgLbr::Edit0 );
 		return;
+	    }
 
 	    /* Now insert/delete the new piece. */
 
 	    switch( editAction )
 	    {
 	    case 'a':
-		RcsPieceInsert( &piecePtr, &lineNumber, editLineCount, 
-					edit, e );
+		front = RcsPieceJoin( front,
+			arena->NewPiece( edit, 0, editLineCount ) );
+		shift += editLineCount;
 		break;
 
 	    case 'd':
-		RcsPieceDelete( &piecePtr, &lineNumber, editLineCount, e );
+		RcsPieceSplit( back, editLineCount, &gone, &back, arena );
+
+		if( RcsPieceLines( gone ) < editLineCount )
+		{
+		    pieces = front;
+		    e->Set( MsgLbr::Edit1 );
+		    return;
+		}
+
+		lineNumber += editLineCount;
+		shift -= editLineCount;
 		break;
 	    
 	    default:
+		pieces = RcsPieceJoin( front, back );
 		e->Set( MsgLbr::Edit2 ) << line;
 		return;
 	    }
 
-	    if( e->Test() )
-		return;
+	    pieces = RcsPieceJoin( front, back );
 	}
 }
 
@@ -554,6 +630,37 @@ RcsAtStrip(
  * External routines.
  */
 
+/*
+ * RcsFollows() - can the deltas be followed from one rev to another
+ *
+ * Deltas lead down the trunk from the head and out along branches,
+ * so from a trunk rev we can reach older trunk revs and anything
+ * branching off them, but from a branch rev only later revs on the
+ * branch and its own branches.
+ */
+
+static int
+RcsFollows(
+	const char *fromRev,
+	const char *toRev )
+{
+	switch( RcsRevCmp( toRev, fromRev ) )
+	{
+	case REV_CMP_EQUAL:
+	case REV_CMP_AT_BRANCH:
+	case REV_CMP_NUM_BRANCH:
+	case REV_CMP_OUT_BRANCH:
+	    return 1;
+
+	case REV_CMP_DOWN_TRUNK:
+	    fromRev = strchr( fromRev, '.' );
+	    return !fromRev || !strchr( fromRev + 1, '.' );
+
+	default:
+	    return 0;
+	}
+}
+
 /*
  * RcsCkout() - create an RcsCkout for a particular revision
  *
@@ -569,8 +676,10 @@ RcsCkout::RcsCkout(
 	RcsArchive *archive )
 {
 	this->archive = archive;
+	this->rev = 0;
 	this->pieces = 0;
-	this->edits = 0;
+	this->arena = new RcsArena;
+	this->readGen = 0;
 }
 
 /*
@@ -579,71 +688,61 @@ RcsCkout::RcsCkout(
 
 RcsCkout::~RcsCkout()
 {
-	/* Free the pieces */
-
-	for( RcsPiece *piece = pieces; piece; )
-	{
-	    RcsPiece *next = piece->chain;
-	    delete piece;
-	    piece = next;
-	}
-
-	/* Free the chunks */
+	/* Free the pieces and the chunks */
 
-	for( RcsEdit *chunk = edits; chunk; )
-	{
-	    RcsEdit *next = chunk->chain;
-	    delete chunk;
-	    chunk = next;
-	}
+	delete arena;
 }
 
 /*
- * RcsCkout::Ckout() - build up the piece table for given rev
+ * RcsCkout::Head() - start the piece table with the head rev
  *
- * This creates a single piece for the head rev, and then applies all
- * the edits for the various revs that lead from the head rev to the
- * desired rev.  The result is a big chain of pieces that Read() can
- * string together.
+ * This creates a single piece for the head rev, tossing any pieces
+ * left from an earlier checkout.
  */
 
 void
-RcsCkout::Ckout(
-	const char *revName,
+RcsCkout::Head(
 	Error *e )
 {
-	RcsRev *rev;
-	RcsPiece **piecesp;
 	RcsEdit *edit;
-	RcsLine lineNumber;
 
 	const RcsLine maxInsert = p4tunable.Get( P4TUNE_RCS_MAXINSERT );
 
+	if( pieces )
+	{
+	    delete arena;
+	    arena = new RcsArena;
+	}
+
+	rev = 0;
+	pieces = 0;
+
 	/* 
 	 * Create the initial edit for the head rev contents.
 	 */
 
-	if( !( rev = archive->FindRevision( archive->headRev.text, e ) ) )
-	    goto fail;
+	RcsRev *head = archive->FindRevision( archive->headRev.text, e );
 
-	if( !rev->text.file )
+	if( !head )
+	    return;
+
+	archive->ParseText( head, e );
+
+	if( e->Test() )
+	    return;
+
+	if( !head->text.file )
 	{
-	    e->Set( MsgLbr::NoRev3 ) << rev->revName.text;
-	    goto fail;
+	    e->Set( MsgLbr::NoRev3 ) << head->revName.text;
+	    return;
 	}
 
 	/* Create first edit chunk */
 
-	edit = new RcsEdit;
+	edit = arena->NewEdit();
 
-	edit->chunk = rev->text;
-	edit->readChunk = rev->text;
-	edit->readLineOffset = 0;
-	edit->chain = 0;
-	edits = edit;
-
-	lineNumber = 1;
-	piecesp = &pieces;
+	edit->chunk = head->text;
+	edit->readGen = 0;
 
 	/*
 	 * This will cap the co/sync to 1 billion lines.  It used
@@ -651,43 +750,141 @@ RcsCkout::Ckout(
 	 * beyond 2GB these limits were short-sighted.
 	 */
 
-	RcsPieceInsert( &piecesp, &lineNumber, maxInsert - 1, edit, e );
-
-	if( e->Test() )
-	    goto fail;
-
-	/*
-	 * Now step through the revs, all the way to the desired one,
-	 * editing in the pieces.
-	 */
-
-	/* Default revName to headRev's */
+	pieces = arena->NewPiece( edit, 0, maxInsert - 1 );
+	rev = head;
+}
 
-	revName = revName ? revName : archive->headRev.text;
+/*
+ * RcsCkout::Follow() - apply edits from the current rev to another
+ *
+ * Steps through the revs from the one the pieces now make up to the
+ * desired one, editing in the pieces.
+ */
 
+void
+RcsCkout::Follow(
+	const char *revName,
+	Error *e )
+{
 	while( strcmp( rev->revName.text, revName ) )
 	{
-	    if( !( rev = archive->FollowRevision( rev, revName, e ) ) )
-		goto fail;
+	    RcsRev *next = archive->FollowRevision( rev, revName, e );
+
+	    if( !next )
+		return;
 
-	    ApplyEdit( rev, e );
+	    ApplyEdit( next, e );
 
 	    if( e->Test() )
-		goto fail;
+		return;
+
+	    rev = next;
 	}
+}
 
-	/* Prepare for RcsCkout::Read's scan */
+/*
+ * RcsCkout::Ready() - set up Read() for the current rev
+ *
+ * Strings the tree's pieces along for Read()'s scan, leaving the tree
+ * itself alone so that more edits can be applied to it.  Bumping
+ * readGen makes Read() start each edit's chunk afresh.
+ */
+
+void
+RcsCkout::Ready()
+{
+	RcsPiece **chainp = &readPiece;
+	RcsPieceChain( pieces, &chainp );
 
-	readPiece = pieces;
 	readPieceCount = 0;
 	halfAt = 0;
+	++readGen;
+}
 
-	return;
+/*
+ * RcsCkout::Ckout() - build up the piece table for given rev
+ *
+ * This creates a single piece for the head rev, and then applies all
+ * the edits for the various revs that lead from the head rev to the
+ * desired rev.  The result is a big chain of pieces that Read() can
+ * string together.
+ */
 
-    fail:
-	/* Add our own message. */
+void
+RcsCkout::Ckout(
+	const char *revName,
+	Error *e )
+{
+	/* Default revName to headRev's */
+
+	revName = revName ? revName : archive->headRev.text;
+
+	Head( e );
+
+	if( !e->Test() )
+	    Follow( revName, e );
+
+	if( e->Test() )
+	{
+	    /* Add our own message. */
 
-	e->Set( MsgLbr::Checkout ) << revName;
+	    rev = 0;
+	    e->Set( MsgLbr::Checkout ) << revName;
+	    return;
+	}
+
+	Ready();
+}
+
+/*
+ * RcsCkout::CkoutEach() - build up several revs, one pass down the deltas
+ *
+ * For annotate-style work that wants many revs of an archive.  Rather
+ * than starting from the head for each, as Ckout() does, this keeps
+ * the piece table from one rev and applies just the deltas on to the
+ * next, handing each rev in turn to handler->Revision() to Read().
+ *
+ * Revs are taken in the order given.  Those in the order the deltas
+ * run -- newest to oldest down the trunk, oldest to newest out a
+ * branch -- cost one pass over the deltas in all; any rev that can't
+ * be reached from the one before it starts again from the head.
+ * A null revName means the head rev.
+ */
+
+void
+RcsCkout::CkoutEach(
+	const char **revNames,
+	int count,
+	RcsCkoutHandler *handler,
+	Error *e )
+{
+	for( int i = 0; i < count; i++ )
+	{
+	    const char *revName = revNames[i] ? revNames[i] 
+					      : archive->headRev.text;
+
+	    if( !rev || !RcsFollows( rev->revName.text, revName ) )
+		Head( e );
+
+	    if( !e->Test() )
+		Follow( revName, e );
+
+	    if( e->Test() )
+	    {
+		/* Don't let a later call follow from a broken table */
+
+		rev = 0;
+		e->Set( MsgLbr::Checkout ) << revName;
+		return;
+	    }
+
+	    Ready();
+
+	    handler->Revision( revName, this, e );
+
+	    if( e->Test() )
+		return;
+	}
 }
 
 /*
@@ -724,6 +921,13 @@ RcsCkout::Read(
 	    /* the desired line in the chunk.  We only do this if we have */
 	    /* not been left in position by a previous RcsCkout::Read(). */
 
+	    if( edit->readGen != readGen )
+	    {
+		edit->readChunk = edit->chunk;
+		edit->readLineOffset = 0;
+		edit->readGen = readGen;
+	    }
+
 	    if( !readPieceCount )
 	    {
 		RcsLine linesToSkip = piece->lineOffset - edit->readLineOffset;
@@ -16,11 +16,17 @@
  *	RcsCkout::RcsCkOut() - set up for checkout
  *	RcsCkout::~RcsCkout() - finish and dispose of an RcsCkout
  *	RcsCkout::Ckout() - build up the piece table for given rev
+ *	RcsCkout::CkoutEach() - build up several revs, one pass down the deltas
  *	RcsCkout::Read() - read text from a revision recreated by Ckout()
  *
+ *	RcsCkoutHandler::Revision() - called by CkoutEach() for each rev
+ *
  * Private methods:
  *
  *	RcsCkout::ApplyExit() - apply a revision's worth of diffs
+ *	RcsCkout::Head() - start the piece table with the head rev
+ *	RcsCkout::Follow() - apply edits from the current rev to another
+ *	RcsCkout::Ready() - set up Read() for the current rev
  *
  * History:
  *	2-18-97 (seiwald) - translated to C++.
@@ -35,7 +41,25 @@
  */
 
 struct RcsPiece;
-struct RcsEdit;
+struct RcsArena;
+struct RcsCkout;
+
+/*
+ * RcsCkoutHandler - receives each revision from RcsCkout::CkoutEach()
+ *
+ * Revision() may Read() the revision from the RcsCkout it is handed,
+ * but must not start another checkout with it.  Setting an error stops
+ * the walk.
+ */
+
+class RcsCkoutHandler
+{
+    public:
+	virtual		~RcsCkoutHandler() {}
+
+	virtual void	Revision( const char *revName, 
+			    RcsCkout *co, Error *e ) = 0;
+} ;
 
 struct RcsCkout
 {
@@ -45,6 +69,9 @@ struct RcsCkout
 
 	void		Ckout( const char *revName, Error *e );
 
+	void		CkoutEach( const char **revNames, int count,
+			    RcsCkoutHandler *handler, Error *e );
+
 	int		Read( char *buf, int len );
 
 
@@ -52,14 +79,20 @@ struct RcsCkout
 
 	void 		ApplyEdit( RcsRev *rev, Error *e );
 
+	void		Head( Error *e );
+	void		Follow( const char *revName, Error *e );
+	void		Ready();
+
     public:
 
 	RcsArchive	*archive;
-	RcsPiece	*pieces;	/* we can can scan them */
-	RcsEdit		*edits;		/* so we can free them */
+	RcsRev		*rev;		/* rev the pieces now make up */
+	RcsPiece	*pieces;	/* tree by line */
+	RcsArena	*arena;		/* so we can free them */
 
 	/* used by RcsCkoutRead */
 
+	unsigned int	readGen;	/* bumped for each rev built */
 	RcsPiece	*readPiece;	/* scans pieces during read */
 	RcsLine		readPieceCount;	/* offset into readPiece */
 	int		halfAt;		/* read suspended between @@ */
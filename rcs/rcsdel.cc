@@ -38,6 +38,13 @@ RcsDelete(
 	RcsRevPlace place;
 	RcsRev *rev;
 
+	/* We're rewriting the archive, so we'll need all of it. */
+
+	archive->ParseText( 0, e );
+
+	if( e->Test() )
+	    return 0;
+
 	/* 
 	 * Find oldRev's currRev, prevRev, and nextRev 
 	 * Mark currRev's state "deleted" in the generated file.
@@ -174,6 +174,13 @@ RcsGenFile::Generate(
 	this->wf = wf;
 	this->e = e;
 
+	/* We need every revision's log and text */
+
+	ar->ParseText( 0, e );
+
+	if( e->Test() )
+	    return;
+
 	/*
 	 * From the header
 	 */
@@ -109,6 +109,16 @@ RcsGenMeta::Generate(
 {
 	RcsRevMeta	rm;
 
+	/* We need every revision's log */
+
+	ar->ParseText( 0, e );
+
+	if( e->Test() )
+	{
+	    AssertLog.Report( e );
+	    return;
+	}
+
 	/* (Recursively) dump out the trunk */
 
 	rm.branch = "main";
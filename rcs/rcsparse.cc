@@ -10,6 +10,7 @@
  * Methods defined:
  *
  *	RcsArchive::Parse() - parse the whole RCS archive
+ *	RcsArchive::ParseText() - parse on to a revision's log and text
  *
  * Internal classes:
  *
@@ -27,6 +28,7 @@
  *	RcsParse::RevHeaders() - parse a revision header
  *	RcsParse::Description() - parse a reivison description
  *	RcsParse::RevLogs() - parse a revision log
+ *	RcsParse::Deltas() - parse revision logs up to a given one
  *
  * History:
  *	5-13-95 (seiwald) - added lost support for 'branch rev' in ,v header.
@@ -48,7 +50,6 @@
 
 # include "rcsdebug.h"
 # include "rcsarch.h"
-# include "rcsrev.h"
 # include <msglbr.h>
 
 const int RCS_MAX_TOKEN = 128;
@@ -70,13 +71,15 @@ enum RcsToken
 struct RcsParse
 {
     public:
-			RcsParse( ReadFile *file );
+			RcsParse( ReadFile *file, RcsTextPool *pool );
 
 	void		Expect( RcsToken token, Error *e );
 	void		List( RcsList **headPtr, Error *e );
 	void		OptRev( RcsText *t, const char *trace, Error *e );
 	void		RevHeaders( RcsArchive *ra, Error *e );
 	void		RevLogs( RcsArchive *archive, Error *e );
+	int		Deltas( RcsArchive *archive, const char *toThisRev,
+				Error *e );
 	void		SetError( Error *e );
 	RcsToken	Token( Error *e );
 	RcsToken	Lookup( RcsToken token );
@@ -84,6 +87,11 @@ struct RcsParse
     public:
 
 	ReadFile *file;
+	RcsTextPool *pool;
+
+	/* Where to pick up again, if Deltas() stops short */
+
+	RcsSize	resume;
 
 	/* Tracing purposes only */
 
@@ -174,9 +182,12 @@ static const char whiteTab[] = {
 # define iswhite(c) whiteTab[ (unsigned char)(c) ]
 
 RcsParse::RcsParse( 
-	ReadFile *rf )
+	ReadFile *rf,
+	RcsTextPool *pool )
 {
 	file = rf;
+	this->pool = pool;
+	resume = 0;
 	lineno = 1;
 	textlen = 0;
 }
@@ -383,7 +394,7 @@ RcsParse::OptRev(
 	switch( Token( e ) )
 	{
 	case RCS_T_REVISION:
-		t->Save( text, textlen, trace );
+		t->Keep( text, textlen, pool, trace );
 		Expect( RCS_T_SEMICOLON, e );
 		break;
 
@@ -416,7 +427,7 @@ RcsParse::List(
 
 	    case RCS_T_STRING:
 		list = new RcsList( headPtr );
-		list->string.Save( text, textlen, "str" );
+		list->string.Keep( text, textlen, pool, "str" );
 		last = RCS_T_STRING;
 		break;
 
@@ -431,7 +442,7 @@ RcsParse::List(
 	    case RCS_T_REVISION:
 		if( last != RCS_T_STRING )
 		    list = new RcsList( headPtr );
-		list->revision.Save( text, textlen, "rev" );
+		list->revision.Keep( text, textlen, pool, "rev" );
 		last = RCS_T_REVISION;
 		break;
 
@@ -457,17 +468,17 @@ RcsParse::RevHeaders(
 
 	Expect( RCS_T_DATE, e );
 	Expect( RCS_T_REVISION, e );
-	rev->date.Save( text, textlen, "date" );
+	rev->date.Keep( text, textlen, pool, "date" );
 	Expect( RCS_T_SEMICOLON, e );
 
 	Expect( RCS_T_AUTHOR, e );
 	Expect( RCS_T_STRING, e );
-	rev->author.Save( text, textlen, "author" );
+	rev->author.Keep( text, textlen, pool, "author" );
 	Expect( RCS_T_SEMICOLON, e );
 
 	Expect( RCS_T_STATE, e );
 	Expect( RCS_T_STRING, e );
-	rev->state.Save( text, textlen, "state" );
+	rev->state.Keep( text, textlen, pool, "state" );
 	Expect( RCS_T_SEMICOLON, e );
 
 	Expect( RCS_T_BRANCHES, e );
@@ -516,14 +527,64 @@ RcsParse::RevLogs(
 	rev->text.Save( &chunk, "text" );
 }
 
+/*
+ * RcsParse::Deltas() - parse revision logs up to a given one
+ *
+ * Parses logs and text through toThisRev's (or to EOF if toThisRev
+ * is null).  Returns 1 if it stopped short of EOF, noting where so
+ * that a later call can pick up even if the file has been read
+ * elsewhere in the meantime.
+ */
+
+int
+RcsParse::Deltas(
+	RcsArchive *archive,
+	const char *toThisRev,
+	Error *e )
+{
+	if( resume )
+	    file->Seek( resume );
+
+	while( !e->Test() )
+	{
+	    switch( Token( e ) )
+	    {
+	    case RCS_T_REVISION:
+
+		if( toThisRev && !strcmp( text, toThisRev ) )
+		{
+		    RevLogs( archive, e );
+		    resume = file->Tell();
+		    return !e->Test();
+		}
+
+		RevLogs( archive, e );
+		continue;
+
+	    case RCS_T_EOF:	
+		return 0;
+
+	    default:
+		e->Set( MsgLbr::ExpEof );
+		return 0;
+	    }
+	}
+
+	return 0;
+}
+
 void
 RcsArchive::Parse(
 	ReadFile *rf,
 	const char *toThisRev,
 	Error *e )
 {
-	RcsParse *rp = new RcsParse( rf );
-	int bail = 0;
+	ParseFree();
+
+	if( !pool )
+	    pool = new RcsTextPool;
+
+	RcsParse *rp = new RcsParse( rf, pool );
 
 	if( DEBUG_PARSE )
 		p4debug.printf( "*** - archive header - ***\n" );
@@ -534,7 +595,7 @@ RcsArchive::Parse(
 	    {
 	    case RCS_T_HEAD:
 		rp->Expect( RCS_T_REVISION, e );
-		headRev.Save( rp->text, rp->textlen, "head" );
+		headRev.Keep( rp->text, rp->textlen, pool, "head" );
 		rp->Expect( RCS_T_SEMICOLON, e );
 		break;
 
@@ -599,51 +660,56 @@ RcsArchive::Parse(
 	if( DEBUG_PARSE )
 		p4debug.printf( "*** - revision logs - ***\n" );
 
-	/* Only shortcut toThisRev if it is on the trunk */
+	/* Stop after toThisRev's text.  If something wants a revision */
+	/* whose text comes later (a branch, say, or a rewrite of the */
+	/* whole file), ParseText() picks up where we left off. */
 
-	if( toThisRev && headRev.text )
+	if( !e->Test() && rp->Deltas( this, toThisRev, e ) )
 	{
-	    switch( RcsRevCmp( headRev.text, toThisRev ) )
-	    {
-		default:
-		    toThisRev = 0;
-
-		case REV_CMP_EQUAL:
-		case REV_CMP_UP_TRUNK:
-		    break;
-	    }
+	    parser = rp;
+	    return;
 	}
 
-	while( !e->Test() && !bail )
-	{
-	    switch( rp->Token( e ) )
-	    {
-	    case RCS_T_REVISION:
+	/* Add our own error */
 
-		if( toThisRev && !strcmp( rp->text, toThisRev ) )
-		    bail++;
+	if( e->Test() )
+	    rp->SetError( e );
 
-		rp->RevLogs( this, e );
-		continue;
+	/* Clean up and return */
 
-	    case RCS_T_EOF:	
-		goto done;
+	delete rp;
+}
 
-	    default:
-		e->Set( MsgLbr::ExpEof );
-		goto done;
-	    }
-	}
-    
-    done:
+/*
+ * RcsArchive::ParseText() - parse on to a revision's log and text
+ *
+ * If Parse() stopped short, carry on until rev's log and text have
+ * been found, or to the end if rev is null.
+ */
 
-	/* Add our own error */
+void
+RcsArchive::ParseText(
+	RcsRev *rev,
+	Error *e )
+{
+	if( !parser || ( rev && rev->text.file ) )
+	    return;
+
+	if( DEBUG_PARSE )
+		p4debug.printf( "*** - more revision logs - ***\n" );
+
+	if( parser->Deltas( this, rev ? rev->revName.text : 0, e ) )
+	    return;
 
 	if( e->Test() )
-	    rp->SetError( e );
+	    parser->SetError( e );
 
-	/* Clean up and return */
+	ParseFree();
+}
 
-	if( rp )
-	    delete rp;
+void
+RcsArchive::ParseFree()
+{
+	delete parser;
+	parser = 0;
 }
@@ -35,6 +35,7 @@
 # include <errorlog.h>
 # include <tracker.h>
 # include <timer.h>
+# include <vararray.h>
 # include <md5.h>
 # include <ticket.h>
 
@@ -276,6 +277,8 @@ Rpc::Rpc( RpcService *s )
 	rpc_hi_mark_fwd = p4tunable.Get( P4TUNE_RPC_HIMARK );
 	rpc_lo_mark = p4tunable.Get( P4TUNE_RPC_LOWMARK );
 
+	handlerStats = new VarArray;
+
 	TrackStart();
 
 	timer = new Timer;
@@ -292,6 +295,11 @@ Rpc::~Rpc( void )
 	delete recvBuffer;
 	delete protoDynamic;
 	delete timer;
+
+	for( int i = 0; i < handlerStats->Count(); i++ )
+	    delete (RpcHandlerStats *)handlerStats->Get( i );
+
+	delete handlerStats;
 }
 
 void
@@ -385,6 +393,18 @@ Rpc::Connect( Error *e )
 	if( keep )
 	    transport->SetBreak( keep );
 
+	// Capturing the server's half of the conversation?  Failure
+	// to open the capture file doesn't fail the connection.
+
+	if( recordFile.Length() )
+	{
+	    Error fe;
+	    transport->SetRecord( recordFile, &fe );
+
+	    if( fe.Test() )
+		AssertLog.Report( &fe );
+	}
+
 	// If rpc.himark tuned beyond net.bufsize, must tell NetBuffer.
 
 	transport->SetBufferSizes( rpc_hi_mark_fwd, rpc_hi_mark_rev );
@@ -773,7 +793,9 @@ Rpc::InvokeOne( const char *opName )
 
 	    transport->Send( buf.GetBuffer(), &re, &se );
 
-	    sendTime += timer->Time();
+	    P4INT64 us = timer->TimeUs();
+	    sendTime += (int)( us / 1000 );
+	    sendWait += us;
 	}
 
 	protocolSent = 1;
@@ -794,7 +816,9 @@ Rpc::InvokeOne( const char *opName )
 	transport->Send( sendBuffer->GetBuffer(), &re, &se );
 
 	// time tracking
-	sendTime += timer->Time();
+	P4INT64 us = timer->TimeUs();
+	sendTime += (int)( us / 1000 );
+	sendWait += us;
 
 	if( se.Test() )
 	    return 0;
@@ -828,6 +852,24 @@ Rpc::GotFlushed()
 	    duplexRrecv -= rseq->Atoi();
 }
 
+/*
+ * HistBucket() - log2 bucket of a value for RpcHandlerStats
+ */
+
+static int
+HistBucket( P4INT64 v )
+{
+	int n = 0;
+
+	while( v > 0 && n < RPC_HIST_BUCKETS - 1 )
+	{
+	    v >>= 1;
+	    ++n;
+	}
+
+	return n;
+}
+
 /*
  * Rpc::Dispatch() - dispatch incoming RPC's until 'release' received
  * Rpc::DispatchOne() - just dispatch from the current buffer
@@ -965,7 +1007,8 @@ Rpc::DispatchOne( RpcDispatcher *dispatcher, bool passError )
 	int sz = transport->Receive( recvBuffer->GetBuffer(), &re, &se );
 
 	// time tracking
-	recvTime += timer->Time();
+	P4INT64 recvWait = timer->TimeUs();
+	recvTime += (int)( recvWait / 1000 );
 
 	if( sz <= 0 )
 	{
@@ -1021,9 +1064,29 @@ Rpc::DispatchOne( RpcDispatcher *dispatcher, bool passError )
 	    goto error;
 	}
 
-	// Invoke requested function.
+	// Invoke requested function, timing it for the handler stats.
 
-	(*disp->function)( this, &ue );
+	{
+	    RpcHandlerStats *stats = FindHandlerStats( disp );
+	    P4INT64 sendWait0 = sendWait;
+	    int bytes = recvBuffer->GetBufferSize();
+	    Timer handlerTimer;
+
+	    handlerTimer.Start();
+
+	    (*disp->function)( this, &ue );
+
+	    P4INT64 handlerUs = handlerTimer.TimeUs();
+	    P4INT64 waitUs = recvWait + sendWait - sendWait0;
+
+	    stats->calls++;
+	    stats->bytes += bytes;
+	    stats->handlerUs += handlerUs;
+	    stats->waitUs += waitUs;
+	    stats->bytesHist[ HistBucket( bytes ) ]++;
+	    stats->handlerHist[ HistBucket( handlerUs ) ]++;
+	    stats->waitHist[ HistBucket( waitUs ) ]++;
+	}
 
 	// Take a copy of the errors
 
@@ -1145,6 +1208,18 @@ Rpc::TrackStart()
 	recvBytes = 0;
 	sendTime = 0;
 	recvTime = 0;
+	sendWait = 0;
+
+	// Zero rather than free: TrackStart() may be called from
+	// within a handler whose stats DispatchOne() still holds.
+
+	for( int i = 0; i < handlerStats->Count(); i++ )
+	{
+	    RpcHandlerStats *s = (RpcHandlerStats *)handlerStats->Get( i );
+	    const char *opName = s->opName;
+	    memset( s, 0, sizeof( *s ) );
+	    s->opName = opName;
+	}
 }
 
 int
@@ -1212,6 +1287,95 @@ Rpc::ForceGetTrack( RpcTrack *track )
 	track->sendTime = sendTime;
 }
 
+/*
+ * Per-handler stats
+ *
+ * Rpc::FindHandlerStats() - find or make the stats for a handler
+ * Rpc::GetHandlerStats() - return the i'th handler's stats, or 0
+ * Rpc::HandlerStatsJson() - format handlers called as a JSON object
+ */
+
+RpcHandlerStats *
+Rpc::FindHandlerStats( const RpcDispatch *disp )
+{
+	// A connection sees a few dozen distinct handlers at most,
+	// and the dispatcher's own Find() is a linear strcmp() scan,
+	// so a pointer scan here is cheap by comparison.
+
+	for( int i = 0; i < handlerStats->Count(); i++ )
+	{
+	    RpcHandlerStats *s = (RpcHandlerStats *)handlerStats->Get( i );
+	    if( s->opName == disp->opName )
+		return s;
+	}
+
+	RpcHandlerStats *s = new RpcHandlerStats;
+	memset( s, 0, sizeof( *s ) );
+	s->opName = disp->opName;
+	handlerStats->Put( s );
+
+	return s;
+}
+
+const RpcHandlerStats *
+Rpc::GetHandlerStats( int i )
+{
+	return (RpcHandlerStats *)handlerStats->Get( i );
+}
+
+static void
+HistJson( StrBuf &out, const char *name, const int *hist )
+{
+	int n = RPC_HIST_BUCKETS;
+
+	while( n > 1 && !hist[ n - 1 ] )
+	    --n;
+
+	out << ",\"" << name << "\":[";
+
+	for( int i = 0; i < n; i++ )
+	{
+	    if( i ) out << ",";
+	    out << hist[ i ];
+	}
+
+	out << "]";
+}
+
+void
+Rpc::HandlerStatsJson( StrBuf &out )
+{
+	// opNames are protocol identifiers: no escaping needed.
+
+	out << "{\"handlers\":[";
+
+	int n = 0;
+
+	for( int i = 0; i < handlerStats->Count(); i++ )
+	{
+	    RpcHandlerStats *s = (RpcHandlerStats *)handlerStats->Get( i );
+
+	    if( !s->calls )
+		continue;
+
+	    if( n++ ) out << ",";
+
+	    out << "{\"op\":\"" << s->opName << "\""
+		<< ",\"calls\":" << StrNum( s->calls )
+		<< ",\"bytes\":" << StrNum( s->bytes )
+		<< ",\"handlerUs\":" << StrNum( s->handlerUs )
+		<< ",\"waitUs\":" << StrNum( s->waitUs );
+
+	    HistJson( out, "bytesHist", s->bytesHist );
+	    HistJson( out, "handlerHist", s->handlerHist );
+	    HistJson( out, "waitHist", s->waitHist );
+
+	    out << "}";
+	}
+
+	out << "]}";
+}
+
 void
 Rpc::CheckKnownHost( Error *e, const StrRef & trustfile )
 {
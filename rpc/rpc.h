@@ -29,6 +29,7 @@
  *	Rpc::Disconnect() - tear down RPC
  *	Rpc::GetAddress() - return address of this endpoint
  *	Rpc::GetPeerAddress() - return address of the peer
+ *	Rpc::SetRecord() - capture received messages to a file on Connect()
  *
  *	Rpc::MakeVar() - return StrBuf for variable contents
  *	Rpc::SetVar() - allocate variable and set contents
@@ -51,6 +52,9 @@
  *
  *	Rpc::StartCompression() -- initiate full link compression
  *
+ *	Rpc::GetHandlerStats() - per-handler counters, by index
+ *	Rpc::HandlerStatsJson() - format per-handler counters as JSON
+ *
  * Methods for rpcservice routines:
  *
  *	Rpc::GotFlushed() - note receipt of "flush" sent by InvokeDuplex()
@@ -61,6 +65,7 @@
  * Public structures:
  *
  *	RpcDispatch - a procedure name/function call mapping
+ *	RpcHandlerStats - calls, bytes and times for one dispatched opName
  */
 
 # ifdef OS_NT
@@ -80,6 +85,7 @@ class KeepAlive;
 class RpcService;
 class RpcForward;
 class Timer;
+class VarArray;
 
 typedef void (*RpcCallback)( Rpc *, Error * );
 
@@ -135,6 +141,28 @@ struct RpcTrack {
 	int		recvTime;
 } ;
 
+/*
+ * RpcHandlerStats - kept by DispatchOne() for each handler it calls
+ *
+ * Times are in microseconds.  handlerUs is wall time in the handler,
+ * including any Dispatch() it nests; waitUs is the time blocked in
+ * the transport receiving the message plus sending from the handler.
+ * Histogram bucket 0 counts zeros; bucket n counts [ 2^(n-1), 2^n ).
+ */
+
+# define RPC_HIST_BUCKETS 32
+
+struct RpcHandlerStats {
+	const char	*opName;
+	P4INT64		calls;
+	P4INT64		bytes;
+	P4INT64		handlerUs;
+	P4INT64		waitUs;
+	int		bytesHist[ RPC_HIST_BUCKETS ];
+	int		handlerHist[ RPC_HIST_BUCKETS ];
+	int		waitHist[ RPC_HIST_BUCKETS ];
+} ;
+
 class RpcService {
 
     public:
@@ -206,6 +234,7 @@ class Rpc : public StrDict {
 	bool		IsSockIPv6();
 	KeepAlive	*GetKeepAlive();
 	void		SetBreak( KeepAlive *breakCallback );
+	void		SetRecord( const StrPtr &file ) { recordFile.Set( file ); }
 	void		SetProtocolDynamic( const char *var, const StrRef &val );
 	void		ClearProtocolDynamic( const char *var );
 
@@ -314,6 +343,9 @@ class Rpc : public StrDict {
 	void		GetTrack( int level, RpcTrack *track );
 	void		ForceGetTrack( RpcTrack *track );
 
+	const RpcHandlerStats *GetHandlerStats( int i );
+	void		HandlerStatsJson( StrBuf &out );
+
 	int		GetHiMarkFwd() { return rpc_hi_mark_fwd; }
 
 	RpcType		RpcTypeIs() { return GetRpcType(); }
@@ -361,9 +393,16 @@ class Rpc : public StrDict {
 	P4INT64		recvBytes;
 	int		sendTime;
 	int		recvTime;
+	P4INT64		sendWait;		// us, for handler stats
+
+	VarArray	*handlerStats;		// RpcHandlerStats per opName
+
+	RpcHandlerStats	*FindHandlerStats( const RpcDispatch *disp );
 
 	Timer		*timer;
 	KeepAlive	*keep;
+
+	StrBuf		recordFile;		// for 'p4 replay'
 } ;
 
 enum RpcUtilityType {
@@ -8,6 +8,9 @@
  * rpctrans.cc - buffer I/O to transport
  */
 
+# define NEED_FCNTL
+# define NEED_FILE
+
 # include <stdhdrs.h>
 
 # include <debug.h>
@@ -15,6 +18,8 @@
 # include <strops.h>
 # include <error.h>
 
+# include <filesys.h>
+
 # include <keepalive.h>
 # include "netportparser.h"
 # include <netconnect.h>
@@ -24,6 +29,52 @@
 # include "rpcdebug.h"
 # include <msgrpc.h>
 
+RpcTransport::~RpcTransport()
+{
+	if( record )
+	{
+	    Error e;
+	    record->Close( &e );
+	    delete record;
+	}
+}
+
+void
+RpcTransport::SetRecord( const StrPtr &file, Error *e )
+{
+	// The capture holds all the server sends, tickets included,
+	// so it must be ours alone: a new file (not one, or a link,
+	// left there by someone else), owner-only before anything is
+	// written to it.
+
+	record = FileSys::Create( FST_BINARY );
+	record->Set( file );
+	record->Unlink();
+
+# ifndef OS_NT
+	int fd = open( file.Text(), O_WRONLY|O_CREAT|O_EXCL, 0600 );
+
+	if( fd < 0 )
+	    e->Sys( "open", file.Text() );
+	else
+	    close( fd );
+# endif
+
+	record->Perms( FPM_RWO );
+
+	if( !e->Test() )
+	    record->Open( FOM_WRITE, e );
+
+	if( !e->Test() )
+	    record->Chmod( FPM_RWO, e );
+
+	if( e->Test() )
+	{
+	    delete record;
+	    record = 0;
+	}
+}
+
 void
 RpcTransport::Send( StrPtr *s, Error *re, Error *se )
 {
@@ -95,6 +146,22 @@ RpcTransport::Receive( StrBuf *s, Error *re, Error *se )
 	    return -1;
 	}
 
+	// Recording?  A failed write just ends the recording.
+
+	if( record )
+	{
+	    Error e;
+	    record->Write( (char *)l, 5, &e );
+	    record->Write( s->End() - length, length, &e );
+
+	    if( e.Test() )
+	    {
+		record->Close( &e );
+		delete record;
+		record = 0;
+	    }
+	}
+
 	return 1;
 }
 
@@ -13,19 +13,35 @@
  *	of a raw NetTransport connection.  RpcTransport just does 
  *	encapsulation of sized data blocks, ensuring that the exact 
  *	buffer sent is recreated in the receiver.
+ *
+ *	If SetRecord() names a file, every message received is also
+ *	written to it exactly as framed on the wire (but uncompressed),
+ *	so that 'p4 replay' can play it back to a client later.  As the
+ *	server's messages carry tickets and the like, the file is made
+ *	afresh, readable only by its owner.
  */
 
+class FileSys;
+
 class RpcTransport : public NetBuffer {
 
     public:
-			RpcTransport( NetTransport *t ) : NetBuffer( t ) {}
+			RpcTransport( NetTransport *t ) : NetBuffer( t )
+			{ record = 0; }
+			~RpcTransport();
 
 	void		Send( StrPtr *s, Error *re, Error *se );
 	int		Receive( StrBuf *s, Error *re, Error *se );
 
+	void		SetRecord( const StrPtr &file, Error *e );
+
 	// For flow control, himark must include the few extra
 	// bytes RpcTransport adds to every message.
 
 	int		SendOverhead() { return 5; }
 
+    private:
+
+	FileSys		*record;	// capture of received messages
+
 } ;
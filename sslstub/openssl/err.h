@@ -21,6 +21,7 @@
 ////////////////////////////////////////////////////////////////////////////
 char * ERR_error_string (unsigned long e,char *buf);
 unsigned long ERR_get_error (void); 
+void ERR_clear_error (void);
 void ERR_load_BIO_strings (void);
 void ERR_remove_thread_state(const CRYPTO_THREADID *not_used);
 #endif // HEADER_ERR_H
@@ -32,6 +32,7 @@
 # define SSL_METHOD void
 # define SSL void
 # define SSL_CTX void
+# define SSL_SESSION void
 # ifndef X509
 # define X509 void
 # endif //X509
@@ -54,6 +55,7 @@
 # define SSL_ERROR_WANT_CONNECT		7
 # define SSL_ERROR_WANT_ACCEPT		8
 # define SSL_RECEIVED_SHUTDOWN          2
+# define SSL3_RT_MAX_PLAIN_LENGTH       16384
 
 // Macro
 #define SSL_CTX_set_mode(ctx,op) \
@@ -81,6 +83,7 @@ int SSL_library_init (void);
 void SSL_load_error_strings (void);
 SSL * SSL_new (SSL_CTX *ctx);
 int SSL_pending (const SSL *s);
+int SSL_peek (SSL *ssl,void *buf,int num);
 int SSL_read (SSL *ssl,void *buf,int num);
 void SSL_set_bio (SSL *s, BIO *rbio,BIO *wbio);
 int SSL_shutdown (SSL *ssl);
@@ -88,6 +91,15 @@ int SSL_write (SSL *ssl,const void *buf,int num);
 const SSL_METHOD * TLSv1_method (void);
 const char  * SSL_get_cipher_list(const SSL *s,int n);
 int	SSL_set_cipher_list(SSL *s, const char *str);
+SSL_SESSION * SSL_get_session (const SSL *ssl);
+int SSL_set_session (SSL *ssl, SSL_SESSION *session);
+int SSL_session_reused (SSL *ssl);
+void SSL_SESSION_free (SSL_SESSION *ses);
+long SSL_SESSION_get_time (const SSL_SESSION *s);
+long SSL_SESSION_get_timeout (const SSL_SESSION *s);
+SSL_SESSION * d2i_SSL_SESSION (SSL_SESSION **a, const unsigned char **pp,
+			       long length);
+int i2d_SSL_SESSION (SSL_SESSION *in, unsigned char **pp);
 
 int EVP_PKEY_print_private(BIO *out, const EVP_PKEY *pkey,
 				int indent, ASN1_PCTX *pctx);
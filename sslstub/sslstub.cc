@@ -113,6 +113,13 @@ ERR_get_error(void)
 
 
 
+void
+ERR_clear_error(void)
+{
+}
+
+
+
 void
 ERR_load_BIO_strings(void)
 {
@@ -308,6 +315,14 @@ SSL_pending(const SSL *s)
 
 
 
+int
+SSL_peek(SSL *ssl, void *buf, int num)
+{
+	return 0;
+}
+
+
+
 int
 SSL_read(SSL *ssl, void *buf, int num)
 {
@@ -339,6 +354,69 @@ SSL_write(SSL *ssl, const void *buf, int num)
 
 
 
+SSL_SESSION *
+SSL_get_session(const SSL *ssl)
+{
+	return NULL;
+}
+
+
+
+int
+SSL_set_session(SSL *ssl, SSL_SESSION *session)
+{
+	return 0;
+}
+
+
+
+int
+SSL_session_reused(SSL *ssl)
+{
+	return 0;
+}
+
+
+
+void
+SSL_SESSION_free(SSL_SESSION *ses)
+{
+}
+
+
+
+long
+SSL_SESSION_get_time(const SSL_SESSION *s)
+{
+	return 0;
+}
+
+
+
+long
+SSL_SESSION_get_timeout(const SSL_SESSION *s)
+{
+	return 0;
+}
+
+
+
+SSL_SESSION *
+d2i_SSL_SESSION(SSL_SESSION **a, const unsigned char **pp, long length)
+{
+	return NULL;
+}
+
+
+
+int
+i2d_SSL_SESSION(SSL_SESSION *in, unsigned char **pp)
+{
+	return 0;
+}
+
+
+
 const SSL_METHOD *
 TLSv1_method(void)
 {
@@ -222,6 +222,10 @@ P4Tunable::tunable P4Tunable::list[] = {
 	"filesys.extendlowmark",0,	B32K,	0,	BBIG,	B1K,	B1K, 0,
 	"filesys.windows.lfn",	0,	1,	0,	10,	1,	1, 0,
 	"filesys.client.nullsync",0,	0,	0,	1,	1,	1, 0,
+	"filesys.resolvemem",	0,	B1M,	0,	B1G,	1,	B1K, 0,
+	"filesys.resolve.threads",0,	2,	0,	64,	1,	1, 0,
+	"filesys.resolve.maxfiles",0,	64,	1,	R1M,	1,	R1K, 0,
+	"filesys.resolve.maxmem",0,	B10M,	0,	B1G,	1,	B1K, 0,
 	"index.domain.owner",	0,      0,      0,      1,      1,      1, 0,
 	"lbr.autocompress",	0,	0,	0,	1,	1,	1, 0,
 	"lbr.bufsize",		0,	B4K,	1,	BBIG,	1,	B1K, 0,
@@ -260,6 +264,8 @@ P4Tunable::tunable P4Tunable::list[] = {
 	"net.tcpsize",		0,	B512K,	B1K,	B256M,	B1K,	B1K, 0,
 	"net.backlog",		0,	128,	1,      SMAX,   1,	B1K, 0,
 	"net.x3.minsize",	0,	B512K,	0,	RBIG,	B1K,	B1K, 0,
+	"net.connect.delay",	0,	250,	0,	RBIG,	1,	R1K, 0,
+	"net.dns.ttl",		0,	30,	0,	RBIG,	1,	R1K, 0,
 	"proxy.deliver.fix",	0,	1,	0,	1,	1,	1, 0,
 	"proxy.monitor.interval", 0,	10,	1,	999,	1,	1, 0,
 	"proxy.monitor.level",	0,	0,	0,	3,	1,	1, 0,
@@ -327,12 +333,14 @@ P4Tunable::tunable P4Tunable::list[] = {
 	"sys.memory.stacksize", 0,      0,      0,      B16K,   1,      B1K, 0, 
 	"sys.rename.max",	0,	10,	10,	RBIG,	1,	R1K, 0,
 	"sys.rename.wait",	0,	1000,	50,	RBIG,	1,	R1K, 0,
+	"sys.sort.threads",	0,	0,	0,	64,	1,	1, 0,
 	"rpl.forward.all",	0,	0,	0,	1,	1,	1, 0,
 	"rpl.forward.login",	0,	0,	0,	1,	1,	1, 0,
 	"rpl.pull.position",	0,	0,	0,	RBIG,	1,	R1K, 0,
 	"rpl.pull.reload",	0,	60000,	0,	RBIG,	1,	R1K, 0,
 	"ssl.secondary.suite",	0,	0,	0,	1,	1,	1, 0,
 	"ssl.client.timeout",	0,	30,	1,	RBIG,	1,	1, 0,
+	"ssl.client.sessions",	0,	16,	0,	R1K,	1,	1, 0,
 	"triggers.io",		0,	0,	0,	1,	1,	1, 0,
 	"istat.mimic.ichanges",	0,	0,	0,	1,	1,	1, 0,
 
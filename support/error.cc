@@ -14,7 +14,6 @@
 # include <strbuf.h>
 # include <strdict.h>
 # include <strtable.h>
-# include <strops.h>
 # include <error.h>
 # include <errorpvt.h>
 
@@ -205,14 +204,8 @@ Error::Fmt( int eno, StrBuf &buf, int opts ) const
 	if( !IsInfo() ) 
 	    buf.Clear();
 
-	StrBuf lfmt;
-	StrPtr *l = 0;
-
-	if( !( opts & EF_NOXLATE ) )
-	{
-	    lfmt.Set( "lfmt" );
-	    l = &lfmt;
-	}
+	StrRef lfmt( "lfmt" );
+	StrPtr *l = opts & EF_NOXLATE ? 0 : &lfmt;
 
 	for( int i = ep->errorCount; i-- > 0; )
 	{
@@ -227,16 +220,16 @@ Error::Fmt( int eno, StrBuf &buf, int opts ) const
 
 	    if( opts & EF_INDENT ) buf.Append( "\t", 1 );
 
+	    // A localized format (lfmt) from the dict, or the ErrorId's.
+	    // Either way, expand it from the parsed-once cache.
+
 	    StrPtr *s;
-	    StrRef fmt;
+	    const char *fmt = ep->ids[i].fmt;
 
-	    if( !l || !( s = ep->whichDict->GetVar( *l, i ) ) )
-	    {
-		fmt.Set( (char *)ep->ids[i].fmt );
-		s = &fmt;
-	    }
+	    if( l && ( s = ep->whichDict->GetVar( *l, i ) ) )
+		fmt = s->Text();
 
-	    StrOps::Expand2( buf, *s, *ep->whichDict ); 
+	    ErrorFmt::Format( ep->ids[i].code, fmt, buf, *ep->whichDict );
 
 	    // Always insert; sometimes append
 
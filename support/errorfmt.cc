@@ -0,0 +1,338 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * errorfmt.cc - error message formats, parsed once
+ *
+ * ErrorFmt() parses a format just as StrOps::Expand2() does, but
+ * rather than expanding as it goes it notes down what to expand, so
+ * that Expand() need only look up the variables.  The two must agree
+ * on every odd case (%%, %'...'%, unterminated %var or [).
+ *
+ * The cache is a table of ErrorFmts indexed by a hash of the code, a
+ * new format for the slot replacing the old.  With pthreads it's per
+ * thread, freed as the thread exits, and needs no locking.  Elsewhere
+ * (NT) there's just the one, and Format() holds a lock across both the
+ * lookup and the expansion, so a slot isn't replaced while in use.
+ */
+
+# define NEED_THREADS
+
+# ifdef OS_NT
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+# endif // OS_NT
+
+# include <stdhdrs.h>
+# include <strbuf.h>
+# include <strdict.h>
+# include <strtable.h>
+# include <error.h>
+# include <errorpvt.h>
+
+enum ErrorFmtKind {
+	EFO_TEXT,	// text
+	EFO_VAR,	// %var%
+	EFO_OPT		// [ pre %var% post | alt ]
+} ;
+
+struct ErrorFmtOp {
+	int		kind;
+	int		text;		// offset into fmt
+	int		length;
+
+	// EFO_VAR, EFO_OPT
+
+	int		name;		// offset into names
+	int		nameLength;
+
+	// EFO_OPT: text/length is pre
+
+	int		post;
+	int		postLength;
+	int		alt;		// -1 if no | alt
+	int		altLength;
+} ;
+
+ErrorFmt::ErrorFmt( int code, const char *f )
+{
+	this->code = code;
+	fmt.Set( f );
+	names.Clear();
+
+	nOps = 0;
+	maxOps = 8;
+	ops = new ErrorFmtOp[ maxOps ];
+
+	// Follow StrOps::Expand2() step by step, from our own copy.
+
+	const char *b = fmt.Text();
+	const char *p = b;
+	const char *q, *r, *s, *t;
+
+	while( ( q = strchr( p, '%' ) ) )
+	{
+	    if( q[1] == '\'' ) // %' stuff '%: include stuff, uninspected...
+	    {
+		for( s = q + 2; *s; s++ )
+		    if( s[0] == '\'' && s[1] == '%' )
+			break;
+		if( ! *s )
+		    break; // %'junk
+		Op( EFO_TEXT, p, q - p );
+		Op( EFO_TEXT, q + 2, s - q - 2 );
+		p = s + 2;
+		continue;
+	    }
+
+	    if( !( s = strchr( q + 1, '%' ) ) )
+	    {
+		// %junk
+		break;
+	    }
+	    else if( s == q + 1 )
+	    {
+		// %% 
+		Op( EFO_TEXT, p, s - p );
+		p = s + 1;
+		continue;
+	    }
+
+	    // Var name, truncated as StrVarName does.
+
+	    int nl = s - q - 1;
+
+	    if( nl > 63 )
+		nl = 63;
+
+	    int name = names.Length();
+	    names.Append( q + 1, nl );
+	    names.Extend( 0 );
+
+	    if( !( r = (char*)memchr( p, '[', q - p ) ) )
+	    {
+		// %var%
+
+		Op( EFO_TEXT, p, q - p );
+		Op( EFO_VAR, 0, 0 );
+		p = s + 1;
+	    }
+	    else if( !( t = strchr( s + 1, ']' ) ) )
+	    {
+		// [ junk
+		break;
+	    }
+	    else
+	    {
+		// [ stuff1 %var% stuff2 | alternate ]
+
+		Op( EFO_TEXT, p, r - p );
+		Op( EFO_OPT, r + 1, q - r - 1 );
+
+		const char *v = (char *)memchr( s, '|', t - s );
+		if( !v ) v = t;
+
+		ErrorFmtOp &o = ops[ nOps - 1 ];
+		o.post = s + 1 - b;
+		o.postLength = v - s - 1;
+		o.alt = v < t ? v + 1 - b : -1;
+		o.altLength = v < t ? t - v - 1 : 0;
+
+		p = t + 1;
+	    }
+
+	    ErrorFmtOp &o = ops[ nOps - 1 ];
+	    o.name = name;
+	    o.nameLength = nl;
+	}
+
+	Op( EFO_TEXT, p, strlen( p ) );
+}
+
+ErrorFmt::~ErrorFmt()
+{
+	delete []ops;
+}
+
+/*
+ * ErrorFmt::Op() - add an op, merging runs of text
+ */
+
+void
+ErrorFmt::Op( int kind, const char *p, int l )
+{
+	if( kind == EFO_TEXT )
+	{
+	    if( !l )
+		return;
+
+	    ErrorFmtOp *last = nOps ? &ops[ nOps - 1 ] : 0;
+
+	    if( last && last->kind == EFO_TEXT &&
+		fmt.Text() + last->text + last->length == p )
+	    {
+		last->length += l;
+		return;
+	    }
+	}
+
+	if( nOps == maxOps )
+	{
+	    ErrorFmtOp *n = new ErrorFmtOp[ maxOps *= 2 ];
+	    memcpy( n, ops, nOps * sizeof( *ops ) );
+	    delete []ops;
+	    ops = n;
+	}
+
+	ErrorFmtOp &o = ops[ nOps++ ];
+	o.kind = kind;
+	o.text = p ? p - fmt.Text() : 0;
+	o.length = l;
+}
+
+/*
+ * ErrorFmt::Expand() - StrOps::Expand2() using the parsed format
+ */
+
+void
+ErrorFmt::Expand( StrBuf &out, StrDict &dict ) const
+{
+	const char *b = fmt.Text();
+
+	for( const ErrorFmtOp *o = ops; o < ops + nOps; o++ )
+	{
+	    if( o->kind == EFO_TEXT )
+	    {
+		out.Append( b + o->text, o->length );
+		continue;
+	    }
+
+	    StrRef var( names.Text() + o->name, o->nameLength );
+	    StrPtr *val = dict.GetVar( var );
+
+	    if( o->kind == EFO_VAR )
+	    {
+		if( val ) out.Append( val );
+	    }
+	    else if( val && val->Length() )
+	    {
+		out.Append( b + o->text, o->length );
+		out.Append( val );
+		out.Append( b + o->post, o->postLength );
+	    }
+	    else if( o->alt >= 0 )
+	    {
+		out.Append( b + o->alt, o->altLength );
+	    }
+	}
+}
+
+/*
+ * ErrorFmt::Find() - the parsed format for a code and format string
+ *
+ * Formats are matched by content, not address: those that came over
+ * the wire sit in buffers that get reused, and Error::Set( severity,
+ * fmt ) takes any old string.
+ */
+
+const int ErrorFmtSlots = 256;
+
+struct ErrorFmtCache {
+	ErrorFmt	*slots[ ErrorFmtSlots ];
+} ;
+
+static void
+ErrorFmtFree( void *v )
+{
+	ErrorFmtCache *c = (ErrorFmtCache *)v;
+
+	for( int i = 0; i < ErrorFmtSlots; i++ )
+	    delete c->slots[i];
+
+	delete c;
+}
+
+# ifdef HAVE_PTHREAD
+
+static pthread_key_t errorFmtKey;
+static pthread_once_t errorFmtOnce = PTHREAD_ONCE_INIT;
+
+static void
+ErrorFmtKey()
+{
+	pthread_key_create( &errorFmtKey, ErrorFmtFree );
+}
+
+# else
+
+static ErrorFmtCache *errorFmtCache = 0;
+
+# ifdef OS_NT
+static HANDLE errorFmtLock = CreateMutex( NULL, FALSE, NULL );
+# endif
+
+static struct ErrorFmtCleanup {
+	~ErrorFmtCleanup()
+	{
+	    if( errorFmtCache )
+		ErrorFmtFree( errorFmtCache );
+	    errorFmtCache = 0;
+	}
+} errorFmtCleanup;
+
+# endif
+
+ErrorFmt *
+ErrorFmt::Find( int code, const char *fmt )
+{
+	ErrorFmtCache *c;
+
+# ifdef HAVE_PTHREAD
+	pthread_once( &errorFmtOnce, ErrorFmtKey );
+
+	if( !( c = (ErrorFmtCache *)pthread_getspecific( errorFmtKey ) ) )
+	{
+	    c = new ErrorFmtCache;
+	    memset( c, 0, sizeof( *c ) );
+	    pthread_setspecific( errorFmtKey, c );
+	}
+# else
+	if( !( c = errorFmtCache ) )
+	{
+	    c = errorFmtCache = new ErrorFmtCache;
+	    memset( c, 0, sizeof( *c ) );
+	}
+# endif
+
+	unsigned int h = (unsigned int)code * 2654435769u;
+	ErrorFmt *&f = c->slots[ h >> 24 ];
+
+	if( f && f->code == code && !strcmp( f->fmt.Text(), fmt ) )
+	    return f;
+
+	delete f;
+	return f = new ErrorFmt( code, fmt );
+}
+
+/*
+ * ErrorFmt::Format() - expand a format for a code, parsing it once
+ *
+ * Find() then Expand(), under the cache's lock where it's shared.
+ */
+
+void
+ErrorFmt::Format( int code, const char *fmt, StrBuf &o, StrDict &dict )
+{
+# ifdef OS_NT
+	WaitForSingleObject( errorFmtLock, INFINITE );
+# endif
+
+	Find( code, fmt )->Expand( o, dict );
+
+# ifdef OS_NT
+	ReleaseMutex( errorFmtLock );
+# endif
+}
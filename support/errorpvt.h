@@ -82,3 +82,46 @@ class ErrorPrivate {
 
 } ;
 
+/*
+ * ErrorFmt - an error message format, parsed once
+ *
+ * Error::Fmt() expands the same few formats over and over -- a sync
+ * reports each file with one of a handful -- so rather than have
+ * StrOps::Expand2() parse each anew, we parse a format once into a
+ * list of ops (copy text, insert a variable, insert a [ variable ]
+ * with its trimmings or alternate) and keep it in a cache keyed by
+ * ErrorId code and format.
+ *
+ *	ErrorFmt::Format() - Find() and Expand(), locked if need be
+ *	ErrorFmt::Find() - the parsed format for a code and format string
+ *	ErrorFmt::Expand() - StrOps::Expand2() using the parsed format
+ */
+
+struct ErrorFmtOp;
+
+class ErrorFmt {
+
+    public:
+			ErrorFmt( int code, const char *fmt );
+			~ErrorFmt();
+
+	static void	Format( int code, const char *fmt,
+				StrBuf &o, StrDict &dict );
+
+	void		Expand( StrBuf &o, StrDict &dict ) const;
+
+    private:
+
+	static ErrorFmt	*Find( int code, const char *fmt );
+
+	void		Op( int kind, const char *p, int l );
+
+	int		code;
+	StrBuf		fmt;
+	StrBuf		names;
+
+	ErrorFmtOp	*ops;
+	int		nOps;
+	int		maxOps;
+
+} ;
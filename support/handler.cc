@@ -20,6 +20,12 @@
 # define DEBUG_ERROR	( p4debug.GetLevel( DT_HANDLE ) >= 1 )
 
 LastChance::~LastChance()
+{
+	Detach();
+}
+
+void
+LastChance::Detach()
 {
 	if( handler )
 	{
@@ -28,6 +34,7 @@ LastChance::~LastChance()
 
 	    handler->lastChance = 0;
 	    handler->anyErrors |= isError;
+	    handler = 0;
 	}
 }
 
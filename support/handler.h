@@ -23,6 +23,9 @@
  *	Handlers - a list of LastChance objects
  *	LastChance - a virtual base class that gets deleted with the
  *			handlers.
+ *
+ * LastChance::Detach() gives up the handle (as deleting the object
+ * would) for an object that lives on past its handle.
  */
 
 class LastChance;
@@ -50,6 +53,8 @@ class LastChance {
 			    handler->lastChance = this;
 			}
 
+	void		Detach();
+
 	void		SetError()
 			{
 			    isError = 1;
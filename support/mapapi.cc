@@ -2,11 +2,13 @@
 
 #include <stdhdrs.h>
 #include <strbuf.h>
+#include <strarray.h>
 #include <vararray.h>
 #include <error.h>
 #include <maptable.h>
 #include <maphalf.h>
 #include <mapitem.h>
+#include <threadpool.h>
 
 MapApi::MapApi(void)
 {
@@ -115,6 +117,103 @@ int MapApi::Translate( const StrPtr& from, StrBuf& to, MapDir d )
 		return 0;
 }
 
+//A slice of a TranslateBatch(), with its own MapTrail so that the
+//slices can run in parallel on a ThreadPool.
+
+class MapBatch : public ThreadTask
+{
+    public:
+	void Run( ThreadScratch* )
+	{
+		MapTrail trail;
+
+		for ( int i = lo; i < hi; i++ )
+		{
+			StrBuf* t = to->Edit( i );
+
+			if ( table->Translate( dir, *from->Get( i ), *t, &trail ) )
+				mapped++;
+			else
+				t->Set( "" );
+		}
+	}
+
+	MapTable*       table;
+	MapTableT       dir;
+	const StrArray* from;
+	StrArray*       to;
+	int             lo;
+	int             hi;
+	int             mapped;
+};
+
+int MapApi::TranslateBatch( const StrArray& from, StrArray& to,
+                            MapDir d, int threads )
+{
+	MapTableT dir = ( d == MapRightLeft ? RHS : LHS );
+	int n = from.Count();
+
+	Disambiguate();
+
+	//Reuse whatever buffers to already has.
+
+	while ( to.Count() > n )
+		to.Remove( to.Count() - 1 );
+	while ( to.Count() < n )
+		to.Put();
+
+	if ( !n )
+		return 0;
+
+	//Check() builds the search tree, which the slices then share
+	//read-only.  Don't bother with threads for small slices.  We run
+	//the first slice ourselves while the pool's workers run the rest;
+	//the pool's destructor sees them all run (without threads,
+	//Submit() runs each there and then).  Slices a cancelled pool
+	//dropped, we run here.
+
+	table->Check( dir, *from.Get( 0 ) );
+
+	if ( threads > n / 4096 ) threads = n / 4096;
+	if ( threads < 1 ) threads = 1;
+
+	MapBatch* b = new MapBatch[ threads ];
+
+	for ( int t = 0; t < threads; t++ )
+	{
+		b[t].table = table;
+		b[t].dir = dir;
+		b[t].from = &from;
+		b[t].to = &to;
+		b[t].lo = (int)( (P4INT64)n * t / threads );
+		b[t].hi = (int)( (P4INT64)n * ( t + 1 ) / threads );
+		b[t].mapped = 0;
+	}
+
+	if ( threads > 1 )
+	{
+		ThreadPool pool( threads - 1 );
+
+		for ( int t = 1; t < threads; t++ )
+			pool.Submit( &b[t] );
+
+		b[0].Run( 0 );
+	}
+	else
+		b[0].Run( 0 );
+
+	for ( int t = 1; t < threads; t++ )
+		if ( !b[t].Ran() )
+			b[t].Run( 0 );
+
+	int mapped = 0;
+	for ( int t = 0; t < threads; t++ )
+		mapped += b[t].mapped;
+
+	delete []b;
+	return mapped;
+}
+
 MapApi* MapApi::Join( MapApi* m1, MapDir d1, MapApi* m2, MapDir d2 )
 {
 	MapTableT t1 = RHS;
@@ -1,6 +1,7 @@
 class MapTable;
 class StrPtr;
 class StrBuf;
+class StrArray;
 
 enum MapType { MapInclude, MapExclude, MapOverlay, MapOneToMany };
 enum MapDir  { MapLeftRight, MapRightLeft };
@@ -25,6 +26,12 @@ public:
 	//Functions for doing interesting things with the mapping.
 	int Translate( const StrPtr& from, StrBuf& to, MapDir d = MapLeftRight );
 
+	//Translates each of from into the same slot of to (left empty
+	//when unmapped), returning how many mapped.  Fastest on sorted
+	//input.  With threads > 1, large batches are split across threads.
+	int TranslateBatch( const StrArray& from, StrArray& to,
+	                    MapDir d = MapLeftRight, int threads = 1 );
+
 	static MapApi* Join( MapApi* left, MapApi* right )
 		{ return Join( left, MapLeftRight, right, MapLeftRight ); }
 	static MapApi* Join( MapApi* m1, MapDir d1, MapApi* m2, MapDir d2 );
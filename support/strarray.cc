@@ -3,12 +3,21 @@
  */
 
 # include <stdhdrs.h>
+# include <charman.h>
 # include <strbuf.h>
+# include <debug.h>
+# include <tunable.h>
 # include <vararray.h>
+# include <strpool.h>
 # include <strarray.h>
+# include <threadpool.h>
 
 /*
  * strarray.cc - a 0 based array of StrBufs
+ *
+ * The StrBufs are carved out of a StrPool rather than new'd one at a
+ * time, and go back all at once on Clear(); their text is still their
+ * own.  Those Remove()d are reused by Put().
  */
 
 class StrVarArray : public VVarArray {
@@ -30,6 +39,12 @@ class StrVarArray : public VVarArray {
 
 	int caseFolding;
 
+	// The pool lives here rather than in StrArray, so as not to
+	// change StrArray's layout.
+
+	StrPool		pool;		// the StrBufs themselves
+	VarArray	spare;		// Remove()d ones, for Put()
+
 } ;
 
 StrArray::StrArray()
@@ -40,7 +55,7 @@ StrArray::StrArray()
 StrArray::~StrArray()
 {
 	for( int i = 0; i < array->Count(); i++ )
-	    delete (StrBuf *)array->Get(i);
+	    ((StrBuf *)array->Get(i))->~StrBuf();
 
 	delete array;
 }
@@ -49,8 +64,10 @@ void
 StrArray::Clear()
 {
 	for( int i = 0; i < array->Count(); i++ )
-	    delete (StrBuf *)array->Get(i);
+	    ((StrBuf *)array->Get(i))->~StrBuf();
 	array->Clear();
+	array->spare.Clear();
+	array->pool.Clear();
 }
 
 const StrBuf *
@@ -68,9 +85,12 @@ StrArray::Edit( int i )
 void
 StrArray::Remove( int i )
 {
+	// Its StrBuf's space is kept for the next Put().
+
 	if( array->Get( i ) )
 	{
-	    delete Edit( i );
+	    Edit( i )->~StrBuf();
+	    array->spare.Put( Edit( i ) );
 	    array->Remove( i );
 	}
 }
@@ -78,7 +98,19 @@ StrArray::Remove( int i )
 StrBuf *
 StrArray::Put()
 {
-	return (StrBuf *)array->Put( new StrBuf );
+	StrBuf *s;
+	int n = array->spare.Count();
+
+	if( n )
+	{
+	    s = (StrBuf *)array->spare.Get( n - 1 );
+	    array->spare.SetCount( n - 1 );
+	}
+	else
+	    s = (StrBuf *)array->pool.Alloc( sizeof( StrBuf ) );
+
+	s->StringInit();
+	return (StrBuf *)array->Put( s );
 }
 
 int
@@ -87,11 +119,213 @@ StrArray::Count() const
 	return array->Count();
 }
 
+/*
+ * StrArray::Sort() - sort, case exact (caseFolding set) or case folded
+ *
+ * Small arrays go to VVarArray's qsort.  Larger ones get an MSD radix
+ * sort on the bytes (folded with tolowerq(), as CCompare() does), up
+ * to the first null, as strcmp() sees them: each pass buckets a range
+ * on one byte, buckets of strings that have ended are done, and the
+ * rest are sorted on the next byte.  A range that all shares the next
+ * byte skips straight past the prefix its strings have in common,
+ * which for paths is usually most of them.  Small buckets finish with
+ * an insertion sort.
+ *
+ * For large arrays, with sys.sort.threads set (it's off by default:
+ * this is library code, in forking servers too), big buckets are
+ * handed to a ThreadPool of that many workers as they turn up.  Buckets are disjoint ranges of the array (and of the
+ * scratch arrays), so the tasks share nothing.
+ *
+ * The radix sort is stable, so strings that compare equal keep their
+ * order; the qsort left that undefined.
+ */
+
+const int StrSortSmall = 32;			// insertion sort below this
+const int StrSortQsort = 256;			// qsort below this
+const int StrSortParallel = 64 * 1024;		// threads from this
+const int StrSortSplit = 8 * 1024;		// bucket size for a task
+
+struct StrSortCtx {
+	StrBuf		**base;		// the array
+	StrBuf		**tmp;		// scratch, same size
+	unsigned char	*oracle;	// each string's byte this pass
+	int		fold;
+} ;
+
+static inline int
+StrSortKey( const unsigned char *s, int fold )
+{
+	return fold ? tolowerq( *s ) : *s;
+}
+
+static int
+StrSortCmp( const StrBuf *sa, const StrBuf *sb, int d, int fold )
+{
+	const unsigned char *a = (const unsigned char *)sa->Text() + d;
+	const unsigned char *b = (const unsigned char *)sb->Text() + d;
+
+	while( *a && StrSortKey( a, fold ) == StrSortKey( b, fold ) )
+	    ++a, ++b;
+
+	return StrSortKey( a, fold ) - StrSortKey( b, fold );
+}
+
+static int
+StrSortPrefix( StrBuf **a, int n, int d, int fold )
+{
+	// How far past d do all of a[] agree?
+
+	const unsigned char *f = (const unsigned char *)a[0]->Text();
+	int l = d;
+
+	while( f[l] )
+	    ++l;
+
+	for( int i = 1; i < n && l > d; i++ )
+	{
+	    const unsigned char *s = (const unsigned char *)a[i]->Text();
+	    int j = d;
+
+	    while( j < l && StrSortKey( f + j, fold ) == StrSortKey( s + j, fold ) )
+		++j;
+
+	    l = j;
+	}
+
+	return l;
+}
+
+static void StrSortRadix( StrBuf **a, int n, int d,
+			  StrSortCtx *c, ThreadGroup *g );
+
+class StrSortTask : public ThreadTask {
+
+    public:
+			StrSortTask( StrBuf **a, int n, int d,
+				     StrSortCtx *c, ThreadGroup *g )
+			: a( a ), n( n ), d( d ), c( c ), g( g ) {}
+
+	void		Run( ThreadScratch * )
+			{ StrSortRadix( a, n, d, c, g ); }
+
+    private:
+
+	StrBuf		**a;
+	int		n;
+	int		d;
+	StrSortCtx	*c;
+	ThreadGroup	*g;
+
+} ;
+
+static void
+StrSortRadix( StrBuf **a, int n, int d, StrSortCtx *c, ThreadGroup *g )
+{
+	int off = a - c->base;
+	unsigned char *o = c->oracle + off;
+
+	while( n > StrSortSmall )
+	{
+	    int count[ 256 ];
+	    memset( count, 0, sizeof( count ) );
+
+	    for( int i = 0; i < n; i++ )
+		++count[ o[i] = StrSortKey(
+			(const unsigned char *)a[i]->Text() + d, c->fold ) ];
+
+	    // All alike: if ended, they're equal; else skip the prefix
+	    // they share and try again.
+
+	    if( count[ o[0] ] == n )
+	    {
+		if( !o[0] )
+		    return;
+
+		d = StrSortPrefix( a, n, d + 1, c->fold );
+		continue;
+	    }
+
+	    // Distribute, in order, through tmp.
+
+	    int pos[ 256 ];
+	    StrBuf **t = c->tmp + off;
+
+	    pos[0] = 0;
+	    for( int b = 1; b < 256; b++ )
+		pos[b] = pos[b - 1] + count[b - 1];
+
+	    for( int i = 0; i < n; i++ )
+		t[ pos[ o[i] ]++ ] = a[i];
+
+	    memcpy( a, t, n * sizeof( *a ) );
+
+	    // Bucket 0 have ended, and are equal.
+
+	    for( int b = 1, start = count[0]; b < 256; start += count[b++] )
+	    {
+		if( count[b] < 2 )
+		    continue;
+
+		if( g && count[b] >= StrSortSplit )
+		    g->Submit( new StrSortTask( a + start, count[b], d + 1,
+						c, g ) );
+		else
+		    StrSortRadix( a + start, count[b], d + 1, c, g );
+	    }
+
+	    return;
+	}
+
+	// Insertion sort what's left; all agree before d.
+
+	for( int i = 1; i < n; i++ )
+	{
+	    StrBuf *s = a[i];
+	    int j = i;
+
+	    for( ; j > 0 && StrSortCmp( a[j - 1], s, d, c->fold ) > 0; --j )
+		a[j] = a[j - 1];
+
+	    a[j] = s;
+	}
+}
+
 void
 StrArray::Sort( int caseFolding )
 {
 	array->SetCaseFolding( caseFolding );
-	array->Sort();
+
+	int n = array->Count();
+
+	if( n < StrSortQsort )
+	{
+	    array->Sort();
+	    return;
+	}
+
+	StrSortCtx c;
+	c.base = (StrBuf **)array->ElemTab();
+	c.tmp = new StrBuf *[ n ];
+	c.oracle = new unsigned char[ n ];
+	c.fold = !caseFolding;
+
+	int threads = p4tunable.Get( P4TUNE_SYS_SORT_THREADS );
+
+	if( n >= StrSortParallel && threads > 1 )
+	{
+	    ThreadPool pool( threads );
+	    ThreadGroup group( &pool );
+
+	    StrSortRadix( c.base, n, 0, &c, &group );
+	    group.Wait();
+	}
+	else
+	{
+	    StrSortRadix( c.base, n, 0, &c, 0 );
+	}
+
+	delete []c.tmp;
+	delete []c.oracle;
 }
 
 int
@@ -176,7 +410,7 @@ StrPtrArray::Put( const StrPtr &val )
 
 	if( tabLength == tabSize )
 	{
-	    int newSize = tabSize + 10;
+	    int newSize = tabSize * 3 / 2 + 10;
 	    StrRef *newtabVal = new StrRef[ newSize ];
 
 	    // unfortunately, invokes destructors
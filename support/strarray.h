@@ -12,6 +12,11 @@
  *
  * Public methods:
  *
+ *	StrArray::Remove() - frees the string's text at once, but the
+ *		StrBuf itself (a few words) is kept for a later Put(), and
+ *		only given back by Clear() or the destructor.  So an array
+ *		holds on to as many StrBufs as it has ever held at once.
+ *
  * Private methods:
  */
 
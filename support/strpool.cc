@@ -0,0 +1,154 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * strpool.cc - arena allocation for strings that are freed together
+ */
+
+# include <stdhdrs.h>
+
+# include "strbuf.h"
+# include "strpool.h"
+
+// Blocks double up to this, and anything larger than a quarter of
+// it gets a block of its own.
+
+const int StrPoolMaxBlock = 256 * 1024;
+
+// Everything handed out is aligned to this.
+
+const int StrPoolAlign = 8;
+
+struct StrPoolBlock {
+	StrPoolBlock	*next;
+	int		size;		// usable bytes after the header
+} ;
+
+// The header, rounded up so the data after it is aligned.
+
+const int StrPoolHeader =
+	( sizeof( StrPoolBlock ) + StrPoolAlign - 1 ) & ~( StrPoolAlign - 1 );
+
+StrPool::StrPool( int firstBlock )
+{
+	blocks = 0;
+	next = end = 0;
+	blockSize = firstBlock;
+	size = 0;
+}
+
+StrPool::~StrPool()
+{
+	while( StrPoolBlock *b = blocks )
+	{
+	    blocks = b->next;
+	    delete [](char *)b;
+	}
+}
+
+/*
+ * StrPool::Alloc() - carve out memory, aligned for any scalar type
+ */
+
+void *
+StrPool::Alloc( int s )
+{
+	s = ( s + StrPoolAlign - 1 ) & ~( StrPoolAlign - 1 );
+
+	size += s;
+
+	if( s > end - next )
+	    return Grow( s );
+
+	void *p = next;
+	next += s;
+	return p;
+}
+
+/*
+ * StrPool::Grow() - add a block to satisfy Alloc()
+ *
+ * A large request gets a block to itself, behind the current one, so
+ * what's left of the current block isn't thrown away.
+ */
+
+void *
+StrPool::Grow( int s )
+{
+	if( s > StrPoolMaxBlock / 4 )
+	{
+	    StrPoolBlock *b = (StrPoolBlock *)new char[ StrPoolHeader + s ];
+	    b->size = s;
+
+	    if( blocks )
+	    {
+		b->next = blocks->next;
+		blocks->next = b;
+	    }
+	    else
+	    {
+		b->next = 0;
+		blocks = b;
+		next = end = (char *)b + StrPoolHeader + s;
+	    }
+
+	    return (char *)b + StrPoolHeader;
+	}
+
+	while( blockSize < s )
+	    blockSize *= 2;
+
+	StrPoolBlock *b = (StrPoolBlock *)new char[ StrPoolHeader + blockSize ];
+	b->size = blockSize;
+	b->next = blocks;
+	blocks = b;
+
+	next = (char *)b + StrPoolHeader;
+	end = next + blockSize;
+
+	if( blockSize < StrPoolMaxBlock )
+	    blockSize *= 2;
+
+	void *p = next;
+	next += s;
+	return p;
+}
+
+/*
+ * StrPool::Save() - copy a string in, returning a StrRef to the copy
+ */
+
+void
+StrPool::Save( const char *s, int len, StrRef &r )
+{
+	char *p = (char *)Alloc( len + 1 );
+
+	memcpy( p, s, len );
+	p[ len ] = 0;
+
+	r.Set( p, len );
+}
+
+/*
+ * StrPool::Clear() - free everything, keeping the last block for reuse
+ */
+
+void
+StrPool::Clear()
+{
+	if( !blocks )
+	    return;
+
+	while( StrPoolBlock *b = blocks->next )
+	{
+	    blocks->next = b->next;
+	    delete [](char *)b;
+	}
+
+	next = (char *)blocks + StrPoolHeader;
+	end = next + blocks->size;
+	size = 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * strpool.h - arena allocation for strings that are freed together
+ *
+ * Classes defined:
+ *
+ *	StrPool - a bump allocator, freed all at once
+ *
+ * Public methods:
+ *
+ *	StrPool::Alloc() - carve out memory, aligned for any scalar type
+ *	StrPool::Save() - copy a string in, returning a StrRef to the copy
+ *	StrPool::Clear() - free everything, keeping the last block for reuse
+ *	StrPool::Size() - bytes handed out since the last Clear()
+ *
+ * Memory comes from blocks that start small and double (up to a
+ * limit), so a pool for a handful of strings costs one small block and
+ * a pool for millions costs a few dozen large ones.  Nothing is freed
+ * individually: StrArray and StrBufDict carve their StrBufs out of a
+ * pool and free them with it.
+ *
+ * Saved strings are null terminated, like StrBuf's.
+ */
+
+struct StrPoolBlock;
+
+class StrPool {
+
+    public:
+			StrPool( int firstBlock = 256 );
+			~StrPool();
+
+	void		*Alloc( int size );
+	void		Save( const char *s, int len, StrRef &r );
+	void		Save( const StrPtr &s, StrRef &r )
+			{ Save( s.Text(), s.Length(), r ); }
+
+	void		Clear();
+	P4INT64		Size() const { return size; }
+
+    private:
+
+	void		*Grow( int size );
+
+	StrPoolBlock	*blocks;	// newest first
+	char		*next;		// next free byte in blocks
+	char		*end;		// end of blocks
+	int		blockSize;	// size of the next new block
+	P4INT64		size;
+
+} ;
@@ -14,6 +14,7 @@
 # include "strbuf.h"
 # include "strdict.h"
 # include "strtable.h"
+# include "strpool.h"
 
 
 struct StrPtrEntry {
@@ -115,18 +116,32 @@ StrPtrDict::VRemoveVar( const StrPtr &var )
 	}
 }
 
-/* StrBufDict */
+/*
+ * StrBufDict
+ *
+ * The entries are carved out of a StrPool rather than new'd one at
+ * a time; Clear() keeps them (and their StrBufs' space) for reuse.
+ * The pool rides along with the table, so as not to change
+ * StrBufDict's layout.
+ */
+
+class StrBufEntries : public VarArray {
+
+    public:
+	StrPool		pool;		// the StrBufEntrys themselves
+
+} ;
 
 StrBufDict::StrBufDict()
 {
-	elems = new VarArray;
+	elems = new StrBufEntries;
 	tabSize = 0;
 	tabLength = 0;
 }
 
 StrBufDict::StrBufDict( StrDict &dict )
 {
-	elems = new VarArray;
+	elems = new StrBufEntries;
 	tabSize = 0;
 	tabLength = 0;
 	CopyVars( dict );
@@ -144,10 +159,24 @@ StrBufDict::~StrBufDict()
 	for( int i = 0; i < tabSize; i++ )
 	{
 	    StrBufEntry *s = (StrBufEntry *)elems->Get(i);
-	    delete s;
+	    s->~StrBufEntry();
 	}
 
-	delete elems;
+	delete (StrBufEntries *)elems;
+}
+
+StrBufEntry *
+StrBufDict::NewEntry()
+{
+	StrPool &pool = ((StrBufEntries *)elems)->pool;
+	StrBufEntry *s = (StrBufEntry *)pool.Alloc( sizeof( StrBufEntry ) );
+
+	s->var.StringInit();
+	s->val.StringInit();
+
+	++tabSize;
+
+	return (StrBufEntry *)elems->Put( s );
 }
 
 StrPtr *
@@ -197,10 +226,7 @@ StrBufDict::KeepOne( const StrPtr &var )
 	// Realloc with spare room
 
 	if( tabLength == tabSize )
-	{
-	    elems->Put( new StrBufEntry );
-	    ++tabSize;
-	}
+	    NewEntry();
 
 	StrBufEntry *s = (StrBufEntry *)elems->Get( tabLength++ );
 
@@ -224,16 +250,22 @@ StrBufDict::VGetVarX( int x, StrRef &var, StrRef &val )
 	return 1;
 }
 
+StrPtr *
+StrBufDict::GetValX( int x )
+{
+	if( x >= tabLength )
+	    return 0;
+
+	return &((StrBufEntry *)elems->Get(x))->val;
+}
+
 void
 StrBufDict::VSetVar( const StrPtr &var, const StrPtr &val )
 {
 	// Realloc with spare room
 
 	if( tabLength == tabSize )
-	{
-	    elems->Put( new StrBufEntry );
-	    ++tabSize;
-	}
+	    NewEntry();
 
 	StrBufEntry *s = (StrBufEntry *)elems->Get( tabLength++ );
 
@@ -72,12 +72,22 @@ class StrBufDict : public StrDict {
 	StrPtr *	GetVarN( const StrPtr &var );
 	StrBuf *	KeepOne( const StrPtr &var );
 
+    protected:
+
+	// For subclasses that keep their own index into the table:
+	// the value of the x'th variable, where it stays until the
+	// table is cleared or the variable removed.
+
+	StrPtr *	GetValX( int x );
+
     private:
 	
 	VarArray	*elems;
 	int		tabSize;
 	int		tabLength;
 
+	StrBufEntry	*NewEntry();
+
 } ;
 
 const int BufferDictMax = 20;
@@ -91,6 +91,10 @@ enum P4TunableName {
 	P4TUNE_FILESYS_EXTENDLOWMARK,
 	P4TUNE_FILESYS_WINDOWS_LFN,		// see filesys.cc
 	P4TUNE_FILESYS_CLIENT_NULLSYNC,		// see clientservice.cc
+	P4TUNE_FILESYS_RESOLVEMEM,		// see clientmerge3.cc
+	P4TUNE_FILESYS_RESOLVE_THREADS,		// see clientmergepipe.cc
+	P4TUNE_FILESYS_RESOLVE_MAXFILES,	// see clientmergepipe.cc
+	P4TUNE_FILESYS_RESOLVE_MAXMEM,		// see clientmergepipe.cc
 	P4TUNE_INDEX_DOMAIN_OWNER,              // see dmdomains.cc
 	P4TUNE_LBR_AUTOCOMPRESS,		// see submit
 	P4TUNE_LBR_BUFSIZE,			// see lbr.h
@@ -129,6 +133,8 @@ enum P4TunableName {
 	P4TUNE_NET_TCPSIZE,			// set nettcp.cc
 	P4TUNE_NET_BACKLOG,			// see nettcp.cc
 	P4TUNE_NET_X3_MINSIZE,			// see rmtservice.cc
+	P4TUNE_NET_CONNECT_DELAY,		// see nettcpendpoint.cc
+	P4TUNE_NET_DNS_TTL,			// see nettcpendpoint.cc
 	P4TUNE_PROXY_DELIVER_FIX,
 	P4TUNE_PROXY_MONITOR_INTERVAL,		// see pxmonitor.cc
 	P4TUNE_PROXY_MONITOR_LEVEL,		// see pxmonitor.cc
@@ -195,12 +201,14 @@ enum P4TunableName {
 	P4TUNE_SYS_MEMORY_STACKSIZE,
 	P4TUNE_SYS_RENAME_MAX,			// see fileiont.cc
 	P4TUNE_SYS_RENAME_WAIT,			// see fileiont.cc
+	P4TUNE_SYS_SORT_THREADS,		// see strarray.cc
 	P4TUNE_RPL_FORWARD_ALL,
 	P4TUNE_RPL_FORWARD_LOGIN,		// see rhmain.cc
 	P4TUNE_RPL_PULL_POSITION,		// see userpull.cc
 	P4TUNE_RPL_PULL_RELOAD,			// see userpull.cc
 	P4TUNE_SSL_SECONDARY_SUITE,             // see netssltransport.cc
 	P4TUNE_SSL_CLIENT_TIMEOUT,		// see netssltransport.cc
+	P4TUNE_SSL_CLIENT_SESSIONS,		// see netssltransport.cc
 	P4TUNE_TRIGGERS_IO,			// see rhtrigger.cc
 	P4TUNE_ISTAT_MIMIC_ICHANGES,		// see dmistat.cc & DIOR_SPLIT
 
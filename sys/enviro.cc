@@ -83,6 +83,7 @@ const static char *const envVars[] = {
 	"P4LOGINSSO",
 	"P4MERGE",
 	"P4MERGEUNICODE",
+	"P4MUX",
 	"P4NAME",
 	"P4PAGER",
 	p4passwd,
@@ -91,6 +92,8 @@ const static char *const envVars[] = {
 	"P4POPTIONS",
 	"P4PORT",
 	"P4ROOT",
+	"P4RPCRECORD",
+	"P4RPCSTATS",
 	"P4SSLDIR",
 	"P4TARGET",
 	"P4TICKETS",
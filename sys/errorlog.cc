@@ -10,6 +10,8 @@
 # define NEED_FLOCK
 # define NEED_DBGBREAK
 # define NEED_CRITSEC
+# define NEED_GETPID
+# define NEED_THREADS
 
 # include <stdhdrs.h>
 # include <strbuf.h>
@@ -26,6 +28,313 @@
 Error AssertError;
 ErrorLog AssertLog;
 
+/*
+ * ErrorLogBuffer - a ring of log text drained by a writer thread
+ *
+ * After EnableBuffer(), LogWrite() just copies the text into the ring
+ * and goes on its way.  A background thread writes out whatever has
+ * piled up in one go, keeping the log file open between writes rather
+ * than opening and closing it for every message.
+ *
+ * Writers hold the lock only to copy text in; the writer thread lets
+ * go of it while it writes, and the space it is writing from isn't
+ * handed back until it's done.  A change of log file or rotation
+ * waits for the ring to empty and closes the file, so the next write
+ * opens the file by name afresh.
+ *
+ * The writer thread doesn't survive fork(), so a child (with its own
+ * pid) writes synchronously and leaves the ring to its parent.
+ */
+
+# ifdef HAVE_PTHREAD
+
+class ErrorLogBuffer {
+
+    public:
+			ErrorLogBuffer( ErrorLog *log, int size );
+			~ErrorLogBuffer();
+
+	int		Start();
+	int		Mine() { return pid == getpid(); }
+
+	int		Put( const StrPtr &s, FileSys *fsys, int logType );
+	void		Flush();
+	void		Close();
+
+	void		Drain();
+
+    private:
+
+	void		Idle();
+	void		Shut();
+	void		Write( const char *p, int l );
+
+	ErrorLog	*log;
+	int		pid;
+
+	pthread_t	thread;
+	pthread_mutex_t	lock;
+	pthread_cond_t	more;		// writer thread: text to write
+	pthread_cond_t	room;		// LogWrite(): text written
+	int		stop;
+
+	char		*ring;
+	int		size;
+	int		head;		// first byte to write
+	int		used;		// bytes waiting to be written
+	int		busy;		// writer thread writing
+
+	// what we write to
+
+	int		targetType;	// ErrorLog's logType
+	StrBuf		targetName;	// ErrorLog's errorFsys's
+	FileSys		*file;		// our own, kept open
+
+} ;
+
+static void *
+ErrorLogDrain( void *buffer )
+{
+	( (ErrorLogBuffer *)buffer )->Drain();
+	return 0;
+}
+
+ErrorLogBuffer::ErrorLogBuffer( ErrorLog *log, int size )
+{
+	this->log = log;
+	this->size = size;
+	pid = getpid();
+	stop = 0;
+	ring = new char[ size ];
+	head = used = busy = 0;
+	targetType = ErrorLog::type_none;
+	file = 0;
+
+	pthread_mutex_init( &lock, 0 );
+	pthread_cond_init( &more, 0 );
+	pthread_cond_init( &room, 0 );
+}
+
+ErrorLogBuffer::~ErrorLogBuffer()
+{
+	// A forked child has no writer thread to stop, nor business
+	// writing its parent's leftovers.
+
+	if( !Mine() )
+	    return;
+
+	pthread_mutex_lock( &lock );
+	stop = 1;
+	pthread_cond_signal( &more );
+	pthread_mutex_unlock( &lock );
+
+	pthread_join( thread, 0 );
+
+	Shut();
+
+	pthread_cond_destroy( &room );
+	pthread_cond_destroy( &more );
+	pthread_mutex_destroy( &lock );
+
+	delete []ring;
+}
+
+int
+ErrorLogBuffer::Start()
+{
+	return !pthread_create( &thread, 0, ErrorLogDrain, this );
+}
+
+/*
+ * ErrorLogBuffer::Put() - copy text into the ring for the writer thread
+ *
+ * Returns 0 if the caller should write the text itself: in a forked
+ * child, or if the text won't fit in the ring.
+ */
+
+int
+ErrorLogBuffer::Put( const StrPtr &s, FileSys *fsys, int logType )
+{
+	int l = s.Length();
+
+	if( !Mine() || l > size )
+	    return 0;
+
+	pthread_mutex_lock( &lock );
+
+	// New log file or type?  Finish with the old first.
+
+	const char *name = fsys ? fsys->Name() : "";
+
+	if( logType != targetType || strcmp( name, targetName.Text() ) )
+	{
+	    Idle();
+	    Shut();
+
+	    targetType = logType;
+	    targetName.Set( name );
+	}
+
+	while( size - used < l )
+	    pthread_cond_wait( &room, &lock );
+
+	int tail = ( head + used ) % size;
+	int l1 = tail + l > size ? size - tail : l;
+
+	memcpy( ring + tail, s.Text(), l1 );
+	memcpy( ring, s.Text() + l1, l - l1 );
+	used += l;
+
+	pthread_cond_signal( &more );
+	pthread_mutex_unlock( &lock );
+
+	return 1;
+}
+
+/*
+ * ErrorLogBuffer::Idle() - wait, locked, for the writer thread to finish
+ * ErrorLogBuffer::Shut() - close the log file, locked and idle
+ */
+
+void
+ErrorLogBuffer::Idle()
+{
+	while( used || busy )
+	    pthread_cond_wait( &room, &lock );
+}
+
+void
+ErrorLogBuffer::Shut()
+{
+	if( file )
+	{
+	    Error e;
+	    file->Close( &e );
+	    delete file;
+	    file = 0;
+	}
+}
+
+void
+ErrorLogBuffer::Flush()
+{
+	if( !Mine() )
+	    return;
+
+	pthread_mutex_lock( &lock );
+	Idle();
+	pthread_mutex_unlock( &lock );
+}
+
+/*
+ * ErrorLogBuffer::Close() - flush and close the log file
+ *
+ * The next write opens it again by name, so it ends up in a new file
+ * if the old one has been renamed.
+ */
+
+void
+ErrorLogBuffer::Close()
+{
+	if( !Mine() )
+	    return;
+
+	pthread_mutex_lock( &lock );
+	Idle();
+	Shut();
+	pthread_mutex_unlock( &lock );
+}
+
+/*
+ * ErrorLogBuffer::Drain() - the writer thread's loop
+ */
+
+void
+ErrorLogBuffer::Drain()
+{
+	pthread_mutex_lock( &lock );
+
+	for( ;; )
+	{
+	    while( !used && !stop )
+		pthread_cond_wait( &more, &lock );
+
+	    if( !used )
+		break;
+
+	    int at = head;
+	    int l = used;
+	    int l1 = at + l > size ? size - at : l;
+
+	    busy = 1;
+	    pthread_mutex_unlock( &lock );
+
+	    Write( ring + at, l1 );
+
+	    if( l1 < l )
+		Write( ring, l - l1 );
+
+	    pthread_mutex_lock( &lock );
+	    head = ( at + l ) % size;
+	    used -= l;
+	    busy = 0;
+	    pthread_cond_broadcast( &room );
+	}
+
+	pthread_mutex_unlock( &lock );
+}
+
+/*
+ * ErrorLogBuffer::Write() - write text out, as LogWrite() would
+ */
+
+void
+ErrorLogBuffer::Write( const char *p, int l )
+{
+	if( targetType == ErrorLog::type_none )
+	{
+	    Error e;
+
+	    if( !file )
+	    {
+		file = FileSys::Create( FST_ATEXT );
+		file->Set( targetName );
+		file->Perms( FPM_RW );
+		file->Open( FOM_WRITE, &e );
+	    }
+
+	    if( !e.Test() )
+		file->Write( p, l, &e );
+
+	    if( e.Test() )
+	    {
+		StrBuf s;
+		s.Set( p, l );
+		log->WriteFailed( s, &e );
+
+		// Try again with the next write
+
+		delete file;
+		file = 0;
+	    }
+	}
+	else
+	{
+	    FILE *flog = targetType == ErrorLog::type_stdout 
+				? stdout : stderr;
+
+	    int fd = fileno( flog );
+	    lockFile( fd, LOCKF_EX );
+
+	    fwrite( p, 1, l, flog );
+	    fflush( flog );
+
+	    lockFile( fd, LOCKF_UN );
+	}
+}
+
+# endif /* HAVE_PTHREAD */
+
 ErrorLog::ErrorLog( ErrorLog *from )
 	: hook(NULL), context(NULL)
 {
@@ -44,11 +353,19 @@ ErrorLog::ErrorLog( ErrorLog *from )
 
 	// We will not inherit the critical section.  We also do not create
 	// a new one, as only AssertLog will be using a critical section.
+	// Likewise the write buffer.
+
 	vp_critsec = 0;
+	buffer = 0;
 }
 
 ErrorLog::~ErrorLog()
 {
+# ifdef HAVE_PTHREAD
+	delete buffer;
+	buffer = 0;
+# endif
+
 	delete errorFsys;
 	errorFsys = 0;
 
@@ -156,6 +473,7 @@ ErrorLog::init()
 	errorTag = "Error";
 	errorFsys = 0;
 	vp_critsec = 0;
+	buffer = 0;
 }
 
 void
@@ -173,6 +491,45 @@ ErrorLog::EnableCritSec()
 # endif
 }
 
+/*
+ * ErrorLog::EnableBuffer() - hand writes to a background writer thread
+ *
+ * For heavy logging: LogWrite() copies the text into a ring of 'size'
+ * bytes (default 1MB) and a writer thread does the actual writing,
+ * keeping the log file open.  Syslog output is not buffered.  Rename()
+ * and Abort() flush the ring first.  A no-op without threads.
+ */
+
+void
+ErrorLog::EnableBuffer( int size )
+{
+# ifdef HAVE_PTHREAD
+	if( buffer )
+	    return;
+
+	buffer = new ErrorLogBuffer( this, size > 0 ? size : 1024 * 1024 );
+
+	if( !buffer->Start() )
+	{
+	    delete buffer;
+	    buffer = 0;
+	}
+# endif
+}
+
+/*
+ * ErrorLog::Flush() - wait for the background writer to catch up
+ */
+
+void
+ErrorLog::Flush()
+{
+# ifdef HAVE_PTHREAD
+	if( buffer )
+	    buffer->Flush();
+# endif
+}
+
 void
 ErrorLog::Report( const Error *e, int reportFlags )
 {
@@ -229,6 +586,19 @@ ErrorLog::LogWrite( const StrPtr &s )
 	}
 # endif
 
+# ifdef HAVE_PTHREAD
+	if( buffer && ( errorFsys || 
+	    logType == type_stdout || logType == type_stderr ) )
+	{
+	    if( buffer->Put( s, errorFsys, errorFsys ? type_none : logType ) )
+		return;
+
+	    // Too big for the ring: write it ourselves, in turn.
+
+	    buffer->Flush();
+	}
+# endif
+
 	if( errorFsys )
 	{
 	    Error tmpe;
@@ -250,35 +620,7 @@ ErrorLog::LogWrite( const StrPtr &s )
 		errorFsys->Close( &tmpe );
 	    }
 	    if( tmpe.Test() )
-	    {
-		// An error was encountered when
-		// attempting to write to the log.
-
-# if defined( HAVE_SYSLOG ) || defined( HAVE_EVENT_LOG )
-
-		// Write to syslog or the event log the original
-		// message that was to be written to the log.
-		SysLog( NULL, 0, NULL, s.Text() );
-
-		// Write to syslog or the event log the error that was
-		// encountered when attempting to write to the log.
-		StrBuf buf;
-		tmpe.Fmt( &buf );
-		SysLog( &tmpe, 1, NULL, buf.Text() );
-
-# endif
-
-# ifndef OS_NT
-
-		// Write to stderr the error that was encountered when
-		// attempting to write to the log. stderr should be
-		// well-defined on platforms other than Windows.
-		ErrorLog tmpeel;
-		tmpeel.SetTag( errorTag );
-		tmpeel.Report( &tmpe );
-
-# endif
-	    }
+		WriteFailed( s, &tmpe );
 
 # ifdef HAVE_CRITSEC
 	    if( vp_critsec )
@@ -325,6 +667,39 @@ ErrorLog::LogWrite( const StrPtr &s )
 	}
 }
 
+/*
+ * ErrorLog::WriteFailed() - report an error writing to the log
+ */
+
+void
+ErrorLog::WriteFailed( const StrPtr &s, Error *tmpe )
+{
+# if defined( HAVE_SYSLOG ) || defined( HAVE_EVENT_LOG )
+
+	// Write to syslog or the event log the original
+	// message that was to be written to the log.
+	SysLog( NULL, 0, NULL, s.Text() );
+
+	// Write to syslog or the event log the error that was
+	// encountered when attempting to write to the log.
+	StrBuf buf;
+	tmpe->Fmt( &buf );
+	SysLog( tmpe, 1, NULL, buf.Text() );
+
+# endif
+
+# ifndef OS_NT
+
+	// Write to stderr the error that was encountered when
+	// attempting to write to the log. stderr should be
+	// well-defined on platforms other than Windows.
+	ErrorLog tmpeel;
+	tmpeel.SetTag( errorTag );
+	tmpeel.Report( tmpe );
+
+# endif
+}
+
 /*
  * Error::Abort() - blurt out an error and exit
  */
@@ -336,6 +711,7 @@ ErrorLog::Abort( const Error *e )
 	    return;
 
 	Report( e );
+	Flush();
 
 # ifdef HAVE_DBGBREAK
 	if( IsDebuggerPresent() )
@@ -409,6 +785,14 @@ ErrorLog::Rename( const char *file, Error *e )
 	FileSys *fs = FileSys::Create( FST_ATEXT );
 	fs->Set( file );
 
+	// Write out what's buffered and let go of the file, so that
+	// later writes go to a new one.
+
+# ifdef HAVE_PTHREAD
+	if( buffer )
+	    buffer->Close();
+# endif
+
 	errorFsys->Rename( fs, e );
 
 	delete fs;
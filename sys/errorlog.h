@@ -20,9 +20,13 @@
  *
  *	ErrorLog::SetSyslog() - redirect error messages to syslog on UNIX.
  *	ErrorLog::UnsetSyslog() - Cancel syslog redirection. Revert to log file.
+ *
+ *	ErrorLog::EnableBuffer() - hand writes to a background writer thread
+ *	ErrorLog::Flush() - wait for the background writer to catch up
  */
 
 class FileSys;
+class ErrorLogBuffer;
 
 typedef void (*StructuredLogHook)( void *context, const Error *e );
 
@@ -77,6 +81,8 @@ class ErrorLog {
 	void		UnsetLogType() { logType = type_none; }
 	void		SetTag( const char *tag ) { errorTag = tag; }
 	void		EnableCritSec();
+	void		EnableBuffer( int size = 0 );
+	void		Flush();
 
 	void		Rename( const char *file, Error *e );
 
@@ -86,6 +92,9 @@ class ErrorLog {
     private:
 	void		init();
 
+	friend class ErrorLogBuffer;
+	void		WriteFailed( const StrPtr &s, Error *e );
+
 	const 		char *errorTag;
 	int		logType;
 	FileSys		*errorFsys;
@@ -94,6 +103,8 @@ class ErrorLog {
 	void		*context;
 
 	void		*vp_critsec;
+
+	ErrorLogBuffer	*buffer;
 } ;
 
 /*
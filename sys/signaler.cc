@@ -9,6 +9,7 @@
  */
 
 # define NEED_SIGNAL
+# define NEED_THREADS
 
 # ifdef OS_NT
 # define WIN32_LEAN_AND_MEAN
@@ -35,6 +36,13 @@
 
 Signaler signaler;
 
+// Temp files come and go on worker threads too (see threadpool.h).
+// There's only the one Signaler, so its lock can be static.
+
+# ifdef HAVE_PTHREAD
+static pthread_mutex_t signalLock = PTHREAD_MUTEX_INITIALIZER;
+# endif
+
 // These two babies have C linkage for signal().
 
 extern "C" {
@@ -123,6 +131,9 @@ Signaler::OnIntr( SignalFunc callback, void *ptr )
 # ifdef OS_NT
 	WaitForSingleObject( hmutex, INFINITE );
 # endif // OS_NT
+# ifdef HAVE_PTHREAD
+	pthread_mutex_lock( &signalLock );
+# endif
 
 	SignalMan *d = new SignalMan;
 
@@ -134,6 +145,9 @@ Signaler::OnIntr( SignalFunc callback, void *ptr )
 # ifdef OS_NT
 	ReleaseMutex( hmutex );
 # endif // OS_NT
+# ifdef HAVE_PTHREAD
+	pthread_mutex_unlock( &signalLock );
+# endif
 
 }
 
@@ -146,6 +160,9 @@ Signaler::DeleteOnIntr( void *ptr )
 # ifdef OS_NT
 	WaitForSingleObject( hmutex, INFINITE );
 # endif // OS_NT
+# ifdef HAVE_PTHREAD
+	pthread_mutex_lock( &signalLock );
+# endif
 
 	SignalMan *p = 0;
 	SignalMan *d = list;
@@ -160,6 +177,9 @@ Signaler::DeleteOnIntr( void *ptr )
 # ifdef OS_NT
 		ReleaseMutex( hmutex );
 # endif // OS_NT
+# ifdef HAVE_PTHREAD
+		pthread_mutex_unlock( &signalLock );
+# endif
 		return;
 	    }
 	}
@@ -167,6 +187,9 @@ Signaler::DeleteOnIntr( void *ptr )
 # ifdef OS_NT
 	ReleaseMutex( hmutex );
 # endif // OS_NT
+# ifdef HAVE_PTHREAD
+	pthread_mutex_unlock( &signalLock );
+# endif
 
 }
 
@@ -176,7 +199,7 @@ Signaler::Intr()
 	if( disable )
 	    return;
 
-	SignalMan *d = list;
+	SignalMan *d;
 
 	// Reset for sanity.
 
@@ -186,14 +209,32 @@ Signaler::Intr()
 	WaitForSingleObject( hmutex, INFINITE );
 # endif // OS_NT
 
+	// Take the whole list, so callbacks that DeleteOnIntr() their
+	// own entry neither wait on the lock nor free what we walk.
+	// We may have interrupted the very thread holding the lock, so
+	// don't wait for it: we're on our way out anyway.
+
+# ifdef HAVE_PTHREAD
+	int locked = !pthread_mutex_trylock( &signalLock );
+# endif
+
+	d = list;
+	list = 0;
+
+# ifdef HAVE_PTHREAD
+	if( locked )
+	    pthread_mutex_unlock( &signalLock );
+# endif
+
 	while( d )
 	{
-	    // The callback may delete d
-	    // so we save it's next pointer now.
+	    // Off the list, DeleteOnIntr() can't find d: it's ours
+	    // to free once its callback is done.
 
 	    SignalMan *p = d;
 	    d = d->next;
 	    p->callback( p->ptr );
+	    delete p;
 	}
 
 # ifdef OS_NT
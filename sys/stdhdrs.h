@@ -622,10 +622,12 @@ int truncate(const char *path, off_t length);
 
 /*
  * MT_STATIC - static multithreaded data
+ * HAVE_MT_STATIC - MT_STATIC data really is per thread
  */
 
 # ifdef OS_NT
 #   define MT_STATIC static __declspec(thread)
+#   define HAVE_MT_STATIC
 # elif !defined( OS_BEOS ) && \
        !defined( OS_AS400 ) && \
        !defined( OS_VMS )
@@ -638,6 +640,7 @@ int truncate(const char *path, off_t length);
 #     define MT_STATIC static
 #   else
 #     define MT_STATIC static __thread
+#     define HAVE_MT_STATIC
 #   endif
 # else
 #   define MT_STATIC static
@@ -0,0 +1,780 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * threadpool.cc - a pool of worker threads that run tasks
+ *
+ * Internal classes:
+ *
+ *	ThreadDeque - a worker's queue: it works the back, thieves the front
+ *	ThreadPoolSync - the pool's threads, queues, lock and conditions
+ *
+ * Locking: each queue has its own lock, so workers pushing and popping
+ * their own queues don't contend.  The pool's lock guards the counts
+ * (queued tasks, idle workers, waiters) and task and group completion,
+ * and goes with the conditions workers and waiters sleep on.  A queue
+ * lock is never taken while holding the pool's lock.
+ */
+
+# define NEED_THREADS
+# define NEED_SLEEP
+
+# include <stdhdrs.h>
+
+# ifdef OS_NT
+# define WIN32_LEAN_AND_MEAN
+# include <windows.h>
+# endif
+
+# include <threading.h>
+# include <threadpool.h>
+
+enum { TASK_NEW, TASK_QUEUED, TASK_RUNNING, TASK_DONE };
+
+/*
+ * ThreadScratch - a worker's scratch memory, emptied after each task
+ */
+
+struct ThreadScratchBlock {
+	ThreadScratchBlock *next;
+	int		size;
+	int		used;
+} ;
+
+const int ScratchBlockSize = 64 * 1024;
+
+ThreadScratch::ThreadScratch()
+{
+	blocks = 0;
+}
+
+ThreadScratch::~ThreadScratch()
+{
+	while( blocks )
+	{
+	    ThreadScratchBlock *b = blocks;
+	    blocks = b->next;
+	    free( b );
+	}
+}
+
+void *
+ThreadScratch::Alloc( int size )
+{
+	size = ( size + 15 ) & ~15;
+
+	const int header = ( sizeof( ThreadScratchBlock ) + 15 ) & ~15;
+
+	if( !blocks || blocks->size - blocks->used < size )
+	{
+	    int l = size > ScratchBlockSize ? size : ScratchBlockSize;
+	    ThreadScratchBlock *b = (ThreadScratchBlock *)malloc( header + l );
+	    b->next = blocks;
+	    b->size = l;
+	    b->used = 0;
+	    blocks = b;
+	}
+
+	char *p = (char *)blocks + header + blocks->used;
+	blocks->used += size;
+	return p;
+}
+
+/*
+ * ThreadScratch::Reset() - toss all but the first block
+ */
+
+void
+ThreadScratch::Reset()
+{
+	while( blocks && blocks->next )
+	{
+	    ThreadScratchBlock *b = blocks;
+	    blocks = b->next;
+	    free( b );
+	}
+
+	if( blocks )
+	    blocks->used = 0;
+}
+
+# ifdef HAVE_PTHREAD
+
+/*
+ * ThreadDeque - a worker's queue: it works the back, thieves the front
+ */
+
+struct ThreadDeque {
+
+			ThreadDeque()
+			{
+			    pthread_mutex_init( &lock, 0 );
+			    tasks = 0;
+			    size = first = count = 0;
+			}
+
+			~ThreadDeque()
+			{
+			    pthread_mutex_destroy( &lock );
+			    delete []tasks;
+			}
+
+	void		Push( ThreadTask *t );
+	ThreadTask	*PopBack();
+	ThreadTask	*PopFront();
+
+	pthread_mutex_t	lock;
+	ThreadTask	**tasks;
+	int		size;
+	int		first;
+	int		count;
+
+} ;
+
+void
+ThreadDeque::Push( ThreadTask *t )
+{
+	pthread_mutex_lock( &lock );
+
+	if( count == size )
+	{
+	    int nsize = size ? size * 2 : 64;
+	    ThreadTask **n = new ThreadTask *[ nsize ];
+
+	    for( int i = 0; i < count; i++ )
+		n[i] = tasks[ ( first + i ) % size ];
+
+	    delete []tasks;
+	    tasks = n;
+	    size = nsize;
+	    first = 0;
+	}
+
+	tasks[ ( first + count++ ) % size ] = t;
+
+	pthread_mutex_unlock( &lock );
+}
+
+ThreadTask *
+ThreadDeque::PopBack()
+{
+	ThreadTask *t = 0;
+
+	pthread_mutex_lock( &lock );
+
+	if( count )
+	    t = tasks[ ( first + --count ) % size ];
+
+	pthread_mutex_unlock( &lock );
+
+	return t;
+}
+
+ThreadTask *
+ThreadDeque::PopFront()
+{
+	ThreadTask *t = 0;
+
+	pthread_mutex_lock( &lock );
+
+	if( count )
+	{
+	    t = tasks[ first ];
+	    first = ( first + 1 ) % size;
+	    --count;
+	}
+
+	pthread_mutex_unlock( &lock );
+
+	return t;
+}
+
+/*
+ * ThreadPoolSync - the pool's threads, queues, lock and conditions
+ *
+ * Queue nWorkers is the shared one, for tasks submitted from outside
+ * the pool.  Likewise scratch nWorkers is for tasks run outside it.
+ */
+
+struct ThreadWorkerId {
+	ThreadPool	*pool;
+	int		index;
+} ;
+
+static pthread_key_t workerKey;
+static pthread_once_t workerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void
+ThreadWorkerKey()
+{
+	pthread_key_create( &workerKey, 0 );
+}
+
+struct ThreadPoolSync {
+
+	void		Lock() { pthread_mutex_lock( &lock ); }
+	void		Unlock() { pthread_mutex_unlock( &lock ); }
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	work;		// workers: tasks queued
+	pthread_cond_t	done;		// waiters: a task finished
+	pthread_cond_t	room;		// submitters: a task dequeued
+
+	int		queued;		// in all the queues
+	int		idle;		// workers waiting on 'work'
+	int		waiters;	// waiting on 'done'
+	int		roomWaiters;	// waiting on 'room'
+	int		stop;
+
+	ThreadDeque	*deques;
+	ThreadScratch	*scratch;
+	int		*depth;		// worker's nested Execute()s
+	ThreadWorkerId	*ids;
+	pthread_t	*threads;
+	int		*started;
+
+} ;
+
+void *
+ThreadPool::Start( void *v )
+{
+	ThreadWorkerId *id = (ThreadWorkerId *)v;
+
+	pthread_setspecific( workerKey, id );
+	id->pool->Work( id->index );
+
+	return 0;
+}
+
+# else
+
+struct ThreadPoolSync {
+
+	void		Lock() {}
+	void		Unlock() {}
+
+	ThreadScratch	scratch[1];
+	int		depth[1];
+
+} ;
+
+# endif /* HAVE_PTHREAD */
+
+/*
+ * ThreadPool::ThreadPool() - start workers, one per core by default
+ *
+ * 'maxQueued' bounds the tasks waiting to run; 0 is unbounded.
+ */
+
+ThreadPool::ThreadPool( int workers, int maxQueued )
+{
+	this->maxQueued = maxQueued;
+	cancelled = 0;
+	nWorkers = 0;
+	sync = new ThreadPoolSync;
+
+# ifdef HAVE_PTHREAD
+	if( workers <= 0 )
+	    workers = Cores();
+
+	pthread_once( &workerKeyOnce, ThreadWorkerKey );
+
+	pthread_mutex_init( &sync->lock, 0 );
+	pthread_cond_init( &sync->work, 0 );
+	pthread_cond_init( &sync->done, 0 );
+	pthread_cond_init( &sync->room, 0 );
+
+	sync->queued = sync->idle = sync->waiters = sync->roomWaiters = 0;
+	sync->stop = 0;
+
+	sync->deques = new ThreadDeque[ workers + 1 ];
+	sync->scratch = new ThreadScratch[ workers + 1 ];
+	sync->depth = new int[ workers + 1 ];
+	sync->ids = new ThreadWorkerId[ workers ];
+	sync->threads = new pthread_t[ workers ];
+	sync->started = new int[ workers ];
+
+	for( int i = 0; i <= workers; i++ )
+	    sync->depth[i] = 0;
+
+	// Workers look at nWorkers, so set it before starting them.
+
+	nWorkers = workers;
+
+	for( int i = 0; i < workers; i++ )
+	{
+	    sync->ids[i].pool = this;
+	    sync->ids[i].index = i;
+	    sync->started[i] = !pthread_create( &sync->threads[i], 0,
+					Start, &sync->ids[i] );
+	}
+# else
+	sync->depth[0] = 0;
+# endif
+}
+
+/*
+ * ThreadPool::~ThreadPool() - run what's queued, then stop the workers
+ */
+
+ThreadPool::~ThreadPool()
+{
+# ifdef HAVE_PTHREAD
+	sync->Lock();
+	sync->stop = 1;
+	pthread_cond_broadcast( &sync->work );
+	sync->Unlock();
+
+	for( int i = 0; i < nWorkers; i++ )
+	    if( sync->started[i] )
+		pthread_join( sync->threads[i], 0 );
+
+	// If no worker could be started, run the leftovers here.
+
+	ThreadTask *t;
+
+	while( ( t = Take( nWorkers ) ) )
+	    Execute( t, nWorkers );
+
+	pthread_cond_destroy( &sync->room );
+	pthread_cond_destroy( &sync->done );
+	pthread_cond_destroy( &sync->work );
+	pthread_mutex_destroy( &sync->lock );
+
+	delete []sync->deques;
+	delete []sync->scratch;
+	delete []sync->depth;
+	delete []sync->ids;
+	delete []sync->threads;
+	delete []sync->started;
+# endif
+
+	delete sync;
+}
+
+/*
+ * ThreadPool::Cores() - how many processors are online
+ */
+
+int
+ThreadPool::Cores()
+{
+	int n = 1;
+
+# if defined( OS_NT )
+	SYSTEM_INFO si;
+	GetSystemInfo( &si );
+	n = si.dwNumberOfProcessors;
+# elif defined( _SC_NPROCESSORS_ONLN )
+	n = sysconf( _SC_NPROCESSORS_ONLN );
+# endif
+
+	return n > 0 ? n : 1;
+}
+
+/*
+ * ThreadPool::Worker() - which of our workers is calling, or nWorkers
+ */
+
+int
+ThreadPool::Worker()
+{
+# ifdef HAVE_PTHREAD
+	ThreadWorkerId *id = (ThreadWorkerId *)pthread_getspecific( workerKey );
+
+	if( id && id->pool == this )
+	    return id->index;
+# endif
+
+	return nWorkers;
+}
+
+void
+ThreadPool::Submit( ThreadTask *t )
+{
+	Queue( t, 0 );
+}
+
+/*
+ * ThreadPool::Queue() - queue a task to run, perhaps for a group
+ */
+
+void
+ThreadPool::Queue( ThreadTask *t, ThreadGroup *g )
+{
+	int w = Worker();
+
+	t->pool = this;
+	t->group = g;
+	t->ran = 0;
+	t->state = TASK_QUEUED;
+
+	sync->Lock();
+
+	if( g )
+	{
+	    ++g->pending;
+	    t->groupNext = g->tasks;
+	    g->tasks = t;
+	}
+
+	if( Cancelled() )
+	{
+	    sync->Unlock();
+	    Finish( t, 0 );
+	    return;
+	}
+
+# ifdef HAVE_PTHREAD
+	// Full?  Workers run it themselves rather than wait on
+	// each other; others wait for room.
+
+	int runHere = !nWorkers;
+
+	while( !runHere && maxQueued && sync->queued >= maxQueued )
+	{
+	    if( w < nWorkers )
+	    {
+		runHere = 1;
+		break;
+	    }
+
+	    ++sync->roomWaiters;
+	    pthread_cond_wait( &sync->room, &sync->lock );
+	    --sync->roomWaiters;
+	}
+
+	if( !runHere )
+	{
+	    ++sync->queued;
+
+	    if( sync->idle )
+		pthread_cond_signal( &sync->work );
+
+	    sync->Unlock();
+	    sync->deques[ w ].Push( t );
+	    return;
+	}
+# endif
+
+	sync->Unlock();
+	Execute( t, w );
+}
+
+/*
+ * ThreadPool::Take() - find a task for worker 'w' to run
+ *
+ * Our own queue's newest first, then the shared queue's oldest, then
+ * the oldest of the other workers'.
+ */
+
+ThreadTask *
+ThreadPool::Take( int w )
+{
+	ThreadTask *t = 0;
+
+# ifdef HAVE_PTHREAD
+	if( w < nWorkers )
+	    t = sync->deques[ w ].PopBack();
+
+	for( int i = 0; !t && i <= nWorkers; i++ )
+	{
+	    int v = ( nWorkers + i ) % ( nWorkers + 1 );
+
+	    if( v != w || w == nWorkers )
+		t = sync->deques[ v ].PopFront();
+	}
+
+	if( t )
+	{
+	    sync->Lock();
+
+	    --sync->queued;
+
+	    if( sync->roomWaiters )
+		pthread_cond_signal( &sync->room );
+
+	    sync->Unlock();
+	}
+# endif
+
+	return t;
+}
+
+/*
+ * ThreadPool::Work() - a worker's loop
+ */
+
+void
+ThreadPool::Work( int w )
+{
+# ifdef HAVE_PTHREAD
+	for( ;; )
+	{
+	    ThreadTask *t = Take( w );
+
+	    if( t )
+	    {
+		Execute( t, w );
+		continue;
+	    }
+
+	    sync->Lock();
+
+	    while( sync->queued <= 0 && !sync->stop )
+	    {
+		++sync->idle;
+		pthread_cond_wait( &sync->work, &sync->lock );
+		--sync->idle;
+	    }
+
+	    int stop = sync->queued <= 0 && sync->stop;
+
+	    sync->Unlock();
+
+	    if( stop )
+		break;
+	}
+# endif
+}
+
+/*
+ * ThreadPool::Execute() - run a task on worker 'w'
+ *
+ * A task run while the worker waits inside another gets its own
+ * scratch, so as not to pull the other's out from under it.
+ */
+
+void
+ThreadPool::Execute( ThreadTask *t, int w )
+{
+	if( Cancelled() )
+	{
+	    Finish( t, 0 );
+	    return;
+	}
+
+	t->state = TASK_RUNNING;
+
+	if( sync->depth[ w ]++ )
+	{
+	    ThreadScratch scratch;
+	    t->Run( &scratch );
+	}
+	else
+	{
+	    t->Run( &sync->scratch[ w ] );
+	    sync->scratch[ w ].Reset();
+	}
+
+	--sync->depth[ w ];
+
+	Finish( t, 1 );
+}
+
+/*
+ * ThreadPool::Finish() - mark a task done, and tell any waiters
+ *
+ * Once it's marked done, its waiter may delete it, so hands off.
+ */
+
+void
+ThreadPool::Finish( ThreadTask *t, int ran )
+{
+	sync->Lock();
+
+	t->ran = ran;
+	t->state = TASK_DONE;
+
+	if( t->group )
+	    --t->group->pending;
+
+# ifdef HAVE_PTHREAD
+	if( sync->waiters )
+	    pthread_cond_broadcast( &sync->done );
+# endif
+
+	sync->Unlock();
+}
+
+/*
+ * ThreadPool::WaitFor() - wait for a task or a group's tasks to finish
+ *
+ * A worker runs queued tasks while it waits, as the task it is waiting
+ * on may well be one of them.
+ */
+
+void
+ThreadPool::WaitFor( ThreadTask *t, ThreadGroup *g )
+{
+# ifdef HAVE_PTHREAD
+	int w = Worker();
+
+	for( ;; )
+	{
+	    sync->Lock();
+
+	    if( t ? t->state == TASK_DONE : !g->pending )
+	    {
+		sync->Unlock();
+		return;
+	    }
+
+	    if( w < nWorkers )
+	    {
+		sync->Unlock();
+
+		ThreadTask *o = Take( w );
+
+		if( o )
+		{
+		    Execute( o, w );
+		    continue;
+		}
+
+		sync->Lock();
+
+		// Nothing to do, but let new tasks wake us too.
+
+		if( t ? t->state == TASK_DONE : !g->pending )
+		{
+		    sync->Unlock();
+		    return;
+		}
+
+		if( sync->queued > 0 )
+		{
+		    sync->Unlock();
+		    continue;
+		}
+	    }
+
+	    ++sync->waiters;
+	    pthread_cond_wait( &sync->done, &sync->lock );
+	    --sync->waiters;
+
+	    sync->Unlock();
+	}
+# endif
+}
+
+/*
+ * ThreadPool::Cancel() - drop queued tasks, ask running ones to stop
+ */
+
+void
+ThreadPool::Cancel()
+{
+	sync->Lock();
+	cancelled = 1;
+	sync->Unlock();
+
+# ifdef HAVE_PTHREAD
+	ThreadTask *t;
+
+	while( ( t = Take( nWorkers ) ) )
+	    Finish( t, 0 );
+# endif
+}
+
+/*
+ * ThreadPool::Cancelled() - has Cancel() (or Threading::Cancel())
+ */
+
+int
+ThreadPool::Cancelled()
+{
+	return cancelled || Threading::WasCancelled();
+}
+
+/*
+ * ThreadTask
+ */
+
+ThreadTask::ThreadTask()
+{
+	pool = 0;
+	group = 0;
+	groupNext = 0;
+	state = TASK_NEW;
+	ran = 0;
+}
+
+ThreadTask::~ThreadTask()
+{
+}
+
+/*
+ * ThreadTask::Wait() - wait for the task to have run or been dropped
+ */
+
+void
+ThreadTask::Wait()
+{
+	if( pool )
+	    pool->WaitFor( this, 0 );
+}
+
+int
+ThreadTask::Done()
+{
+	if( !pool )
+	    return 0;
+
+	pool->sync->Lock();
+	int done = state == TASK_DONE;
+	pool->sync->Unlock();
+
+	return done;
+}
+
+/*
+ * ThreadTask::Cancelled() - should a long running task give up
+ */
+
+int
+ThreadTask::Cancelled()
+{
+	return pool && pool->Cancelled();
+}
+
+/*
+ * ThreadGroup - tasks to wait for together
+ *
+ * The group owns its tasks, deleting them when it is itself deleted
+ * (after waiting for them).
+ */
+
+ThreadGroup::ThreadGroup( ThreadPool *pool )
+{
+	this->pool = pool;
+	tasks = 0;
+	pending = 0;
+}
+
+ThreadGroup::~ThreadGroup()
+{
+	Wait();
+
+	while( tasks )
+	{
+	    ThreadTask *t = tasks;
+	    tasks = t->groupNext;
+	    delete t;
+	}
+}
+
+void
+ThreadGroup::Submit( ThreadTask *t )
+{
+	pool->Queue( t, this );
+}
+
+void
+ThreadGroup::Wait()
+{
+	pool->WaitFor( 0, this );
+}
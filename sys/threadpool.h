@@ -0,0 +1,180 @@
+/*
+ * Copyright 2015 Perforce Software.  All rights reserved.
+ *
+ * This file is part of Perforce - the FAST SCM System.
+ */
+
+/*
+ * threadpool.h - a pool of worker threads that run tasks
+ *
+ * Where threading.h launches a thread (or process) per connection,
+ * this is for spreading one job over the cores: a fixed set of worker
+ * threads, each with its own queue of tasks, taking work from each
+ * other's queues when their own runs dry.
+ *
+ * Classes defined:
+ *
+ *	ThreadPool - worker threads that run ThreadTasks
+ *	ThreadTask (abstract) - a piece of work, and the handle to wait on it
+ *	ThreadGroup - tasks to wait for together
+ *	ThreadScratch - a worker's scratch memory, emptied after each task
+ *
+ * Public methods:
+ *
+ *	ThreadPool::ThreadPool() - start workers, one per core by default
+ *	ThreadPool::~ThreadPool() - run what's queued, then stop the workers
+ *	ThreadPool::Submit() - queue a task to run
+ *	ThreadPool::Cancel() - drop queued tasks, ask running ones to stop
+ *	ThreadPool::Cancelled() - has Cancel() (or Threading::Cancel())
+ *	ThreadPool::Workers() - how many worker threads
+ *	ThreadPool::Cores() - how many processors are online
+ *
+ *	ThreadTask::Run() - do the work (supplied by subclass)
+ *	ThreadTask::Wait() - wait for the task to have run or been dropped
+ *	ThreadTask::Done() - has it run or been dropped
+ *	ThreadTask::Ran() - did it run (rather than being dropped)
+ *	ThreadTask::Cancelled() - should a long running task give up
+ *
+ *	ThreadGroup::Submit() - queue a task to run as part of the group
+ *	ThreadGroup::Wait() - wait for all of the group's tasks
+ *
+ *	ThreadScratch::Alloc() - memory that lasts until the task ends
+ *	ThreadScratch::Reset() - free it all
+ *
+ * Submit() puts the task on the submitting worker's own queue (or, from
+ * outside the pool, on a shared one).  A worker runs the newest task on
+ * its own queue, and when that's empty steals the oldest from the shared
+ * queue or another worker's.  Waiting from inside a worker -- on a task
+ * or group submitted from a task -- runs queued tasks meanwhile, so
+ * tasks may fan out into more tasks without tying up the workers.
+ *
+ * With a bound on queued tasks, Submit() from outside the pool waits for
+ * room; a worker runs the task itself instead.
+ *
+ * Cancellation: Cancel() drops any queued tasks, marking them Done()
+ * but not Ran(), as are tasks submitted afterwards.  Running tasks can
+ * poll Cancelled().  After Threading::Cancel(), pools drop tasks the
+ * same way as they come to them.
+ *
+ * Without threads (no pthreads), Submit() runs the task there and then.
+ *
+ * Sample usage:
+ *
+ *	class Sum : public ThreadTask {
+ *	    public:
+ *		void Run( ThreadScratch *s ) { ... total = ...; }
+ *		int total;
+ *	} ;
+ *
+ *	ThreadPool pool;
+ *	ThreadGroup group( &pool );
+ *
+ *	for( ... )
+ *	    group.Submit( sums[i] = new Sum( ... ) );
+ *
+ *	group.Wait();
+ *	// add up sums[i]->total; ~ThreadGroup deletes the tasks
+ */
+
+class ThreadPool;
+class ThreadGroup;
+struct ThreadPoolSync;
+struct ThreadScratchBlock;
+
+class ThreadScratch {
+
+    public:
+			ThreadScratch();
+			~ThreadScratch();
+
+	void		*Alloc( int size );
+	void		Reset();
+
+    private:
+
+	ThreadScratchBlock *blocks;
+
+} ;
+
+class ThreadTask {
+
+    public:
+			ThreadTask();
+	virtual		~ThreadTask();
+
+	virtual void	Run( ThreadScratch *scratch ) = 0;
+
+	void		Wait();
+	int		Done();
+	int		Ran() { return ran; }
+	int		Cancelled();
+
+    private:
+
+	friend class ThreadPool;
+	friend class ThreadGroup;
+
+	ThreadPool	*pool;
+	ThreadGroup	*group;
+	ThreadTask	*groupNext;	// group's list, to delete
+	int		state;
+	int		ran;
+
+} ;
+
+class ThreadGroup {
+
+    public:
+			ThreadGroup( ThreadPool *pool );
+			~ThreadGroup();
+
+	void		Submit( ThreadTask *t );
+	void		Wait();
+
+    private:
+
+	friend class ThreadPool;
+
+	ThreadPool	*pool;
+	ThreadTask	*tasks;
+	int		pending;
+
+} ;
+
+class ThreadPool {
+
+    public:
+			ThreadPool( int workers = 0, int maxQueued = 0 );
+			~ThreadPool();
+
+	void		Submit( ThreadTask *t );
+	void		Cancel();
+	int		Cancelled();
+
+	int		Workers() { return nWorkers; }
+
+	static int	Cores();
+
+    private:
+
+	friend class ThreadTask;
+	friend class ThreadGroup;
+	friend struct ThreadPoolSync;
+
+	static void	*Start( void *id );
+
+	void		Queue( ThreadTask *t, ThreadGroup *g );
+	void		Work( int w );
+	ThreadTask	*Take( int w );
+	void		Execute( ThreadTask *t, int w );
+	void		Finish( ThreadTask *t, int ran );
+	void		WaitFor( ThreadTask *t, ThreadGroup *g );
+	int		Worker();
+
+	int		nWorkers;
+	int		maxQueued;
+	int		cancelled;
+
+	ThreadPoolSync	*sync;		// threads, locks, queues
+
+} ;
@@ -127,6 +127,28 @@ Timer::Time()
 	    ( stop.usec - start.usec ) / 1000;
 }
 
+/*
+ * Timer::TimeUs() - compute start vs stop in microseconds
+ */
+
+P4INT64
+Timer::TimeUs()
+{
+	Set( stop );
+
+# ifdef OS_NT
+	if( stop.sec < start.sec )
+	{
+	    stop.sec += 4294967;
+	    stop.usec += 296000;
+	}
+# endif
+
+	return
+	    (P4INT64)( stop.sec - start.sec ) * 1000000 +
+	    ( stop.usec - start.usec );
+}
+
 const StrPtr &
 Timer::Fmt( StrBuf &buf ) const
 {
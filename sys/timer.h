@@ -17,6 +17,7 @@
  *	Timer::Start() - restart the timer
  *	Timer::Message() - format an OS-specific resource usage message
  *	Timer::Time() - return MS since Start()
+ *	Timer::TimeUs() - return microseconds since Start()
  *	Timer::Reset() - restart the timer to the time of the last check
  */
 
@@ -40,6 +41,7 @@ class Timer {
         void	        Message( StrBuf &msg ) 
                         { msg << StrMs( Time() ) << "s"; }
         int	        Time();
+	P4INT64		TimeUs();
 	void		Restart();
 
         const StrPtr &	Fmt( StrBuf &b ) const;